@@ -31,24 +31,21 @@
 #include "defs.h"
 #include "utilityClusteringFunctions.h"
 #include "basic_comm.h"
+#include "basic_util.h"
 using namespace std;
 
-double parallelLouvianMethod(graph *G, long *C, int nThreads, double Lower, 
-				double thresh, double *totTime, int *numItr) {
+//The thread team, partition and per-thread scratch come from the runtime context:
+//initialization is one parallel region and each iteration (reset, sweep, merge,
+//modularity, community update) is another one
+double parallelLouvianMethod(graph *G, long *C, runtimeContext *ctx, double Lower, 
+				double thresh, double *totTime, int *numItr, long hubThreshold, bool atomicUpdates) {
 #ifdef PRINT_DETAILED_STATS_  
   printf("Within parallelLouvianMethod()\n");
 #endif
-  if (nThreads < 1)
-    omp_set_num_threads(1);
-  else
-    omp_set_num_threads(nThreads);
-  int nT;
-#pragma omp parallel
-  {
-    nT = omp_get_num_threads();
-  }
+  int nT = ctx->active;
+  long *part = ctx->part;
 #ifdef PRINT_DETAILED_STATS_
-  printf("Actual number of threads: %d (requested: %d)\n", nT, nThreads);
+  printf("Actual number of threads: %d (team: %d)\n", nT, ctx->nT);
 #endif
   double time1, time2, time3, time4; //For timing purposes  
   double total = 0, totItr = 0;
@@ -58,6 +55,7 @@ double parallelLouvianMethod(graph *G, long *C, int nThreads, double Lower,
   long    NE        = G->numEdges;
   long    *vtxPtr   = G->edgeListPtrs;
   edge    *vtxInd   = G->edgeList;
+  assert(ctx->NV == NV);
  
   /* Variables for computing modularity */
   long totalEdgeWeightTwice;
@@ -71,38 +69,65 @@ double parallelLouvianMethod(graph *G, long *C, int nThreads, double Lower,
   /********************** Initialization **************************/
   time1 = omp_get_wtime();
   //Store the degree of all vertices
-  double* vDegree = (double *) malloc (NV * sizeof(double)); assert(vDegree != 0);
+  double* vDegree = (double *) phaseAlloc (NV * sizeof(double)); assert(vDegree != 0);
   //Community info. (ai and size)
-  Comm *cInfo = (Comm *) malloc (NV * sizeof(Comm)); assert(cInfo != 0);
+  Comm *cInfo = (Comm *) phaseAlloc (NV * sizeof(Comm)); assert(cInfo != 0);
   //use for updating Community
-  Comm *cUpdate = (Comm*)malloc(NV*sizeof(Comm)); assert(cUpdate != 0);
-  //use for Modularity calculation (eii)
-  double* clusterWeightInternal = (double*) malloc (NV*sizeof(double)); assert(clusterWeightInternal != 0);
-
-  sumVertexDegree(vtxInd, vtxPtr, vDegree, NV , cInfo);	// Sum up the vertex degree
-  
-  /*** Compute the total edge weight (2m) and 1/2m ***/
-  constantForSecondTerm = calConstantForSecondTerm(vDegree, NV); // 1 over sum of the degree
-
-  cout<<"CHECK THIS:              "<<constantForSecondTerm<<endl;
+  Comm *cUpdate = (Comm*)phaseAlloc(NV*sizeof(Comm)); assert(cUpdate != 0);
   //Community assignments:
   //Store previous iteration's community assignment
-  long* pastCommAss = (long *) malloc (NV * sizeof(long)); assert(pastCommAss != 0);
+  long* pastCommAss = (long *) phaseAlloc (NV * sizeof(long)); assert(pastCommAss != 0);
   //Store current community assignment
-  long* currCommAss = (long *) malloc (NV * sizeof(long)); assert(currCommAss != 0);  
+  long* currCommAss = (long *) phaseAlloc (NV * sizeof(long)); assert(currCommAss != 0);  
   //Store the target of community assignment  
-  long* targetCommAss = (long *) malloc (NV * sizeof(long)); assert(targetCommAss != 0);
- 
-//Vectors used in place of maps: Total size = |V|+2*|E| -- The |V| part takes care of self loop
-//  mapElement* clusterLocalMapX = (mapElement *) malloc ((NV + 2*NE) * sizeof(mapElement)); assert(clusterLocalMapX != 0);
-  //double* Counter             = (double *)     malloc ((NV + 2*NE) * sizeof(double));     assert(Counter != 0);
- 
-  //Initialize each vertex to its own cluster
-  //initCommAssOpt(pastCommAss, currCommAss, NV, clusterLocalMapX, vtxPtr, vtxInd, cInfo, constantForSecondTerm, vDegree);
-  
-  //Initialize each vertex to its own cluster
-  initCommAss(pastCommAss, currCommAss, NV); 
+  long* targetCommAss = (long *) phaseAlloc (NV * sizeof(long)); assert(targetCommAss != 0);
+
+  //Vertex degrees, one cluster per vertex and the totals for modularity, in one pass
+  //over the edge-balanced ranges of the sweep (first touch by the sweeping thread)
+  double *threadSum = ctx->threadSum;
+#pragma omp parallel num_threads(nT)
+  {
+    int tid = omp_get_thread_num();
+    double myDegree = 0, mySquared = 0;
+    for (long i=part[tid]; i<part[tid+1]; i++) {
+      double totalWt = 0;
+      for (long j=vtxPtr[i]; j<vtxPtr[i+1]; j++)
+        totalWt += vtxInd[j].weight;
+      vDegree[i] = totalWt; //Degree of each node
+      cInfo[i].degree = totalWt; //Initialize the community
+      cInfo[i].size = 1;
+      pastCommAss[i] = i; //Initialize each vertex to its own cluster
+      currCommAss[i] = i;
+      myDegree  += totalWt;
+      mySquared += totalWt*totalWt;
+    }
+    threadSum[tid*CTX_PAD] = myDegree;
+#pragma omp barrier
+#pragma omp single
+    constantForSecondTerm = (double)1/sumThreadValues(ctx); // 1 over sum of the degree
+    threadSum[tid*CTX_PAD] = mySquared;
+  }//End of parallel region
+  //a2_x is maintained across iterations from the community updates
+  double a2_x = sumThreadValues(ctx);
 
+  cout<<"CHECK THIS:              "<<constantForSecondTerm<<endl;
+
+  //Degree-aware schedule of the sweep: edge-balanced chunks, hubs split across threads
+  hybridSchedule sched;
+  buildHybridSchedule(&sched, 0, NV, vtxPtr, hubThreshold, nT);
+  hubScratch *hubWork = 0;
+  if (sched.numHubs > 0) {
+    hubWork = allocHubScratch(nT, maxHubDegree(&sched, vtxPtr));
+    printf("Hybrid schedule: %ld hubs (degree > %ld) processed by all threads\n", sched.numHubs, hubThreshold);
+  }
+  //Community updates: per-thread delta buffers unless the atomic fallback is requested
+  deltaBuffer *deltaBuf = 0;
+  if (!atomicUpdates)
+    deltaBuf = allocDeltaBuffers(nT, 4096);
+  double *busyTime = ctx->busyTime;
+  for (int t=0; t<nT; t++)
+    busyTime[t] = 0;
+  
   time2 = omp_get_wtime();
   printf("Time to initialize: %3.3lf\n", time2-time1);
 	
@@ -117,19 +142,24 @@ double parallelLouvianMethod(graph *G, long *C, int nThreads, double Lower,
   printf("=====================================================\n");
 #endif
   //Start maximizing modularity
+  bool done = false;
   while(true) {
     numItrs++;    
     time1 = omp_get_wtime();
-    /* Re-initialize datastructures */
-#pragma omp parallel for
-    for (long i=0; i<NV; i++) {
-      clusterWeightInternal[i] = 0; 
-      cUpdate[i].degree =0;
-      cUpdate[i].size =0;
-    }
-    
-#pragma omp parallel for
-    for (long i=0; i<NV; i++) {
+    double e_xx = 0; //Sum of the e_ix found by the sweep
+#pragma omp parallel num_threads(nT)
+    {
+      int tid = omp_get_thread_num();
+      /* Re-initialize datastructures */
+      for (long i=part[tid]; i<part[tid+1]; i++) {
+        cUpdate[i].degree =0;
+        cUpdate[i].size =0;
+      }
+#pragma omp barrier
+      double my_exx = 0;
+      double lightStartTime = omp_get_wtime();
+      for (long k=sched.lightStart[tid]; k<sched.lightStart[tid+1]; k++) {
+      long i = (sched.light != 0) ? sched.light[k] : k;
       long adj1 = vtxPtr[i];
       long adj2 = vtxPtr[i+1];
 	    double selfLoop = 0;
@@ -144,7 +174,7 @@ double parallelLouvianMethod(graph *G, long *C, int nThreads, double Lower,
 	      //Find unique cluster ids and #of edges incident (eicj) to them
 	      selfLoop = buildLocalMapCounter(adj1, adj2, clusterLocalMap, Counter, vtxInd, currCommAss, i);
 	      // Update delta Q calculation
-	      clusterWeightInternal[i] += Counter[0]; //(e_ix)
+	      my_exx += Counter[0]; //(e_ix)
 	      //Calculate the max
 	      targetCommAss[i] = max(clusterLocalMap, Counter, selfLoop, cInfo, vDegree[i], currCommAss[i], constantForSecondTerm);
               //assert((targetCommAss[i] >= 0)&&(targetCommAss[i] < NV));
@@ -154,14 +184,19 @@ double parallelLouvianMethod(graph *G, long *C, int nThreads, double Lower,
 
         //Update
         if(targetCommAss[i] != currCommAss[i]  && targetCommAss[i] != -1) {
-          #pragma omp atomic update
-	        cUpdate[targetCommAss[i]].degree += vDegree[i];
-	        #pragma omp atomic update
-	        cUpdate[targetCommAss[i]].size += 1;
-          #pragma omp atomic update
-	        cUpdate[currCommAss[i]].degree -= vDegree[i];
-          #pragma omp atomic update
-	        cUpdate[currCommAss[i]].size -=1;
+          if (deltaBuf != 0) { //Per-thread buffers, merged after the sweep
+            addDeltaBuffer(&deltaBuf[tid], targetCommAss[i], 1, vDegree[i]);
+            addDeltaBuffer(&deltaBuf[tid], currCommAss[i], -1, -vDegree[i]);
+          } else {
+            #pragma omp atomic update
+  	        cUpdate[targetCommAss[i]].degree += vDegree[i];
+  	        #pragma omp atomic update
+  	        cUpdate[targetCommAss[i]].size += 1;
+            #pragma omp atomic update
+  	        cUpdate[currCommAss[i]].degree -= vDegree[i];
+            #pragma omp atomic update
+  	        cUpdate[currCommAss[i]].size -=1;
+          }
           /*
           __sync_fetch_and_add(&cUpdate[targetCommAss[i]].size, 1);
 	        __sync_fetch_and_sub(&cUpdate[currCommAss[i]].degree, vDegree[i]);
@@ -169,22 +204,75 @@ double parallelLouvianMethod(graph *G, long *C, int nThreads, double Lower,
         }//End of If()      
         clusterLocalMap.clear();      
         Counter.clear();
-    }//End of for(i)
-    time2 = omp_get_wtime();
- 
-    time3 = omp_get_wtime();    
-    double e_xx = 0;
-    double a2_x = 0;	
+    }//End of for(k)
+      busyTime[tid] += omp_get_wtime() - lightStartTime;
 
-#pragma omp parallel for \
-  reduction(+:e_xx) reduction(+:a2_x)
-    for (long i=0; i<NV; i++) {
-      e_xx += clusterWeightInternal[i];
-      a2_x += (cInfo[i].degree)*(cInfo[i].degree);
-    }
-    time4 = omp_get_wtime();
-
-    currMod = (e_xx*(double)constantForSecondTerm) - (a2_x*(double)constantForSecondTerm*(double)constantForSecondTerm);
+      //Hubs: all threads work together on one vertex at a time
+      for (long h=0; h<sched.numHubs; h++) {
+        long i = sched.hubs[h];
+        double hubStartTime = omp_get_wtime();
+        double eix = 0;
+        long target = maxHubParallel(i, vtxPtr, vtxInd, currCommAss, cInfo, vDegree[i],
+                                     constantForSecondTerm, hubWork, &eix, 0);
+        busyTime[tid] += omp_get_wtime() - hubStartTime;
+        if (tid == 0) {
+          targetCommAss[i] = target;
+          my_exx += eix; //(e_ix)
+          if(target != currCommAss[i]) {
+            if (deltaBuf != 0) { //Per-thread buffers, merged after the sweep
+              addDeltaBuffer(&deltaBuf[tid], target, 1, vDegree[i]);
+              addDeltaBuffer(&deltaBuf[tid], currCommAss[i], -1, -vDegree[i]);
+            } else {
+              #pragma omp atomic update
+              cUpdate[target].degree += vDegree[i];
+              #pragma omp atomic update
+              cUpdate[target].size += 1;
+              #pragma omp atomic update
+              cUpdate[currCommAss[i]].degree -= vDegree[i];
+              #pragma omp atomic update
+              cUpdate[currCommAss[i]].size -=1;
+            }
+          }
+        }
+      }//End of for(h)
+      if (deltaBuf != 0)
+        mergeDeltaBuffers(deltaBuf, cUpdate, NV);
+      threadSum[tid*CTX_PAD] = my_exx;
+#pragma omp barrier
+#pragma omp single
+      {
+        time2 = omp_get_wtime();
+        time3 = omp_get_wtime();
+        //e_xx comes from the sweep; a2_x is maintained from the community updates
+        e_xx = sumThreadValues(ctx);
+      }//End of single
+      if (numItrs % MOD_EXACT_PERIOD == 0) { //Bound the drift of a2_x
+        double mySquared = 0;
+        for (long i=part[tid]; i<part[tid+1]; i++)
+          mySquared += cInfo[i].degree*cInfo[i].degree;
+        threadSum[tid*CTX_PAD] = mySquared;
+#pragma omp barrier
+#pragma omp single
+        a2_x = sumThreadValues(ctx);
+      }
+#pragma omp single
+      {
+        time4 = omp_get_wtime();
+        currMod = (e_xx*(double)constantForSecondTerm) - (a2_x*(double)constantForSecondTerm*(double)constantForSecondTerm);
+        //Break if modularity gain is not sufficient
+        done = ((currMod - prevMod) < thresMod);
+      }//End of single
+      //Else update information for the next iteration
+      if (!done) {
+        double a2Change = 0;
+        for (long i=part[tid]; i<part[tid+1]; i++) {
+          a2Change += cUpdate[i].degree*(2*cInfo[i].degree + cUpdate[i].degree); //(a+d)^2 - a^2
+          cInfo[i].size += cUpdate[i].size;
+          cInfo[i].degree += cUpdate[i].degree;
+        }
+        threadSum[tid*CTX_PAD] = a2Change;
+      }
+    }//End of parallel region
     totItr = (time2-time1) + (time4-time3);
     total += totItr;
 #ifdef PRINT_DETAILED_STATS_
@@ -193,21 +281,13 @@ double parallelLouvianMethod(graph *G, long *C, int nThreads, double Lower,
 #ifdef PRINT_TERSE_STATS_
    printf("%d \t %lf \t %3.3lf  \t %3.3lf\n",numItrs, currMod, totItr, total);
 #endif
- 
-    //Break if modularity gain is not sufficient
-    if((currMod - prevMod) < thresMod) {
+    if (done)
       break;
-    }
     
-    //Else update information for the next iteration
     prevMod = currMod;
     if(prevMod < Lower)
 	prevMod = Lower;
-#pragma omp parallel for 
-    for (long i=0; i<NV; i++) {
-      cInfo[i].size += cUpdate[i].size;
-      cInfo[i].degree += cUpdate[i].degree;
-    }
+    a2_x += sumThreadValues(ctx);
     
     //Do pointer swaps to reuse memory:
     long* tmp;
@@ -233,18 +313,25 @@ double parallelLouvianMethod(graph *G, long *C, int nThreads, double Lower,
 
   //Store back the community assignments in the input variable:
   //Note: No matter when the while loop exits, we are interested in the previous assignment
-#pragma omp parallel for 
-  for (long i=0; i<NV; i++) {
-    C[i] = pastCommAss[i];
+#pragma omp parallel num_threads(nT)
+  {
+    int tid = omp_get_thread_num();
+    for (long i=part[tid]; i<part[tid+1]; i++)
+      C[i] = pastCommAss[i];
   }
   //Cleanup
-  free(pastCommAss);
-  free(currCommAss);
-  free(targetCommAss);
-  free(vDegree);
-  free(cInfo);
-  free(cUpdate);
-  free(clusterWeightInternal);
+  phaseFree(pastCommAss);
+  phaseFree(currCommAss);
+  phaseFree(targetCommAss);
+  phaseFree(vDegree);
+  phaseFree(cInfo);
+  phaseFree(cUpdate);
+  reportThreadBusyTime(busyTime, nT);
+  if (deltaBuf != 0)
+    freeDeltaBuffers(deltaBuf, nT);
+  freeHybridSchedule(&sched);
+  if (hubWork != 0)
+    freeHubScratch(hubWork, nT);
 
   return prevMod;
 }
@@ -0,0 +1,338 @@
+// **************************************************************************************************
+// Grappolo: A C++ library for parallel graph community detection
+// Hao Lu, Ananth Kalyanaraman (hao.lu@wsu.edu, ananth@eecs.wsu.edu) Washington State University
+// Mahantesh Halappanavar (hala@pnnl.gov) Pacific Northwest National Laboratory
+//
+// For citation, please cite the following paper:
+// Lu, Hao, Mahantesh Halappanavar, and Ananth Kalyanaraman. 
+// "Parallel heuristics for scalable community detection." Parallel Computing 47 (2015): 19-37.
+//
+// **************************************************************************************************
+// Copyright (c) 2016. Washington State University ("WSU"). All Rights Reserved.
+// Permission to use, copy, modify, and distribute this software and its documentation
+// for educational, research, and not-for-profit purposes, without fee, is hereby
+// granted, provided that the above copyright notice, this paragraph and the following
+// two paragraphs appear in all copies, modifications, and distributions. For
+// commercial licensing opportunities, please contact The Office of Commercialization,
+// WSU, 280/286 Lighty, PB Box 641060, Pullman, WA 99164, (509) 335-5526,
+// commercialization@wsu.edu<mailto:commercialization@wsu.edu>, https://commercialization.wsu.edu/
+
+// IN NO EVENT SHALL WSU BE LIABLE TO ANY PARTY FOR DIRECT, INDIRECT, SPECIAL, INCIDENTAL,
+// OR CONSEQUENTIAL DAMAGES, INCLUDING LOST PROFITS, ARISING OUT OF THE USE OF
+// THIS SOFTWARE AND ITS DOCUMENTATION, EVEN IF WSU HAS BEEN ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+// WSU SPECIFICALLY DISCLAIMS ANY WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. THE SOFTWARE AND
+// ACCOMPANYING DOCUMENTATION, IF ANY, PROVIDED HEREUNDER IS PROVIDED "AS IS". WSU HAS NO
+// OBLIGATION TO PROVIDE MAINTENANCE, SUPPORT, UPDATES, ENHANCEMENTS, OR MODIFICATIONS.
+// **************************************************************************************************
+
+#include "defs.h"
+#include "basic_comm.h"
+#include "utilityClusteringFunctions.h"
+
+using namespace std;
+
+//Same as parallelLouvianMethodNoMap(), on a compact graph: 16 (long,double), 12 (int,double)
+//or 8 (int,float) instead of 24 bytes per edge are streamed.
+//IdxT is also used for the community assignments and sizes, WtT for the community degrees;
+//all the modularity arithmetic is done in double.
+//Weighted = false: no weight array (phase 1 of an unweighted input); degrees come from edgeListPtrs.
+template<typename IdxT, typename WtT, bool Weighted>
+double parallelLouvianMethodCompact(compactGraphT<IdxT, WtT> *G, long *C, int nThreads, double Lower,
+				double thresh, double *totTime, int *numItr, long localMapCap, long hubThreshold, bool atomicUpdates) {
+#ifdef PRINT_DETAILED_STATS_  
+  printf("Within parallelLouvianMethodCompact()\n");
+#endif
+  if (nThreads < 1)
+    omp_set_num_threads(1);
+  else
+    omp_set_num_threads(nThreads);
+  int nT;
+#pragma omp parallel
+  {
+    nT = omp_get_num_threads();
+  }
+#ifdef PRINT_DETAILED_STATS_
+  printf("Actual number of threads: %d (requested: %d)\n", nT, nThreads);
+#endif
+  double time1, time2, time3, time4; //For timing purposes  
+  double total = 0, totItr = 0;
+  
+  long    NV        = G->numVertices;
+  long    NS        = G->sVertices;      
+  long    NE        = G->numEdges;
+  long    *vtxPtr   = G->edgeListPtrs;
+  IdxT    *vtxTail  = G->tail;
+  WtT     *vtxWt    = G->weight;
+ 
+  /* Variables for computing modularity */
+  long totalEdgeWeightTwice;
+  double constantForSecondTerm;
+  double prevMod=-1;
+  double currMod=-1;
+  //double thresMod = 0.000001;
+  double thresMod = thresh; //Input parameter
+  int numItrs = 0;
+  
+  /********************** Initialization **************************/
+  time1 = omp_get_wtime();
+  //Store the degree of all vertices
+  double* vDegree = (double *) malloc (NV * sizeof(double)); assert(vDegree != 0);
+  //Community info. (ai and size)
+  CommT<IdxT, WtT> *cInfo = (CommT<IdxT, WtT> *) malloc (NV * sizeof(CommT<IdxT, WtT>)); assert(cInfo != 0);
+  //use for updating Community (always in double)
+  Comm *cUpdate = (Comm*)malloc(NV*sizeof(Comm)); assert(cUpdate != 0);
+
+  sumVertexDegreeCompact<IdxT, WtT, Weighted>(vtxWt, vtxPtr, vDegree, NV , cInfo);	// Sum up the vertex degree
+  
+  /*** Compute the total edge weight (2m) and 1/2m ***/
+  constantForSecondTerm = calConstantForSecondTerm(vDegree, NV); // 1 over sum of the degree
+  
+  //Community assignments:
+  //Store previous iteration's community assignment
+  IdxT* pastCommAss = (IdxT *) malloc (NV * sizeof(IdxT)); assert(pastCommAss != 0);
+  //Store current community assignment
+  IdxT* currCommAss = (IdxT *) malloc (NV * sizeof(IdxT)); assert(currCommAss != 0);  
+  //Store the target of community assignment  
+  IdxT* targetCommAss = (IdxT *) malloc (NV * sizeof(IdxT)); assert(targetCommAss != 0);
+    
+  //Per-thread local maps sized to the max degree (or to the cap) in place of a |V|+2*|E| buffer
+  localMapScratch *scratch = allocLocalMapScratch(nT, NV, maxDegreeOfGraph(vtxPtr, NV), localMapCap);
+  //double* Counter             = (double *)     malloc ((NV + 2*NE) * sizeof(double));     assert(Counter != 0);
+ 
+  //Initialize each vertex to its own cluster
+//  initCommAss(pastCommAss, currCommAss, NV); 
+  initCommAssOptCompact<IdxT, WtT, Weighted>(pastCommAss, currCommAss, NV, scratch, vtxPtr, vtxTail, vtxWt, cInfo, constantForSecondTerm, vDegree);
+
+  //Degree-aware schedule of the sweep: edge-balanced chunks, hubs split across threads
+  hybridSchedule sched;
+  buildHybridSchedule(&sched, 0, NV, vtxPtr, hubThreshold, nT);
+  hubScratch *hubWork = 0;
+  if (sched.numHubs > 0) {
+    hubWork = allocHubScratch(nT, maxHubDegree(&sched, vtxPtr));
+    printf("Hybrid schedule: %ld hubs (degree > %ld) processed by all threads\n", sched.numHubs, hubThreshold);
+  }
+  //Community updates: per-thread delta buffers unless the atomic fallback is requested
+  deltaBuffer *deltaBuf = 0;
+  if (!atomicUpdates)
+    deltaBuf = allocDeltaBuffers(nT, 4096);
+  double *busyTime = (double *) malloc (nT * sizeof(double)); assert(busyTime != 0);
+  for (int t=0; t<nT; t++)
+    busyTime[t] = 0;
+  
+  double a2_x = sumSquaredDegrees(cInfo, NV); //Maintained across iterations from the community updates
+  
+  time2 = omp_get_wtime();
+  printf("Time to initialize: %3.3lf\n", time2-time1);
+	
+#ifdef PRINT_DETAILED_STATS_
+  printf("========================================================================================================\n");
+  printf("Itr      E_xx            A_x2           Curr-Mod         Time-1(s)       Time-2(s)        T/Itr(s)\n");
+  printf("========================================================================================================\n");
+#endif
+#ifdef PRINT_TERSE_STATS_
+  printf("=====================================================\n");
+  printf("Itr      Curr-Mod         T/Itr(s)      T-Cumulative\n");
+  printf("=====================================================\n");
+#endif
+  //Start maximizing modularity
+  while(true) {
+    numItrs++;    
+    time1 = omp_get_wtime();
+    /* Re-initialize datastructures */
+#pragma omp parallel for
+    for (long i=0; i<NV; i++) {
+      cUpdate[i].degree =0;
+      cUpdate[i].size =0;
+    }
+    
+    double e_xx = 0; //Sum of the e_ix found by the sweep
+#pragma omp parallel num_threads(nT) reduction(+:e_xx)
+    {
+      int tid = omp_get_thread_num();
+      double lightStartTime = omp_get_wtime();
+      for (long k=sched.lightStart[tid]; k<sched.lightStart[tid+1]; k++) {
+      long i = (sched.light != 0) ? sched.light[k] : k;
+      long adj1 = vtxPtr[i];
+      long adj2 = vtxPtr[i+1];
+      long selfLoop = 0;
+	    //Build a datastructure to hold the cluster structure of its neighbors      	
+	    //map<long, long> clusterLocalMap; //Map each neighbor's cluster to a local number
+	    //map<long, long>::iterator storedAlready;
+	    // vector<double> Counter; //Number of edges in each unique cluster
+      long numUniqueClusters = 0;
+	    //Add v's current cluster:
+	    if(adj1 != adj2){
+        //Add the current cluster of i to the local map
+        localMapScratch *S = &scratch[omp_get_thread_num()];
+        mapElement *localMap = acquireLocalMap(S, adj2-adj1); //Local map for i
+        localMap[0].Counter = 0;          //Initialize the counter to ZERO (no edges incident yet)
+        localMap[0].cid = currCommAss[i]; //Initialize with current community
+        numUniqueClusters++; //Added the first entry
+          
+	      //Find unique cluster ids and #of edges incident (eicj) to them
+        selfLoop = buildLocalMapCounterCompact<IdxT, WtT, Weighted>(i, localMap, vtxPtr, vtxTail, vtxWt, currCommAss, numUniqueClusters, S);
+	      // Update delta Q calculation
+	      e_xx += localMap[0].Counter; //(e_ix)
+	      //Calculate the max
+	      targetCommAss[i] = maxLocalMap(localMap, selfLoop, cInfo, vDegree[i], currCommAss[i],
+                                      constantForSecondTerm, numUniqueClusters);
+	      releaseLocalMap(S);
+              //assert((targetCommAss[i] >= 0)&&(targetCommAss[i] < NV));
+      } else {
+		    targetCommAss[i] = -1;	
+      }
+
+       //Update
+      if(targetCommAss[i] != currCommAss[i]  && targetCommAss[i] != -1) {
+        
+	    	if (deltaBuf != 0) { //Per-thread buffers, merged after the sweep
+	    		addDeltaBuffer(&deltaBuf[tid], targetCommAss[i], 1, vDegree[i]);
+	    		addDeltaBuffer(&deltaBuf[tid], currCommAss[i], -1, -vDegree[i]);
+	    	} else {
+		    	#pragma omp atomic update
+		    	cUpdate[targetCommAss[i]].degree += vDegree[i];
+		    	#pragma omp atomic update
+		    	cUpdate[targetCommAss[i]].size += 1;
+		    	#pragma omp atomic update
+		    	cUpdate[currCommAss[i]].degree -= vDegree[i];
+		    	#pragma omp atomic update
+		    	cUpdate[currCommAss[i]].size -=1;
+	    	}
+
+
+/*	      __sync_fetch_and_add(&cUpdate[targetCommAss[i]].degree, vDegree[i]);
+	      __sync_fetch_and_add(&cUpdate[targetCommAss[i]].size, 1);
+	      __sync_fetch_and_sub(&cUpdate[currCommAss[i]].degree, vDegree[i]);
+	      __sync_fetch_and_sub(&cUpdate[currCommAss[i]].size, 1);*/
+      }//End of If()      
+        //numClustSize = 0;
+    }//End of for(k)
+      busyTime[tid] += omp_get_wtime() - lightStartTime;
+
+      //Hubs: all threads work together on one vertex at a time
+      for (long h=0; h<sched.numHubs; h++) {
+        long i = sched.hubs[h];
+        double hubStartTime = omp_get_wtime();
+        double eix = 0;
+        long target = maxHubParallelCompact<IdxT, WtT, Weighted>(i, vtxPtr, vtxTail, vtxWt, currCommAss, cInfo,
+                                                                 vDegree[i], constantForSecondTerm, hubWork, &eix);
+        busyTime[tid] += omp_get_wtime() - hubStartTime;
+        if (tid == 0) {
+          targetCommAss[i] = target;
+          e_xx += eix; //(e_ix)
+          if(target != currCommAss[i]) {
+            if (deltaBuf != 0) { //Per-thread buffers, merged after the sweep
+              addDeltaBuffer(&deltaBuf[tid], target, 1, vDegree[i]);
+              addDeltaBuffer(&deltaBuf[tid], currCommAss[i], -1, -vDegree[i]);
+            } else {
+              #pragma omp atomic update
+              cUpdate[target].degree += vDegree[i];
+              #pragma omp atomic update
+              cUpdate[target].size += 1;
+              #pragma omp atomic update
+              cUpdate[currCommAss[i]].degree -= vDegree[i];
+              #pragma omp atomic update
+              cUpdate[currCommAss[i]].size -=1;
+            }
+          }
+        }
+      }//End of for(h)
+      if (deltaBuf != 0)
+        mergeDeltaBuffers(deltaBuf, cUpdate, NV);
+    }//End of parallel region
+    time2 = omp_get_wtime();
+ 
+    time3 = omp_get_wtime();
+    //e_xx comes from the sweep; a2_x is maintained from the community updates
+    if (numItrs % MOD_EXACT_PERIOD == 0)
+      a2_x = sumSquaredDegrees(cInfo, NV); //Bound the drift
+    time4 = omp_get_wtime();
+
+    currMod = (e_xx*(double)constantForSecondTerm) - (a2_x*(double)constantForSecondTerm*(double)constantForSecondTerm);
+    totItr = (time2-time1) + (time4-time3);
+    total += totItr;
+#ifdef PRINT_DETAILED_STATS_
+    printf("%d \t %g \t %g \t %lf \t %3.3lf \t %3.3lf  \t %3.3lf\n",numItrs, e_xx, a2_x, currMod, (time2-time1), (time4-time3), totItr );
+#endif
+#ifdef PRINT_TERSE_STATS_
+   printf("%d \t %lf \t %3.3lf  \t %3.3lf\n",numItrs, currMod, totItr, total);
+#endif
+ 
+    //Break if modularity gain is not sufficient
+    if((currMod - prevMod) < thresMod) {
+      break;
+    }
+    
+    //Else update information for the next iteration
+    prevMod = currMod;
+    if(prevMod < Lower)
+	prevMod = Lower;
+    double a2Change = 0;
+#pragma omp parallel for reduction(+:a2Change)
+    for (long i=0; i<NV; i++) {
+      a2Change += cUpdate[i].degree*(2*(double)cInfo[i].degree + cUpdate[i].degree); //(a+d)^2 - a^2
+      cInfo[i].size += cUpdate[i].size;
+      cInfo[i].degree += cUpdate[i].degree;
+    }
+    a2_x += a2Change;
+    
+    //Do pointer swaps to reuse memory:
+    IdxT* tmp;
+    tmp = pastCommAss;
+    pastCommAss = currCommAss; //Previous holds the current
+    currCommAss = targetCommAss; //Current holds the chosen assignment
+    targetCommAss = tmp;      //Reuse the vector
+    
+  }//End of while(true)
+  *totTime = total; //Return back the total time for clustering
+  *numItr  = numItrs;
+
+#ifdef PRINT_DETAILED_STATS_
+  printf("========================================================================================================\n");
+  printf("Total time for %d iterations is: %lf\n",numItrs, total);  
+  printf("========================================================================================================\n");
+#endif  
+#ifdef PRINT_TERSE_STATS_
+  printf("========================================================================================================\n");
+  printf("Total time for %d iterations is: %lf\n",numItrs, total);  
+  printf("========================================================================================================\n");
+#endif
+
+  //Store back the community assignments in the input variable:
+  //Note: No matter when the while loop exits, we are interested in the previous assignment
+#pragma omp parallel for 
+  for (long i=0; i<NV; i++) {
+    C[i] = pastCommAss[i];
+  }
+  //Cleanup
+  free(pastCommAss);
+  free(currCommAss);
+  free(targetCommAss);
+  free(vDegree);
+  free(cInfo);
+  free(cUpdate);
+  reportThreadBusyTime(busyTime, nT);
+  free(busyTime);
+  if (deltaBuf != 0)
+    freeDeltaBuffers(deltaBuf, nT);
+  freeHybridSchedule(&sched);
+  if (hubWork != 0)
+    freeHubScratch(hubWork, nT);
+  freeLocalMapScratch(scratch, nT);
+
+  return prevMod;
+}
+#define INSTANTIATE_LOUVAIN_COMPACT(IdxT, WtT, Weighted) \
+  template double parallelLouvianMethodCompact<IdxT, WtT, Weighted>(compactGraphT<IdxT, WtT> *G, long *C, int nThreads, \
+                                                                    double Lower, double thresh, double *totTime, \
+                                                                    int *numItr, long localMapCap, long hubThreshold, \
+                                                                    bool atomicUpdates);
+INSTANTIATE_LOUVAIN_COMPACT(long, double, true)
+INSTANTIATE_LOUVAIN_COMPACT(int, double, true)
+INSTANTIATE_LOUVAIN_COMPACT(int, float, true)
+INSTANTIATE_LOUVAIN_COMPACT(long, double, false)
+INSTANTIATE_LOUVAIN_COMPACT(int, double, false)
+INSTANTIATE_LOUVAIN_COMPACT(int, float, false)
@@ -0,0 +1,288 @@
+// **************************************************************************************************
+// Grappolo: A C++ library for parallel graph community detection
+// Hao Lu, Ananth Kalyanaraman (hao.lu@wsu.edu, ananth@eecs.wsu.edu) Washington State University
+// Mahantesh Halappanavar (hala@pnnl.gov) Pacific Northwest National Laboratory
+//
+// For citation, please cite the following paper:
+// Lu, Hao, Mahantesh Halappanavar, and Ananth Kalyanaraman. 
+// "Parallel heuristics for scalable community detection." Parallel Computing 47 (2015): 19-37.
+//
+// **************************************************************************************************
+// Copyright (c) 2016. Washington State University ("WSU"). All Rights Reserved.
+// Permission to use, copy, modify, and distribute this software and its documentation
+// for educational, research, and not-for-profit purposes, without fee, is hereby
+// granted, provided that the above copyright notice, this paragraph and the following
+// two paragraphs appear in all copies, modifications, and distributions. For
+// commercial licensing opportunities, please contact The Office of Commercialization,
+// WSU, 280/286 Lighty, PB Box 641060, Pullman, WA 99164, (509) 335-5526,
+// commercialization@wsu.edu<mailto:commercialization@wsu.edu>, https://commercialization.wsu.edu/
+
+// IN NO EVENT SHALL WSU BE LIABLE TO ANY PARTY FOR DIRECT, INDIRECT, SPECIAL, INCIDENTAL,
+// OR CONSEQUENTIAL DAMAGES, INCLUDING LOST PROFITS, ARISING OUT OF THE USE OF
+// THIS SOFTWARE AND ITS DOCUMENTATION, EVEN IF WSU HAS BEEN ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+// WSU SPECIFICALLY DISCLAIMS ANY WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. THE SOFTWARE AND
+// ACCOMPANYING DOCUMENTATION, IF ANY, PROVIDED HEREUNDER IS PROVIDED "AS IS". WSU HAS NO
+// OBLIGATION TO PROVIDE MAINTENANCE, SUPPORT, UPDATES, ENHANCEMENTS, OR MODIFICATIONS.
+// **************************************************************************************************
+
+#include "defs.h"
+#include "basic_comm.h"
+#include "utilityClusteringFunctions.h"
+#include "basic_util.h"
+
+using namespace std;
+
+//Frontier (active-set) version of parallelLouvianMethodNoMap():
+//only the vertices that moved in the previous iteration, and their neighbors, are revisited.
+//Moves are still applied Jacobi-style: the targets are chosen from the assignment of the previous iteration.
+//The e_ix of an inactive vertex is unchanged (neither it nor a neighbor moved), so it is kept from
+//the iteration that computed it: e_xx is updated from the active vertices only.
+//Community updates always go through per-thread delta buffers, merged into cInfo after the check.
+double parallelLouvianMethodFrontier(graph *G, long *C, int nThreads, double Lower,
+				double thresh, double *totTime, int *numItr, long localMapCap) {
+#ifdef PRINT_DETAILED_STATS_
+  printf("Within parallelLouvianMethodFrontier()\n");
+#endif
+  if (nThreads < 1)
+    omp_set_num_threads(1);
+  else
+    omp_set_num_threads(nThreads);
+  int nT;
+#pragma omp parallel
+  {
+    nT = omp_get_num_threads();
+  }
+#ifdef PRINT_DETAILED_STATS_
+  printf("Actual number of threads: %d (requested: %d)\n", nT, nThreads);
+#endif
+  double time1, time2, time3, time4; //For timing purposes
+  double total = 0, totItr = 0;
+  
+  long    NV        = G->numVertices;
+  long    *vtxPtr   = G->edgeListPtrs;
+  edge    *vtxInd   = G->edgeList;
+  
+  /* Variables for computing modularity */
+  double constantForSecondTerm;
+  double prevMod=-1;
+  double currMod=-1;
+  double thresMod = thresh; //Input parameter
+  int numItrs = 0;
+  
+  /********************** Initialization **************************/
+  time1 = omp_get_wtime();
+  //Store the degree of all vertices
+  double* vDegree = (double *) phaseAlloc (NV * sizeof(double)); assert(vDegree != 0);
+  //Community info. (ai and size)
+  Comm *cInfo = (Comm *) phaseAlloc (NV * sizeof(Comm)); assert(cInfo != 0);
+  //use for Modularity calculation (eii): only the active vertices overwrite their entry
+  double* clusterWeightInternal = (double*) phaseAlloc (NV*sizeof(double)); assert(clusterWeightInternal != 0);
+  
+  sumVertexDegree(vtxInd, vtxPtr, vDegree, NV , cInfo);	// Sum up the vertex degree
+  
+  /*** Compute the total edge weight (2m) and 1/2m ***/
+  constantForSecondTerm = calConstantForSecondTerm(vDegree, NV); // 1 over sum of the degree
+  
+  //Community assignments:
+  //Store previous iteration's community assignment
+  long* pastCommAss = (long *) phaseAlloc (NV * sizeof(long)); assert(pastCommAss != 0);
+  //Store current community assignment
+  long* currCommAss = (long *) phaseAlloc (NV * sizeof(long)); assert(currCommAss != 0);
+  //Store the target of community assignment (valid for the active vertices only)
+  long* targetCommAss = (long *) phaseAlloc (NV * sizeof(long)); assert(targetCommAss != 0);
+  
+  //Per-thread local maps sized to the max degree (or to the cap) in place of a |V|+2*|E| buffer
+  localMapScratch *scratch = allocLocalMapScratch(nT, NV, maxDegreeOfGraph(vtxPtr, NV), localMapCap);
+  
+  //Initialize each vertex to its own cluster
+  initCommAssOpt(pastCommAss, currCommAss, NV, scratch, vtxPtr, vtxInd, cInfo, constantForSecondTerm, vDegree);
+  
+  //active: vertices to visit in this iteration (marked for the next one during the sweep)
+  //moved : vertices whose target differs from their current community
+  frontierSet *active = allocFrontierSet(NV, nT);
+  frontierSet *moved  = allocFrontierSet(NV, nT);
+#pragma omp parallel for
+  for (long i=0; i<NV; i++) {
+    active->list[i] = i; //Everybody is active in the first iteration
+  }
+  active->num = NV;
+  deltaBuffer *deltaBuf = allocDeltaBuffers(nT, 4096);
+#pragma omp parallel for
+  for (long i=0; i<NV; i++) {
+    clusterWeightInternal[i] = 0;
+  }
+  double e_xx = 0;
+  double a2_x = sumSquaredDegrees(cInfo, NV); //Maintained from the merged deltas
+  
+  time2 = omp_get_wtime();
+  printf("Time to initialize: %3.3lf\n", time2-time1);
+  
+#ifdef PRINT_DETAILED_STATS_
+  printf("==========================================================================================================================\n");
+  printf("Itr      Active       Act-Edges      E_xx            A_x2           Curr-Mod         Time-1(s)       Time-2(s)        T/Itr(s)\n");
+  printf("==========================================================================================================================\n");
+#endif
+#ifdef PRINT_TERSE_STATS_
+  printf("=====================================================================\n");
+  printf("Itr      Active       Curr-Mod         T/Itr(s)      T-Cumulative\n");
+  printf("=====================================================================\n");
+#endif
+  //Start maximizing modularity
+  while(true) {
+    numItrs++;
+    time1 = omp_get_wtime();
+    long numActive = active->num;
+    long *activeList = active->list;
+    long activeEdges = 0;
+    double exxChange = 0;
+    
+#pragma omp parallel num_threads(nT)
+    {
+      int tid = omp_get_thread_num();
+#pragma omp for schedule(dynamic, 256) reduction(+:activeEdges) reduction(+:exxChange)
+      for (long k=0; k<numActive; k++) {
+        long i = activeList[k];
+        long adj1 = vtxPtr[i];
+        long adj2 = vtxPtr[i+1];
+        long selfLoop = 0;
+        long numUniqueClusters = 0;
+        activeEdges += (adj2-adj1);
+        exxChange -= clusterWeightInternal[i]; //Replaced by the new e_ix
+        clusterWeightInternal[i] = 0;
+        if(adj1 != adj2){
+          //Add the current cluster of i to the local map
+          localMapScratch *S = &scratch[tid];
+          mapElement *localMap = acquireLocalMap(S, adj2-adj1); //Local map for i
+          localMap[0].Counter = 0;          //Initialize the counter to ZERO (no edges incident yet)
+          localMap[0].cid = currCommAss[i]; //Initialize with current community
+          numUniqueClusters++; //Added the first entry
+          
+          //Find unique cluster ids and #of edges incident (eicj) to them
+          selfLoop = buildLocalMapCounterScratch(i, localMap, vtxPtr, vtxInd, currCommAss, numUniqueClusters, S);
+          // Update delta Q calculation
+          clusterWeightInternal[i] += localMap[0].Counter; //(e_ix)
+          exxChange += localMap[0].Counter;
+          //Calculate the max
+          targetCommAss[i] = maxLocalMap(localMap, selfLoop, cInfo, vDegree[i], currCommAss[i],
+                                         constantForSecondTerm, numUniqueClusters);
+          releaseLocalMap(S);
+        } else {
+          targetCommAss[i] = -1;
+        }
+        
+        if(targetCommAss[i] != currCommAss[i]) {
+          if(targetCommAss[i] != -1) {
+            addDeltaBuffer(&deltaBuf[tid], targetCommAss[i], 1, vDegree[i]);
+            addDeltaBuffer(&deltaBuf[tid], currCommAss[i], -1, -vDegree[i]);
+          }
+          //i and its neighbors form the frontier of the next iteration
+          markFrontier(moved, i);
+          markFrontier(active, i);
+          for(long j=adj1; j<adj2; j++)
+            markFrontier(active, vtxInd[j].tail);
+        }
+      }//End of for(k)
+    }//End of parallel region
+    time2 = omp_get_wtime();
+    
+    time3 = omp_get_wtime();
+    e_xx += exxChange;
+    if (numItrs % MOD_EXACT_PERIOD == 0) { //Bound the drift
+      e_xx = 0;
+#pragma omp parallel for reduction(+:e_xx)
+      for (long i=0; i<NV; i++) {
+        e_xx += clusterWeightInternal[i];
+      }
+      a2_x = sumSquaredDegrees(cInfo, NV);
+    }
+    time4 = omp_get_wtime();
+    
+    currMod = (e_xx*(double)constantForSecondTerm) - (a2_x*(double)constantForSecondTerm*(double)constantForSecondTerm);
+    totItr = (time2-time1) + (time4-time3);
+    total += totItr;
+#ifdef PRINT_DETAILED_STATS_
+    printf("%d \t %ld \t %ld \t %g \t %g \t %lf \t %3.3lf \t %3.3lf  \t %3.3lf\n",numItrs, numActive, activeEdges,
+           e_xx, a2_x, currMod, (time2-time1), (time4-time3), totItr );
+#endif
+#ifdef PRINT_TERSE_STATS_
+    printf("%d \t %ld \t %lf \t %3.3lf  \t %3.3lf\n",numItrs, numActive, currMod, totItr, total);
+#endif
+    
+    //Break if modularity gain is not sufficient
+    if((currMod - prevMod) < thresMod) {
+      break;
+    }
+    
+    //Else update information for the next iteration
+    time1 = omp_get_wtime();
+    prevMod = currMod;
+    if(prevMod < Lower)
+      prevMod = Lower;
+    double a2Change = 0;
+#pragma omp parallel num_threads(nT) reduction(+:a2Change)
+    {
+      a2Change += mergeDeltaBuffers(deltaBuf, cInfo, NV);
+    }
+    a2_x += a2Change;
+    
+    //pastCommAss <- currCommAss: they differ only where the previous moves were applied
+    if (numItrs == 1) {
+#pragma omp parallel for
+      for (long i=0; i<NV; i++) {
+        pastCommAss[i] = currCommAss[i];
+      }
+    } else {
+#pragma omp parallel for
+      for (long k=0; k<moved->num; k++) {
+        long i = moved->list[k];
+        pastCommAss[i] = currCommAss[i];
+      }
+    }
+    //currCommAss <- targetCommAss for the vertices that moved
+    compactFrontier(moved, nT);
+#pragma omp parallel for
+    for (long k=0; k<moved->num; k++) {
+      long i = moved->list[k];
+      currCommAss[i] = targetCommAss[i];
+    }
+    compactFrontier(active, nT);
+    time2 = omp_get_wtime();
+    total += (time2-time1);
+  }//End of while(true)
+  *totTime = total; //Return back the total time for clustering
+  *numItr  = numItrs;
+  
+#ifdef PRINT_DETAILED_STATS_
+  printf("==========================================================================================================================\n");
+  printf("Total time for %d iterations is: %lf\n",numItrs, total);
+  printf("==========================================================================================================================\n");
+#endif
+#ifdef PRINT_TERSE_STATS_
+  printf("=====================================================================\n");
+  printf("Total time for %d iterations is: %lf\n",numItrs, total);
+  printf("=====================================================================\n");
+#endif
+  
+  //Store back the community assignments in the input variable:
+  //Note: No matter when the while loop exits, we are interested in the previous assignment
+#pragma omp parallel for
+  for (long i=0; i<NV; i++) {
+    C[i] = pastCommAss[i];
+  }
+  //Cleanup
+  phaseFree(pastCommAss);
+  phaseFree(currCommAss);
+  phaseFree(targetCommAss);
+  phaseFree(vDegree);
+  phaseFree(cInfo);
+  phaseFree(clusterWeightInternal);
+  freeFrontierSet(active);
+  freeFrontierSet(moved);
+  freeDeltaBuffers(deltaBuf, nT);
+  freeLocalMapScratch(scratch, nT);
+  
+  return prevMod;
+}//End of parallelLouvianMethodFrontier()
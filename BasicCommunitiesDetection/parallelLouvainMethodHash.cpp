@@ -0,0 +1,261 @@
+// **************************************************************************************************
+// Grappolo: A C++ library for parallel graph community detection
+// Hao Lu, Ananth Kalyanaraman (hao.lu@wsu.edu, ananth@eecs.wsu.edu) Washington State University
+// Mahantesh Halappanavar (hala@pnnl.gov) Pacific Northwest National Laboratory
+//
+// For citation, please cite the following paper:
+// Lu, Hao, Mahantesh Halappanavar, and Ananth Kalyanaraman. 
+// "Parallel heuristics for scalable community detection." Parallel Computing 47 (2015): 19-37.
+//
+// **************************************************************************************************
+// Copyright (c) 2016. Washington State University ("WSU"). All Rights Reserved.
+// Permission to use, copy, modify, and distribute this software and its documentation
+// for educational, research, and not-for-profit purposes, without fee, is hereby
+// granted, provided that the above copyright notice, this paragraph and the following
+// two paragraphs appear in all copies, modifications, and distributions. For
+// commercial licensing opportunities, please contact The Office of Commercialization,
+// WSU, 280/286 Lighty, PB Box 641060, Pullman, WA 99164, (509) 335-5526,
+// commercialization@wsu.edu<mailto:commercialization@wsu.edu>, https://commercialization.wsu.edu/
+
+// IN NO EVENT SHALL WSU BE LIABLE TO ANY PARTY FOR DIRECT, INDIRECT, SPECIAL, INCIDENTAL,
+// OR CONSEQUENTIAL DAMAGES, INCLUDING LOST PROFITS, ARISING OUT OF THE USE OF
+// THIS SOFTWARE AND ITS DOCUMENTATION, EVEN IF WSU HAS BEEN ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+// WSU SPECIFICALLY DISCLAIMS ANY WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. THE SOFTWARE AND
+// ACCOMPANYING DOCUMENTATION, IF ANY, PROVIDED HEREUNDER IS PROVIDED "AS IS". WSU HAS NO
+// OBLIGATION TO PROVIDE MAINTENANCE, SUPPORT, UPDATES, ENHANCEMENTS, OR MODIFICATIONS.
+// **************************************************************************************************
+
+#include "defs.h"
+#include "utilityClusteringFunctions.h"
+#include "basic_comm.h"
+#include "basic_util.h"
+using namespace std;
+
+double parallelLouvianMethodHash(graph *G, long *C, int nThreads, double Lower,
+				double thresh, double *totTime, int *numItr) {
+#ifdef PRINT_DETAILED_STATS_  
+  printf("Within parallelLouvianMethodHash()\n");
+#endif
+  if (nThreads < 1)
+    omp_set_num_threads(1);
+  else
+    omp_set_num_threads(nThreads);
+  int nT;
+#pragma omp parallel
+  {
+    nT = omp_get_num_threads();
+  }
+#ifdef PRINT_DETAILED_STATS_
+  printf("Actual number of threads: %d (requested: %d)\n", nT, nThreads);
+#endif
+  double time1, time2, time3, time4; //For timing purposes  
+  double total = 0, totItr = 0;
+  
+  long    NV        = G->numVertices;
+  long    NS        = G->sVertices;      
+  long    NE        = G->numEdges;
+  long    *vtxPtr   = G->edgeListPtrs;
+  edge    *vtxInd   = G->edgeList;
+ 
+  /* Variables for computing modularity */
+  long totalEdgeWeightTwice;
+  double constantForSecondTerm;
+  double prevMod=-1;
+  double currMod=-1;
+  //double thresMod = 0.000001;
+  double thresMod = thresh; //Input parameter
+  int numItrs = 0;
+  
+  /********************** Initialization **************************/
+  time1 = omp_get_wtime();
+  //Store the degree of all vertices
+  double* vDegree = (double *) phaseAlloc (NV * sizeof(double)); assert(vDegree != 0);
+  //Community info. (ai and size)
+  Comm *cInfo = (Comm *) phaseAlloc (NV * sizeof(Comm)); assert(cInfo != 0);
+  //use for updating Community
+  Comm *cUpdate = (Comm*)phaseAlloc(NV*sizeof(Comm)); assert(cUpdate != 0);
+
+  sumVertexDegree(vtxInd, vtxPtr, vDegree, NV , cInfo);	// Sum up the vertex degree
+  
+  /*** Compute the total edge weight (2m) and 1/2m ***/
+  constantForSecondTerm = calConstantForSecondTerm(vDegree, NV); // 1 over sum of the degree
+
+  //Community assignments:
+  //Store previous iteration's community assignment
+  long* pastCommAss = (long *) phaseAlloc (NV * sizeof(long)); assert(pastCommAss != 0);
+  //Store current community assignment
+  long* currCommAss = (long *) phaseAlloc (NV * sizeof(long)); assert(currCommAss != 0);  
+  //Store the target of community assignment  
+  long* targetCommAss = (long *) phaseAlloc (NV * sizeof(long)); assert(targetCommAss != 0);
+ 
+  //Per-thread scratch in place of maps: sized to the max degree and reused for every vertex
+  long maxDegree = maxDegreeOfGraph(vtxPtr, NV);
+  hashLocalMap *hashMaps  = (hashLocalMap *) malloc (nT * sizeof(hashLocalMap)); assert(hashMaps != 0);
+  mapElement  **localMaps = (mapElement **) malloc (nT * sizeof(mapElement *)); assert(localMaps != 0);
+#pragma omp parallel num_threads(nT)
+  {
+    int tid = omp_get_thread_num();
+    initHashLocalMap(&hashMaps[tid], maxDegree+1); //+1 for the current cluster
+    localMaps[tid] = (mapElement *) phaseAlloc ((maxDegree+1) * sizeof(mapElement)); assert(localMaps[tid] != 0);
+  }
+
+  //Initialize each vertex to its own cluster
+  initCommAss(pastCommAss, currCommAss, NV, vtxPtr); 
+  //Edge-balanced vertex ranges for the sweep (one per thread)
+  long *part = buildEdgePartition(vtxPtr, NV, nT);
+  double *busyTime = (double *) malloc (nT * sizeof(double)); assert(busyTime != 0);
+  for (int t=0; t<nT; t++)
+    busyTime[t] = 0;
+
+  double a2_x = sumSquaredDegrees(cInfo, NV); //Maintained across iterations from the community updates
+  
+  time2 = omp_get_wtime();
+  printf("Time to initialize: %3.3lf\n", time2-time1);
+	
+#ifdef PRINT_DETAILED_STATS_
+  printf("========================================================================================================\n");
+  printf("Itr      E_xx            A_x2           Curr-Mod         Time-1(s)       Time-2(s)        T/Itr(s)\n");
+  printf("========================================================================================================\n");
+#endif
+#ifdef PRINT_TERSE_STATS_
+  printf("=====================================================\n");
+  printf("Itr      Curr-Mod         T/Itr(s)      T-Cumulative\n");
+  printf("=====================================================\n");
+#endif
+  //Start maximizing modularity
+  while(true) {
+    numItrs++;    
+    time1 = omp_get_wtime();
+    /* Re-initialize datastructures */
+#pragma omp parallel for
+    for (long i=0; i<NV; i++) {
+      cUpdate[i].degree =0;
+      cUpdate[i].size =0;
+    }
+    
+    double e_xx = 0; //Sum of the e_ix found by the sweep
+#pragma omp parallel num_threads(nT) reduction(+:e_xx)
+  {
+    int tid = omp_get_thread_num();
+    double startTime = omp_get_wtime();
+    for (long i=part[tid]; i<part[tid+1]; i++) {
+      long adj1 = vtxPtr[i];
+      long adj2 = vtxPtr[i+1];
+      double selfLoop = 0;
+      long numUniqueClusters = 0;
+      if(adj1 != adj2){
+        mapElement *localMap = localMaps[tid];
+        //Add the current cluster of i to the local map
+        localMap[0].cid     = currCommAss[i];
+        localMap[0].Counter = 0; //Initialize the counter to ZERO (no edges incident yet)
+        numUniqueClusters++;
+        //Find unique cluster ids and #of edges incident (eicj) to them
+        selfLoop = buildLocalMapCounterHash(i, localMap, vtxPtr, vtxInd, currCommAss, numUniqueClusters, &hashMaps[tid]);
+        // Update delta Q calculation
+        e_xx += localMap[0].Counter; //(e_ix)
+        //Calculate the max
+        targetCommAss[i] = maxLocalMap(localMap, selfLoop, cInfo, vDegree[i], currCommAss[i], constantForSecondTerm, numUniqueClusters);
+      } else {
+        targetCommAss[i] = -1;
+      }
+
+      //Update
+      if(targetCommAss[i] != currCommAss[i]  && targetCommAss[i] != -1) {
+        #pragma omp atomic update
+        cUpdate[targetCommAss[i]].degree += vDegree[i];
+        #pragma omp atomic update
+        cUpdate[targetCommAss[i]].size += 1;
+        #pragma omp atomic update
+        cUpdate[currCommAss[i]].degree -= vDegree[i];
+        #pragma omp atomic update
+        cUpdate[currCommAss[i]].size -=1;
+      }//End of If()
+    }//End of for(i)
+    busyTime[tid] += omp_get_wtime() - startTime;
+  }//End of parallel region
+    time2 = omp_get_wtime();
+ 
+    time3 = omp_get_wtime();
+    //e_xx comes from the sweep; a2_x is maintained from the community updates
+    if (numItrs % MOD_EXACT_PERIOD == 0)
+      a2_x = sumSquaredDegrees(cInfo, NV); //Bound the drift
+    time4 = omp_get_wtime();
+
+    currMod = (e_xx*(double)constantForSecondTerm) - (a2_x*(double)constantForSecondTerm*(double)constantForSecondTerm);
+    totItr = (time2-time1) + (time4-time3);
+    total += totItr;
+#ifdef PRINT_DETAILED_STATS_
+    printf("%d \t %g \t %g \t %lf \t %3.3lf \t %3.3lf  \t %3.3lf\n",numItrs, e_xx, a2_x, currMod, (time2-time1), (time4-time3), totItr );
+#endif
+#ifdef PRINT_TERSE_STATS_
+   printf("%d \t %lf \t %3.3lf  \t %3.3lf\n",numItrs, currMod, totItr, total);
+#endif
+ 
+    //Break if modularity gain is not sufficient
+    if((currMod - prevMod) < thresMod) {
+      break;
+    }
+    
+    //Else update information for the next iteration
+    prevMod = currMod;
+    if(prevMod < Lower)
+	prevMod = Lower;
+    double a2Change = 0;
+#pragma omp parallel for reduction(+:a2Change)
+    for (long i=0; i<NV; i++) {
+      a2Change += cUpdate[i].degree*(2*cInfo[i].degree + cUpdate[i].degree); //(a+d)^2 - a^2
+      cInfo[i].size += cUpdate[i].size;
+      cInfo[i].degree += cUpdate[i].degree;
+    }
+    a2_x += a2Change;
+    
+    //Do pointer swaps to reuse memory:
+    long* tmp;
+    tmp = pastCommAss;
+    pastCommAss = currCommAss; //Previous holds the current
+    currCommAss = targetCommAss; //Current holds the chosen assignment
+    targetCommAss = tmp;      //Reuse the vector
+    
+  }//End of while(true)
+  *totTime = total; //Return back the total time for clustering
+  *numItr  = numItrs;
+
+#ifdef PRINT_DETAILED_STATS_
+  printf("========================================================================================================\n");
+  printf("Total time for %d iterations is: %lf\n",numItrs, total);  
+  printf("========================================================================================================\n");
+#endif  
+#ifdef PRINT_TERSE_STATS_
+  printf("========================================================================================================\n");
+  printf("Total time for %d iterations is: %lf\n",numItrs, total);  
+  printf("========================================================================================================\n");
+#endif
+
+  //Store back the community assignments in the input variable:
+  //Note: No matter when the while loop exits, we are interested in the previous assignment
+#pragma omp parallel for 
+  for (long i=0; i<NV; i++) {
+    C[i] = pastCommAss[i];
+  }
+  //Cleanup
+  phaseFree(pastCommAss);
+  phaseFree(currCommAss);
+  phaseFree(targetCommAss);
+  phaseFree(vDegree);
+  phaseFree(cInfo);
+  phaseFree(cUpdate);
+  reportThreadBusyTime(busyTime, nT);
+  free(busyTime);
+  free(part);
+  for (int t=0; t<nT; t++) {
+    freeHashLocalMap(&hashMaps[t]);
+    phaseFree(localMaps[t]);
+  }
+  free(hashMaps);
+  free(localMaps);
+
+  return prevMod;
+}
@@ -31,11 +31,12 @@
 #include "defs.h"
 #include "basic_comm.h"
 #include "utilityClusteringFunctions.h"
+#include "basic_util.h"
 
 using namespace std;
 
 double parallelLouvianMethodNoMap(graph *G, long *C, int nThreads, double Lower,
-				double thresh, double *totTime, int *numItr) {
+				double thresh, double *totTime, int *numItr, long localMapCap, long hubThreshold, bool atomicUpdates) {
 #ifdef PRINT_DETAILED_STATS_  
   printf("Within parallelLouvianMethodNoMap()\n");
 #endif
@@ -72,13 +73,11 @@ double parallelLouvianMethodNoMap(graph *G, long *C, int nThreads, double Lower,
   /********************** Initialization **************************/
   time1 = omp_get_wtime();
   //Store the degree of all vertices
-  double* vDegree = (double *) malloc (NV * sizeof(double)); assert(vDegree != 0);
+  double* vDegree = (double *) phaseAlloc (NV * sizeof(double)); assert(vDegree != 0);
   //Community info. (ai and size)
-  Comm *cInfo = (Comm *) malloc (NV * sizeof(Comm)); assert(cInfo != 0);
+  Comm *cInfo = (Comm *) phaseAlloc (NV * sizeof(Comm)); assert(cInfo != 0);
   //use for updating Community
-  Comm *cUpdate = (Comm*)malloc(NV*sizeof(Comm)); assert(cUpdate != 0);
-  //use for Modularity calculation (eii)
-  double* clusterWeightInternal = (double*) malloc (NV*sizeof(double)); assert(clusterWeightInternal != 0);
+  Comm *cUpdate = (Comm*)phaseAlloc(NV*sizeof(Comm)); assert(cUpdate != 0);
 
   sumVertexDegree(vtxInd, vtxPtr, vDegree, NV , cInfo);	// Sum up the vertex degree
   
@@ -87,19 +86,37 @@ double parallelLouvianMethodNoMap(graph *G, long *C, int nThreads, double Lower,
   
   //Community assignments:
   //Store previous iteration's community assignment
-  long* pastCommAss = (long *) malloc (NV * sizeof(long)); assert(pastCommAss != 0);
+  long* pastCommAss = (long *) phaseAlloc (NV * sizeof(long)); assert(pastCommAss != 0);
   //Store current community assignment
-  long* currCommAss = (long *) malloc (NV * sizeof(long)); assert(currCommAss != 0);  
+  long* currCommAss = (long *) phaseAlloc (NV * sizeof(long)); assert(currCommAss != 0);  
   //Store the target of community assignment  
-  long* targetCommAss = (long *) malloc (NV * sizeof(long)); assert(targetCommAss != 0);
+  long* targetCommAss = (long *) phaseAlloc (NV * sizeof(long)); assert(targetCommAss != 0);
     
-  //Vectors used in place of maps: Total size = |V|+2*|E| -- The |V| part takes care of self loop
-  mapElement* clusterLocalMap = (mapElement *) malloc ((NV + 2*NE) * sizeof(mapElement)); assert(clusterLocalMap != 0);
+  //Per-thread local maps sized to the max degree (or to the cap) in place of a |V|+2*|E| buffer
+  localMapScratch *scratch = allocLocalMapScratch(nT, NV, maxDegreeOfGraph(vtxPtr, NV), localMapCap);
   //double* Counter             = (double *)     malloc ((NV + 2*NE) * sizeof(double));     assert(Counter != 0);
  
   //Initialize each vertex to its own cluster
 //  initCommAss(pastCommAss, currCommAss, NV); 
-  initCommAssOpt(pastCommAss, currCommAss, NV, clusterLocalMap, vtxPtr, vtxInd, cInfo, constantForSecondTerm, vDegree);
+  initCommAssOpt(pastCommAss, currCommAss, NV, scratch, vtxPtr, vtxInd, cInfo, constantForSecondTerm, vDegree);
+
+  //Degree-aware schedule of the sweep: edge-balanced chunks, hubs split across threads
+  hybridSchedule sched;
+  buildHybridSchedule(&sched, 0, NV, vtxPtr, hubThreshold, nT);
+  hubScratch *hubWork = 0;
+  if (sched.numHubs > 0) {
+    hubWork = allocHubScratch(nT, maxHubDegree(&sched, vtxPtr));
+    printf("Hybrid schedule: %ld hubs (degree > %ld) processed by all threads\n", sched.numHubs, hubThreshold);
+  }
+  //Community updates: per-thread delta buffers unless the atomic fallback is requested
+  deltaBuffer *deltaBuf = 0;
+  if (!atomicUpdates)
+    deltaBuf = allocDeltaBuffers(nT, 4096);
+  double *busyTime = (double *) malloc (nT * sizeof(double)); assert(busyTime != 0);
+  for (int t=0; t<nT; t++)
+    busyTime[t] = 0;
+  
+  double a2_x = sumSquaredDegrees(cInfo, NV); //Maintained across iterations from the community updates
   
   time2 = omp_get_wtime();
   printf("Time to initialize: %3.3lf\n", time2-time1);
@@ -121,13 +138,17 @@ double parallelLouvianMethodNoMap(graph *G, long *C, int nThreads, double Lower,
     /* Re-initialize datastructures */
 #pragma omp parallel for
     for (long i=0; i<NV; i++) {
-      clusterWeightInternal[i] = 0; 
       cUpdate[i].degree =0;
       cUpdate[i].size =0;
     }
     
-#pragma omp parallel for
-    for (long i=0; i<NV; i++) {
+    double e_xx = 0; //Sum of the e_ix found by the sweep
+#pragma omp parallel num_threads(nT) reduction(+:e_xx)
+    {
+      int tid = omp_get_thread_num();
+      double lightStartTime = omp_get_wtime();
+      for (long k=sched.lightStart[tid]; k<sched.lightStart[tid+1]; k++) {
+      long i = (sched.light != 0) ? sched.light[k] : k;
       long adj1 = vtxPtr[i];
       long adj2 = vtxPtr[i+1];
       long selfLoop = 0;
@@ -139,18 +160,20 @@ double parallelLouvianMethodNoMap(graph *G, long *C, int nThreads, double Lower,
 	    //Add v's current cluster:
 	    if(adj1 != adj2){
         //Add the current cluster of i to the local map
-        long sPosition = vtxPtr[i]+i; //Starting position of local map for i
-        clusterLocalMap[sPosition].Counter = 0;          //Initialize the counter to ZERO (no edges incident yet)
-        clusterLocalMap[sPosition].cid = currCommAss[i]; //Initialize with current community
+        localMapScratch *S = &scratch[omp_get_thread_num()];
+        mapElement *localMap = acquireLocalMap(S, adj2-adj1); //Local map for i
+        localMap[0].Counter = 0;          //Initialize the counter to ZERO (no edges incident yet)
+        localMap[0].cid = currCommAss[i]; //Initialize with current community
         numUniqueClusters++; //Added the first entry
           
 	      //Find unique cluster ids and #of edges incident (eicj) to them
-        selfLoop = buildLocalMapCounterNoMap(i, clusterLocalMap, vtxPtr, vtxInd, currCommAss, numUniqueClusters);
+        selfLoop = buildLocalMapCounterScratch(i, localMap, vtxPtr, vtxInd, currCommAss, numUniqueClusters, S);
 	      // Update delta Q calculation
-	      clusterWeightInternal[i] += clusterLocalMap[sPosition].Counter; //(e_ix)
+	      e_xx += localMap[0].Counter; //(e_ix)
 	      //Calculate the max
-	      targetCommAss[i] = maxNoMap(i, clusterLocalMap, vtxPtr, selfLoop, cInfo, vDegree[i], currCommAss[i],
+	      targetCommAss[i] = maxLocalMap(localMap, selfLoop, cInfo, vDegree[i], currCommAss[i],
                                       constantForSecondTerm, numUniqueClusters);
+	      releaseLocalMap(S);
               //assert((targetCommAss[i] >= 0)&&(targetCommAss[i] < NV));
       } else {
 		    targetCommAss[i] = -1;	
@@ -159,14 +182,19 @@ double parallelLouvianMethodNoMap(graph *G, long *C, int nThreads, double Lower,
        //Update
       if(targetCommAss[i] != currCommAss[i]  && targetCommAss[i] != -1) {
         
-	    	#pragma omp atomic update
-	    	cUpdate[targetCommAss[i]].degree += vDegree[i];
-	    	#pragma omp atomic update
-	    	cUpdate[targetCommAss[i]].size += 1;
-	    	#pragma omp atomic update
-	    	cUpdate[currCommAss[i]].degree -= vDegree[i];
-	    	#pragma omp atomic update
-	    	cUpdate[currCommAss[i]].size -=1;
+	    	if (deltaBuf != 0) { //Per-thread buffers, merged after the sweep
+	    		addDeltaBuffer(&deltaBuf[tid], targetCommAss[i], 1, vDegree[i]);
+	    		addDeltaBuffer(&deltaBuf[tid], currCommAss[i], -1, -vDegree[i]);
+	    	} else {
+		    	#pragma omp atomic update
+		    	cUpdate[targetCommAss[i]].degree += vDegree[i];
+		    	#pragma omp atomic update
+		    	cUpdate[targetCommAss[i]].size += 1;
+		    	#pragma omp atomic update
+		    	cUpdate[currCommAss[i]].degree -= vDegree[i];
+		    	#pragma omp atomic update
+		    	cUpdate[currCommAss[i]].size -=1;
+	    	}
 
 
 /*	      __sync_fetch_and_add(&cUpdate[targetCommAss[i]].degree, vDegree[i]);
@@ -175,19 +203,46 @@ double parallelLouvianMethodNoMap(graph *G, long *C, int nThreads, double Lower,
 	      __sync_fetch_and_sub(&cUpdate[currCommAss[i]].size, 1);*/
       }//End of If()      
         //numClustSize = 0;
-    }//End of for(i)
+    }//End of for(k)
+      busyTime[tid] += omp_get_wtime() - lightStartTime;
+
+      //Hubs: all threads work together on one vertex at a time
+      for (long h=0; h<sched.numHubs; h++) {
+        long i = sched.hubs[h];
+        double hubStartTime = omp_get_wtime();
+        double eix = 0;
+        long target = maxHubParallel(i, vtxPtr, vtxInd, currCommAss, cInfo, vDegree[i],
+                                     constantForSecondTerm, hubWork, &eix, 0);
+        busyTime[tid] += omp_get_wtime() - hubStartTime;
+        if (tid == 0) {
+          targetCommAss[i] = target;
+          e_xx += eix; //(e_ix)
+          if(target != currCommAss[i]) {
+            if (deltaBuf != 0) { //Per-thread buffers, merged after the sweep
+              addDeltaBuffer(&deltaBuf[tid], target, 1, vDegree[i]);
+              addDeltaBuffer(&deltaBuf[tid], currCommAss[i], -1, -vDegree[i]);
+            } else {
+              #pragma omp atomic update
+              cUpdate[target].degree += vDegree[i];
+              #pragma omp atomic update
+              cUpdate[target].size += 1;
+              #pragma omp atomic update
+              cUpdate[currCommAss[i]].degree -= vDegree[i];
+              #pragma omp atomic update
+              cUpdate[currCommAss[i]].size -=1;
+            }
+          }
+        }
+      }//End of for(h)
+      if (deltaBuf != 0)
+        mergeDeltaBuffers(deltaBuf, cUpdate, NV);
+    }//End of parallel region
     time2 = omp_get_wtime();
  
-    time3 = omp_get_wtime();    
-    double e_xx = 0;
-    double a2_x = 0;	
-
-#pragma omp parallel for \
-  reduction(+:e_xx) reduction(+:a2_x)
-    for (long i=0; i<NV; i++) {
-      e_xx += clusterWeightInternal[i];
-      a2_x += (cInfo[i].degree)*(cInfo[i].degree);
-    }
+    time3 = omp_get_wtime();
+    //e_xx comes from the sweep; a2_x is maintained from the community updates
+    if (numItrs % MOD_EXACT_PERIOD == 0)
+      a2_x = sumSquaredDegrees(cInfo, NV); //Bound the drift
     time4 = omp_get_wtime();
 
     currMod = (e_xx*(double)constantForSecondTerm) - (a2_x*(double)constantForSecondTerm*(double)constantForSecondTerm);
@@ -209,11 +264,14 @@ double parallelLouvianMethodNoMap(graph *G, long *C, int nThreads, double Lower,
     prevMod = currMod;
     if(prevMod < Lower)
 	prevMod = Lower;
-#pragma omp parallel for 
+    double a2Change = 0;
+#pragma omp parallel for reduction(+:a2Change)
     for (long i=0; i<NV; i++) {
+      a2Change += cUpdate[i].degree*(2*cInfo[i].degree + cUpdate[i].degree); //(a+d)^2 - a^2
       cInfo[i].size += cUpdate[i].size;
       cInfo[i].degree += cUpdate[i].degree;
     }
+    a2_x += a2Change;
     
     //Do pointer swaps to reuse memory:
     long* tmp;
@@ -244,14 +302,20 @@ double parallelLouvianMethodNoMap(graph *G, long *C, int nThreads, double Lower,
     C[i] = pastCommAss[i];
   }
   //Cleanup
-  free(pastCommAss);
-  free(currCommAss);
-  free(targetCommAss);
-  free(vDegree);
-  free(cInfo);
-  free(cUpdate);
-  free(clusterWeightInternal);
-  free(clusterLocalMap);
+  phaseFree(pastCommAss);
+  phaseFree(currCommAss);
+  phaseFree(targetCommAss);
+  phaseFree(vDegree);
+  phaseFree(cInfo);
+  phaseFree(cUpdate);
+  reportThreadBusyTime(busyTime, nT);
+  free(busyTime);
+  if (deltaBuf != 0)
+    freeDeltaBuffers(deltaBuf, nT);
+  freeHybridSchedule(&sched);
+  if (hubWork != 0)
+    freeHubScratch(hubWork, nT);
+  freeLocalMapScratch(scratch, nT);
 
   return prevMod;
 }
@@ -30,6 +30,7 @@
 
 #include "defs.h"
 #include "utilityClusteringFunctions.h"
+#include "basic_util.h"
 using namespace std;
 
 double parallelLouvianMethodScale(graph *G, long *C, int nThreads, double Lower, 
@@ -70,20 +71,15 @@ double parallelLouvianMethodScale(graph *G, long *C, int nThreads, double Lower,
   /********************** Initialization **************************/
   time1 = omp_get_wtime();
   //Store the degree of all vertices
-  double* vDegree = (double *) malloc (NV * sizeof(double)); assert(vDegree != 0);
+  double* vDegree = (double *) phaseAlloc (NV * sizeof(double)); assert(vDegree != 0);
   //Community info. (ai and size)
-  Comm *cInfo = (Comm *) malloc (NV * sizeof(Comm)); assert(cInfo != 0);
+  Comm *cInfo = (Comm *) phaseAlloc (NV * sizeof(Comm)); assert(cInfo != 0);
   //use for updating Community
   //Comm *cUpdate = (Comm*)malloc(NV*sizeof(Comm)); assert(cUpdate != 0);
-  vector< map<long, Comm> > cUpdate(nT*nT);
-  long blkSize = (NV+nT)/ nT;
- // for(int i = 0; i<nT; i++){
- //   cUpdate[i].resize(nT);
- // }
+  //Per-thread delta tables, merged by owner range (replaces the nT*nT maps)
+  deltaBuffer *deltaBuf = allocDeltaBuffers(nT, 4096);
 
   
-  //use for Modularity calculation (eii)
-  double* clusterWeightInternal = (double*) malloc (NV*sizeof(double)); assert(clusterWeightInternal != 0);
 
   sumVertexDegree(vtxInd, vtxPtr, vDegree, NV , cInfo);	// Sum up the vertex degree
   
@@ -93,11 +89,11 @@ double parallelLouvianMethodScale(graph *G, long *C, int nThreads, double Lower,
   cout<<"CHECK THIS:              "<<constantForSecondTerm<<endl;
   //Community assignments:
   //Store previous iteration's community assignment
-  long* pastCommAss = (long *) malloc (NV * sizeof(long)); assert(pastCommAss != 0);
+  long* pastCommAss = (long *) phaseAlloc (NV * sizeof(long)); assert(pastCommAss != 0);
   //Store current community assignment
-  long* currCommAss = (long *) malloc (NV * sizeof(long)); assert(currCommAss != 0);  
+  long* currCommAss = (long *) phaseAlloc (NV * sizeof(long)); assert(currCommAss != 0);  
   //Store the target of community assignment  
-  long* targetCommAss = (long *) malloc (NV * sizeof(long)); assert(targetCommAss != 0);
+  long* targetCommAss = (long *) phaseAlloc (NV * sizeof(long)); assert(targetCommAss != 0);
  
 //Vectors used in place of maps: Total size = |V|+2*|E| -- The |V| part takes care of self loop
 //  mapElement* clusterLocalMapX = (mapElement *) malloc ((NV + 2*NE) * sizeof(mapElement)); assert(clusterLocalMapX != 0);
@@ -107,8 +103,12 @@ double parallelLouvianMethodScale(graph *G, long *C, int nThreads, double Lower,
   //initCommAssOpt(pastCommAss, currCommAss, NV, clusterLocalMapX, vtxPtr, vtxInd, cInfo, constantForSecondTerm, vDegree);
   
   //Initialize each vertex to its own cluster
-  initCommAss(pastCommAss, currCommAss, NV); 
+  initCommAss(pastCommAss, currCommAss, NV, vtxPtr); 
+  //Edge-balanced vertex ranges for the sweep (one per thread)
+  long *part = buildEdgePartition(vtxPtr, NV, nT);
 
+  double a2_x = sumSquaredDegrees(cInfo, NV); //Maintained across iterations from the community updates
+  
   time2 = omp_get_wtime();
   printf("Time to initialize: %3.3lf\n", time2-time1);
 	
@@ -127,32 +127,12 @@ double parallelLouvianMethodScale(graph *G, long *C, int nThreads, double Lower,
     numItrs++;    
     time1 = omp_get_wtime();
     /* Re-initialize datastructures */
-#pragma omp parallel
+    double e_xx = 0; //Sum of the e_ix found by the sweep
+#pragma omp parallel num_threads(nT) reduction(+:e_xx)
 {
- 
-#pragma omp for
-    for (long i=0; i<NV; i++) {
-      clusterWeightInternal[i] = 0; 
-    }
-#pragma omp for
-    for (long i = 0; i<nT*nT; i++){
-        map<long, Comm>::iterator it = cUpdate[i].begin();
-        while(it != cUpdate[i].end())
-        {
-          it->second.size = 0;
-          it->second.degree = 0;
-    //      printf("%u",it);
-          it++;
-        }
-  //      printf("%d",i);
-    }
-
-//    printf("END CLEAN\n");
     int meT = omp_get_thread_num();
-    int myMap = meT*nT;
 
-    #pragma omp for
-    for (long i=0; i<NV; i++) {
+    for (long i=part[meT]; i<part[meT+1]; i++) {
 
       long adj1 = vtxPtr[i];
       long adj2 = vtxPtr[i+1];
@@ -168,7 +148,7 @@ double parallelLouvianMethodScale(graph *G, long *C, int nThreads, double Lower,
 	      //Find unique cluster ids and #of edges incident (eicj) to them
 	      selfLoop = buildLocalMapCounter(adj1, adj2, clusterLocalMap, Counter, vtxInd, currCommAss, i);
 	      // Update delta Q calculation
-	      clusterWeightInternal[i] += Counter[0]; //(e_ix)
+	      e_xx += Counter[0]; //(e_ix)
 	      //Calculate the max
 	      targetCommAss[i] = max(clusterLocalMap, Counter, selfLoop, cInfo, vDegree[i], currCommAss[i], constantForSecondTerm);
               //assert((targetCommAss[i] >= 0)&&(targetCommAss[i] < NV));
@@ -178,22 +158,8 @@ double parallelLouvianMethodScale(graph *G, long *C, int nThreads, double Lower,
 
         //Update
         if(targetCommAss[i] != currCommAss[i]  && targetCommAss[i] != -1) {
-          int owner1 = currCommAss[i] / blkSize + myMap;
-          int owner2 = targetCommAss[i]/ blkSize + myMap;
-          
-          map<long,Comm>::iterator it = cUpdate[owner1].find(currCommAss[i]);
-          if(it == cUpdate[owner1].end()){
-            it = cUpdate[owner1].insert(std::make_pair(currCommAss[i],Comm())).first;
-          }
-          it->second.size -=1;
-          it->second.degree-=vDegree[i];
-          
-          it = cUpdate[owner2].find(targetCommAss[i]);
-          if(it == cUpdate[owner2].end()){
-            it = cUpdate[owner2].insert(std::make_pair(targetCommAss[i],Comm())).first;
-          }
-          it->second.size +=1;
-          it->second.degree+=vDegree[i];
+          addDeltaBuffer(&deltaBuf[meT], currCommAss[i], -1, -vDegree[i]);
+          addDeltaBuffer(&deltaBuf[meT], targetCommAss[i], 1, vDegree[i]);
           
           /*#pragma omp atomic update
 	        cUpdate[targetCommAss[i]].degree += vDegree[i];
@@ -214,16 +180,10 @@ double parallelLouvianMethodScale(graph *G, long *C, int nThreads, double Lower,
   }
     time2 = omp_get_wtime();
  
-    time3 = omp_get_wtime();    
-    double e_xx = 0;
-    double a2_x = 0;	
-
-#pragma omp parallel for \
-  reduction(+:e_xx) reduction(+:a2_x)
-    for (long i=0; i<NV; i++) {
-      e_xx += clusterWeightInternal[i];
-      a2_x += (cInfo[i].degree)*(cInfo[i].degree);
-    }
+    time3 = omp_get_wtime();
+    //e_xx comes from the sweep; a2_x is maintained from the community updates
+    if (numItrs % MOD_EXACT_PERIOD == 0)
+      a2_x = sumSquaredDegrees(cInfo, NV); //Bound the drift
     time4 = omp_get_wtime();
 
     currMod = (e_xx*(double)constantForSecondTerm) - (a2_x*(double)constantForSecondTerm*(double)constantForSecondTerm);
@@ -245,26 +205,13 @@ double parallelLouvianMethodScale(graph *G, long *C, int nThreads, double Lower,
     prevMod = currMod;
     if(prevMod < Lower)
 	prevMod = Lower;
-#pragma omp parallel for 
-    for (long i=0; i<nT; i++) {
-      map<long,Comm>::iterator it;
-      for( long j =0; j<nT;j++){
-        int where = i+j*nT;
-        map<long,Comm>::iterator it = cUpdate[where].begin();
-        while(it != cUpdate[where].end())
-        {
-            if(it->second.size != 0 || it->second.degree != 0){
-              cInfo[it->first].size += it->second.size;
-              cInfo[it->first].degree += it->second.degree;
-              }
-            it++;
-
-        }
-      }
-
-//    cInfo[i].size += cUpdate[i].size;
-//    cInfo[i].degree += cUpdate[i].degree;
+    //Each owner applies the deltas of its community range; the buffers are emptied for the next sweep
+    double a2Change = 0;
+#pragma omp parallel num_threads(nT) reduction(+:a2Change)
+    {
+      a2Change += mergeDeltaBuffers(deltaBuf, cInfo, NV);
     }
+    a2_x += a2Change;
     
     //Do pointer swaps to reuse memory:
     long* tmp;
@@ -295,18 +242,13 @@ double parallelLouvianMethodScale(graph *G, long *C, int nThreads, double Lower,
     C[i] = pastCommAss[i];
   }
   //Cleanup
-  free(pastCommAss);
-  free(currCommAss);
-  free(targetCommAss);
-  free(vDegree);
-  free(cInfo);
-//  free(cUpdate);
-  free(clusterWeightInternal);
-
-  #pragma omp parallel for
-  for (long i = 0; i<nT*nT; i++){
-      cUpdate[i].clear();
-  }
+  phaseFree(pastCommAss);
+  phaseFree(currCommAss);
+  phaseFree(targetCommAss);
+  phaseFree(vDegree);
+  phaseFree(cInfo);
+  free(part);
+  freeDeltaBuffers(deltaBuf, nT);
 
   return prevMod;
 }
@@ -31,6 +31,7 @@
 #include "defs.h"
 #include "basic_comm.h"
 #include "basic_util.h"
+#include "input_output.h"
 
 using namespace std;
 //WARNING: This will overwrite the original graph data structure to
@@ -39,12 +40,18 @@ using namespace std;
 //         Assume C_orig is initialized appropriately
 //WARNING: Graph G will be destroyed at the end of this routine
 void runMultiPhaseBasic(graph *G, long *C_orig, int basicOpt, long minGraphSize,
-                        double threshold, double C_threshold, int numThreads, int threadsOpt)
+                        double threshold, double C_threshold, runtimeContext *ctx, int threadsOpt, long localMapCap, long hubThreshold,
+                        bool atomicUpdates)
 {
     double totTimeClustering=0, totTimeBuildingPhase=0, totTimeColoring=0, tmpTime=0;
     int tmpItr=0, totItr = 0;
     long NV = G->numVertices;
+    int numThreads = ctx->nT;
     
+    if(basicOpt == 3){ //Compact graph with index/weight types picked from its size
+        runMultiPhaseCompact(G, C_orig, threshold, ctx, localMapCap, hubThreshold, atomicUpdates);
+        return;
+    }
     
     /* Step 1: Find communities */
     double prevMod = -1;
@@ -53,6 +60,9 @@ void runMultiPhaseBasic(graph *G, long *C_orig, int basicOpt, long minGraphSize,
     
     graph *Gnew; //To build new hierarchical graphs
     long numClusters;
+    //Scratch for every sweep and coarsening step, sized from this (largest) graph
+    createPhaseArena(G, numThreads, (basicOpt == 2));
+    //C is sized for phase 1 and reused by the smaller graphs of later phases
     long *C = (long *) malloc (NV * sizeof(long));
     assert(C != 0);
 #pragma omp parallel for
@@ -60,17 +70,25 @@ void runMultiPhaseBasic(graph *G, long *C_orig, int basicOpt, long minGraphSize,
         C[i] = -1;
     }
     
+    clusterHierarchy *H = createClusterHierarchy(); //Maps of phases 2, 3, ...
+    resetPeakRSS(); //Per-phase peaks, the peak of loading is in the summary
     while(1){
         printf("===============================\n");
         printf("Phase %ld\n", phase);
         printf("===============================\n");
+        bindRuntimeContext(ctx, G); //Team size and partition for this graph
+        numThreads = ctx->active;
         prevMod = currMod;
         
         
         if(basicOpt == 1){
-            currMod = parallelLouvianMethodNoMap(G, C, numThreads, currMod, threshold, &tmpTime, &tmpItr);
+            currMod = parallelLouvianMethodNoMap(G, C, numThreads, currMod, threshold, &tmpTime, &tmpItr, localMapCap, hubThreshold, atomicUpdates);
+        }else if(basicOpt == 4){
+            currMod = parallelLouvianMethodFrontier(G, C, numThreads, currMod, threshold, &tmpTime, &tmpItr, localMapCap);
+        }else if(basicOpt == 2){
+            currMod = parallelLouvianMethodHash(G, C, numThreads, currMod, threshold, &tmpTime, &tmpItr);
         }else if(threadsOpt == 1){
-            currMod = parallelLouvianMethod(G, C, numThreads, currMod, threshold, &tmpTime, &tmpItr);
+            currMod = parallelLouvianMethod(G, C, ctx, currMod, threshold, &tmpTime, &tmpItr, hubThreshold, atomicUpdates);
         }else{
             currMod = parallelLouvianMethodScale(G, C, numThreads, currMod, threshold, &tmpTime, &tmpItr);
         }
@@ -79,8 +97,9 @@ void runMultiPhaseBasic(graph *G, long *C_orig, int basicOpt, long minGraphSize,
         totItr += tmpItr;
         
         //Renumber the clusters contiguiously
-        numClusters = renumberClustersContiguously(C, G->numVertices);
+        numClusters = renumberClusters(G, C);
         printf("Number of unique clusters: %ld\n", numClusters);
+        addDendrogramLevel(C, G->numVertices, numClusters); //Written while the next phase runs (-w)
         
         //printf("About to update C_orig\n");
         //Keep track of clusters in C_orig
@@ -90,12 +109,7 @@ void runMultiPhaseBasic(graph *G, long *C_orig, int basicOpt, long minGraphSize,
                 C_orig[i] = C[i]; //After the first phase
             }
         } else {
-#pragma omp parallel for
-            for (long i=0; i<NV; i++) {
-                assert(C_orig[i] < G->numVertices);
-                if (C_orig[i] >=0)
-                    C_orig[i] = C[C_orig[i]]; //Each cluster in a previous phase becomes a vertex
-            }
+            pushClusterLevel(H, C, G->numVertices); //Composed into C_orig after the last phase
         }
         printf("Done updating C_orig\n");
         
@@ -107,6 +121,8 @@ void runMultiPhaseBasic(graph *G, long *C_orig, int basicOpt, long minGraphSize,
         //Check for modularity gain and build the graph for next phase
         //In case coloring is used, make sure the non-coloring routine is run at least once
         if( (currMod - prevMod) > threshold ) {
+            long sweepPeak = getPhasePeakRSS(); //Louvain sweep of this phase
+            resetPeakRSS();
             Gnew = (graph *) malloc (sizeof(graph)); assert(Gnew != 0);
             tmpTime =  buildNextLevelGraphOpt(G, Gnew, C, numClusters, numThreads);
             totTimeBuildingPhase += tmpTime;
@@ -117,26 +133,32 @@ void runMultiPhaseBasic(graph *G, long *C_orig, int basicOpt, long minGraphSize,
             G = Gnew; //Swap the pointers
             G->edgeListPtrs = Gnew->edgeListPtrs;
             G->edgeList = Gnew->edgeList;
-            
-            //Free up the previous cluster & create new one of a different size
-            free(C);
-            C = (long *) malloc (numClusters * sizeof(long)); assert(C != 0);
+            placeGraph(G, numThreads); //NUMA placement of the new graph (-n)
+            reportNumaLocality(G, numThreads);
             
 #pragma omp parallel for
             for (long i=0; i<numClusters; i++) {
                 C[i] = -1;
             }
+            reportPhaseArena(phase); //Sweep and coarsening of this phase
+            printf("Phase %ld memory (KB): peak RSS %ld in the sweep, %ld while coarsening, %ld after\n",
+                   phase, sweepPeak, getPhasePeakRSS(), getCurrentRSS());
+            resetPeakRSS();
             phase++; //Increment phase number
         }else {
             break; //Modularity gain is not enough. Exit.
         }
         
     } //End of while(1)
+    composeClusterHierarchy(H, C_orig, NV);
+    destroyClusterHierarchy(H);
+    reportPhaseArena(phase);
+    printf("Phase %ld memory (KB): peak RSS %ld in the sweep\n", phase, getPhasePeakRSS());
     
     printf("********************************************\n");
     printf("*********    Compact Summary   *************\n");
     printf("********************************************\n");
-    printf("Number of threads              : %ld\n", numThreads);
+    printf("Number of threads              : %ld\n", ctx->nT);
     printf("Total number of phases         : %ld\n", phase);
     printf("Total number of iterations     : %ld\n", totItr);
     printf("Final number of clusters       : %ld\n", numClusters);
@@ -145,10 +167,12 @@ void runMultiPhaseBasic(graph *G, long *C_orig, int basicOpt, long minGraphSize,
     printf("Total time for building phases : %lf\n", totTimeBuildingPhase);
     printf("********************************************\n");
     printf("TOTAL TIME                     : %lf\n", (totTimeClustering+totTimeBuildingPhase+totTimeColoring) );
+    printf("Peak memory (RSS, KB)          : %ld\n", getPeakRSS());
     printf("********************************************\n");
     
     //Clean up:
     free(C);
+    destroyPhaseArena();
     if(G != 0) {
         free(G->edgeListPtrs);
         free(G->edgeList);
@@ -0,0 +1,210 @@
+// **************************************************************************************************
+// Grappolo: A C++ library for parallel graph community detection
+// Hao Lu, Ananth Kalyanaraman (hao.lu@wsu.edu, ananth@eecs.wsu.edu) Washington State University
+// Mahantesh Halappanavar (hala@pnnl.gov) Pacific Northwest National Laboratory
+//
+// For citation, please cite the following paper:
+// Lu, Hao, Mahantesh Halappanavar, and Ananth Kalyanaraman. 
+// "Parallel heuristics for scalable community detection." Parallel Computing 47 (2015): 19-37.
+//
+// **************************************************************************************************
+// Copyright (c) 2016. Washington State University ("WSU"). All Rights Reserved.
+// Permission to use, copy, modify, and distribute this software and its documentation
+// for educational, research, and not-for-profit purposes, without fee, is hereby
+// granted, provided that the above copyright notice, this paragraph and the following
+// two paragraphs appear in all copies, modifications, and distributions. For
+// commercial licensing opportunities, please contact The Office of Commercialization,
+// WSU, 280/286 Lighty, PB Box 641060, Pullman, WA 99164, (509) 335-5526,
+// commercialization@wsu.edu<mailto:commercialization@wsu.edu>, https://commercialization.wsu.edu/
+
+// IN NO EVENT SHALL WSU BE LIABLE TO ANY PARTY FOR DIRECT, INDIRECT, SPECIAL, INCIDENTAL,
+// OR CONSEQUENTIAL DAMAGES, INCLUDING LOST PROFITS, ARISING OUT OF THE USE OF
+// THIS SOFTWARE AND ITS DOCUMENTATION, EVEN IF WSU HAS BEEN ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+// WSU SPECIFICALLY DISCLAIMS ANY WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. THE SOFTWARE AND
+// ACCOMPANYING DOCUMENTATION, IF ANY, PROVIDED HEREUNDER IS PROVIDED "AS IS". WSU HAS NO
+// OBLIGATION TO PROVIDE MAINTENANCE, SUPPORT, UPDATES, ENHANCEMENTS, OR MODIFICATIONS.
+// **************************************************************************************************
+
+#include "defs.h"
+#include "basic_comm.h"
+#include "basic_util.h"
+#include "input_output.h"
+#include <limits.h>
+
+using namespace std;
+
+//Phases of runMultiPhaseBasic() on a compact graph with the given index/weight types
+//WARNING: G will be destroyed at the end of this routine
+template<typename IdxT, typename WtT>
+static void runCompactPhases(compactGraphT<IdxT, WtT> *G, long *C_orig, double threshold, runtimeContext *ctx,
+                             long localMapCap, long hubThreshold, bool atomicUpdates)
+{
+    double totTimeClustering=0, totTimeBuildingPhase=0, tmpTime=0;
+    int tmpItr=0, totItr = 0;
+    long NV = G->numVertices;
+    int numThreads = ctx->nT;
+    
+    double prevMod = -1;
+    double currMod = -1;
+    long phase = 1;
+    bool weighted = (G->weight != 0); //Only the input graph can be unweighted
+    
+    compactGraphT<IdxT, WtT> *Gnew; //To build new hierarchical graphs
+    long numClusters;
+    long *C = (long *) malloc (NV * sizeof(long));
+    assert(C != 0);
+#pragma omp parallel for
+    for (long i=0; i<NV; i++) {
+        C[i] = -1;
+    }
+    
+    clusterHierarchy *H = createClusterHierarchy(); //Maps of phases 2, 3, ...
+    resetPeakRSS(); //Per-phase peaks, the peak of loading is in the summary
+    while(1){
+        printf("===============================\n");
+        printf("Phase %ld\n", phase);
+        printf("===============================\n");
+        bindRuntimeContext(ctx, G); //Team size and partition for this graph
+        numThreads = ctx->active;
+        prevMod = currMod;
+        
+        if (weighted)
+            currMod = parallelLouvianMethodCompact<IdxT, WtT, true>(G, C, numThreads, currMod, threshold, &tmpTime,
+                                                                    &tmpItr, localMapCap, hubThreshold, atomicUpdates);
+        else
+            currMod = parallelLouvianMethodCompact<IdxT, WtT, false>(G, C, numThreads, currMod, threshold, &tmpTime,
+                                                                     &tmpItr, localMapCap, hubThreshold, atomicUpdates);
+        totTimeClustering += tmpTime;
+        totItr += tmpItr;
+        
+        //Renumber the clusters contiguiously
+        numClusters = renumberClusters(G, C);
+        printf("Number of unique clusters: %ld\n", numClusters);
+        addDendrogramLevel(C, G->numVertices, numClusters); //Written while the next phase runs (-w)
+        
+        //Keep track of clusters in C_orig
+        if(phase == 1) {
+#pragma omp parallel for
+            for (long i=0; i<NV; i++) {
+                C_orig[i] = C[i]; //After the first phase
+            }
+        } else {
+            pushClusterLevel(H, C, G->numVertices); //Composed into C_orig after the last phase
+        }
+        printf("Done updating C_orig\n");
+        
+        //Break if too many phases or iterations
+        if((phase > 200)||(totItr > 10000)) {
+            break;
+        }
+        
+        //Check for modularity gain and build the graph for next phase
+        if( (currMod - prevMod) > threshold ) {
+            long sweepPeak = getPhasePeakRSS(); //Louvain sweep of this phase
+            resetPeakRSS();
+            Gnew = (compactGraphT<IdxT, WtT> *) malloc (sizeof(compactGraphT<IdxT, WtT>)); assert(Gnew != 0);
+            if (weighted)
+                tmpTime = buildNextLevelGraphCompact<IdxT, WtT, true>(G, Gnew, C, numClusters, numThreads);
+            else
+                tmpTime = buildNextLevelGraphCompact<IdxT, WtT, false>(G, Gnew, C, numClusters, numThreads);
+            weighted = true; //Coarse graphs always carry weights
+            totTimeBuildingPhase += tmpTime;
+            //Free up the previous graph
+            freeCompactGraph(G);
+            free(G);
+            G = Gnew; //Swap the pointers
+            
+            //Free up the previous cluster & create new one of a different size
+            free(C);
+            C = (long *) malloc (numClusters * sizeof(long)); assert(C != 0);
+            
+#pragma omp parallel for
+            for (long i=0; i<numClusters; i++) {
+                C[i] = -1;
+            }
+            printf("Phase %ld memory (KB): peak RSS %ld in the sweep, %ld while coarsening, %ld after\n",
+                   phase, sweepPeak, getPhasePeakRSS(), getCurrentRSS());
+            resetPeakRSS();
+            phase++; //Increment phase number
+        }else {
+            break; //Modularity gain is not enough. Exit.
+        }
+        
+    } //End of while(1)
+    composeClusterHierarchy(H, C_orig, NV);
+    destroyClusterHierarchy(H);
+    printf("Phase %ld memory (KB): peak RSS %ld in the sweep\n", phase, getPhasePeakRSS());
+    
+    printf("********************************************\n");
+    printf("*********    Compact Summary   *************\n");
+    printf("********************************************\n");
+    printf("Number of threads              : %d\n", ctx->nT);
+    printf("Total number of phases         : %ld\n", phase);
+    printf("Total number of iterations     : %d\n", totItr);
+    printf("Final number of clusters       : %ld\n", numClusters);
+    printf("Final modularity               : %lf\n", prevMod);
+    printf("Total time for clustering      : %lf\n", totTimeClustering);
+    printf("Total time for building phases : %lf\n", totTimeBuildingPhase);
+    printf("********************************************\n");
+    printf("TOTAL TIME                     : %lf\n", (totTimeClustering+totTimeBuildingPhase) );
+    printf("Peak memory (RSS, KB)          : %ld\n", getPeakRSS());
+    printf("********************************************\n");
+    
+    //Clean up:
+    free(C);
+    freeCompactGraph(G);
+    free(G);
+}//End of runCompactPhases()
+
+//Move G into a compact graph and run the phases with the narrowest types that give the same answer:
+//  <int,float>  : fewer than 2^31 vertices, integral weights and a total weight below 2^24
+//                 (every sum of weights is then exact in float)
+//  <int,double> : fewer than 2^31 vertices
+//  <long,double>: otherwise
+//A graph with unit weights only is run without a weight array in its first phase.
+//WARNING: Graph G will be destroyed at the end of this routine
+void runMultiPhaseCompact(graph *G, long *C_orig, double threshold, runtimeContext *ctx, long localMapCap,
+                          long hubThreshold, bool atomicUpdates)
+{
+    long NV = G->numVertices;
+    compactGraph *CG = (compactGraph *) malloc (sizeof(compactGraph)); assert(CG != 0);
+    graphToCompact(G, CG);
+    free(G);
+    
+    long NE = CG->edgeListPtrs[NV];
+    double totalWeight = NE; //Unit weights
+    long nonIntegral = 0;
+    if (CG->weight != 0) {
+        totalWeight = 0;
+#pragma omp parallel for reduction(+:totalWeight) reduction(+:nonIntegral)
+        for (long j=0; j<NE; j++) {
+            totalWeight += CG->weight[j];
+            if (CG->weight[j] != floor(CG->weight[j]))
+                nonIntegral++;
+        }
+    } else {
+        printf("Compact graph: unweighted (no weight array in the first phase)\n");
+    }
+    
+    if (NV >= INT_MAX) {
+        printf("Compact graph: <long,double> (16 bytes per edge)\n");
+        runCompactPhases(CG, C_orig, threshold, ctx, localMapCap, hubThreshold, atomicUpdates);
+    } else if ((nonIntegral == 0) && (totalWeight < 16777216.0)) {
+        printf("Compact graph: <int,float> (8 bytes per edge)\n");
+        compactGraphT<int, float> *TG = (compactGraphT<int, float> *) malloc (sizeof(compactGraphT<int, float>));
+        assert(TG != 0);
+        narrowCompactGraph(CG, TG);
+        free(CG);
+        runCompactPhases(TG, C_orig, threshold, ctx, localMapCap, hubThreshold, atomicUpdates);
+    } else {
+        printf("Compact graph: <int,double> (12 bytes per edge)\n");
+        compactGraphT<int, double> *TG = (compactGraphT<int, double> *) malloc (sizeof(compactGraphT<int, double>));
+        assert(TG != 0);
+        narrowCompactGraph(CG, TG);
+        free(CG);
+        runCompactPhases(TG, C_orig, threshold, ctx, localMapCap, hubThreshold, atomicUpdates);
+    }
+}//End of runMultiPhaseCompact()
@@ -35,6 +35,18 @@
 //////////////////////////////////////////////////////////////////////////////////////
 //////////////////////////  DISTANCE ONE COLORING      ///////////////////////////////
 //////////////////////////////////////////////////////////////////////////////////////
+//Give v the smallest color not used by its neighbors
+static inline void firstFitColor(graph *G, long v, int *vtxColor) {
+	BitVector mark(MaxDegree, false);
+	int maxColor = distanceOneMarkArray(mark,G,v,vtxColor);
+	int myColor;
+	for (myColor=0; myColor<=maxColor; myColor++) {
+		if ( mark[myColor] == false )
+			break;
+	}
+	vtxColor[v] = myColor; //Color the vertex
+}//End of firstFitColor()
+
 //Return the number of colors used (zero is a valid color)
 int algoDistanceOneVertexColoringOpt(graph *G, int *vtxColor, int nThreads, double *totTime)
 {
@@ -90,6 +102,8 @@ int algoDistanceOneVertexColoringOpt(graph *G, int *vtxColor, int nThreads, doub
       Qtmp[i]= -1; //Empty queue
   }
   QTail = NVer;	//Queue all vertices
+  //The first round processes every vertex in natural order: use edge-balanced ranges
+  long *part = buildEdgePartition(verPtr, NVer, nT);
 
 
 	// Cal real Maximum degree, 2x for maxDegree to be safe
@@ -123,20 +137,20 @@ int algoDistanceOneVertexColoringOpt(graph *G, int *vtxColor, int nThreads, doub
 #endif
 
     time1 = omp_get_wtime();
-		#pragma omp parallel for
-    for (long Qi=0; Qi<QTail; Qi++) {
-      long v = Q[Qi]; //Q.pop_front();
-			int maxColor = 0;
-			BitVector mark(MaxDegree, false);
-			maxColor = distanceOneMarkArray(mark,G,v,vtxColor);
-				
-			int myColor;
-			for (myColor=0; myColor<=maxColor; myColor++) {
-				if ( mark[myColor] == false )
-					break;
-			}     
-			vtxColor[v] = myColor; //Color the vertex
-		} //End of outer for loop: for each vertex
+		if (nLoops == 0) {
+			#pragma omp parallel
+			{
+				int tid = omp_get_thread_num();
+				for (long v=part[tid]; v<part[tid+1]; v++)
+					firstFitColor(G, v, vtxColor);
+			}
+		} else {
+			#pragma omp parallel for
+			for (long Qi=0; Qi<QTail; Qi++) {
+				long v = Q[Qi]; //Q.pop_front();
+				firstFitColor(G, v, vtxColor);
+			} //End of outer for loop: for each vertex
+		}
 		
 		time1  = omp_get_wtime() - time1;
 		totalTime += time1;
@@ -152,11 +166,20 @@ int algoDistanceOneVertexColoringOpt(graph *G, int *vtxColor, int nThreads, doub
     //two conflicting vertices, based on their random values 
     time2 = omp_get_wtime();
 		
-		#pragma omp parallel for
-		for (long Qi=0; Qi<QTail; Qi++) {
-			long v = Q[Qi]; //Q.pop_front();
-			distanceOneConfResolution(G, v, vtxColor, randValues, &QtmpTail, Qtmp, freq, 0);
-		} //End of outer for loop: for each vertex
+		if (nLoops == 0) {
+			#pragma omp parallel
+			{
+				int tid = omp_get_thread_num();
+				for (long v=part[tid]; v<part[tid+1]; v++)
+					distanceOneConfResolution(G, v, vtxColor, randValues, &QtmpTail, Qtmp, freq, 0);
+			}
+		} else {
+			#pragma omp parallel for
+			for (long Qi=0; Qi<QTail; Qi++) {
+				long v = Q[Qi]; //Q.pop_front();
+				distanceOneConfResolution(G, v, vtxColor, randValues, &QtmpTail, Qtmp, freq, 0);
+			} //End of outer for loop: for each vertex
+		}
   
 		time2  = omp_get_wtime() - time2;
 		totalTime += time2;    
@@ -217,6 +240,7 @@ int algoDistanceOneVertexColoringOpt(graph *G, int *vtxColor, int nThreads, doub
   free(Q);
   free(Qtmp);
   free(randValues);
+  free(part);
   
   return nColors; //Return the number of colors used
 }
@@ -105,44 +105,9 @@ void equitableDistanceOneColorBased(graph *G, int *vtxColor, int numColors, long
   time1 = omp_get_wtime();
  
   long *colorIndex = (long *) malloc (NVer * sizeof(long)); assert(colorIndex != 0);
-  long *colorAdded = (long *) malloc (numColors * sizeof(long)); assert(colorAdded != 0);
-  printf("Reached here...1\n");  
-
-#pragma omp parallel for
-  for(long i = 0; i < numColors; i++) {	
-    colorAdded[i] = 0;
-  }
-
-  printf("Reached here...2\n"); 
-
- long *colorPtr = (long *) malloc ((numColors+1) * sizeof(long)); assert(colorPtr != 0);
-#pragma omp parallel for
-  for(long i = 0; i <= numColors; i++) {	
-    colorPtr[i] = 0;
-  }
-  printf("\nReached here... 0.5\n"); 
-
-
-
-  // Count the size of each color
-//#pragma omp parallel for
-  for(long i = 0; i < NVer; i++) {
-    __sync_fetch_and_add(&colorPtr[(long)vtxColor[i]+1],1);
-  }
-  printf("Reached here...2.5\n"); 
-  //Prefix sum:
-  for(long i=0; i<numColors; i++) {
-    colorPtr[i+1] += colorPtr[i];
-  }	
-  printf("Reached here...3\n");  
-
-  //Group vertices with the same color in particular order
-//#pragma omp parallel for
-  for (long i=0; i<NVer; i++) {
-    long tc = (long)vtxColor[i];
-    long Where = colorPtr[tc] + __sync_fetch_and_add(&(colorAdded[tc]), 1);
-    colorIndex[Where] = i;
-  }
+  long *colorPtr = (long *) malloc ((numColors+1) * sizeof(long)); assert(colorPtr != 0);
+  //Group vertices with the same color, in increasing vertex order
+  buildCSRByKey(vtxColor, NVer, numColors, colorPtr, colorIndex);
   time2 = omp_get_wtime();
   totalTime += time2 - time1;
   printf("Time to initialize: %3.3lf\n", time2-time1);
@@ -34,7 +34,7 @@
 using namespace std;
 
 double algoLouvainWithDistOneColoring(graph* G, long *C, int nThreads, int* color, 
-			int numColor, double Lower, double thresh, double *totTime, int *numItr) {
+			int numColor, double Lower, double thresh, double *totTime, int *numItr, long hubThreshold, bool atomicUpdates) {
 #ifdef PRINT_DETAILED_STATS_  
 	printf("Within algoLouvainWithDistOneColoring()\n");
 #endif
@@ -58,7 +58,6 @@ double algoLouvainWithDistOneColoring(graph* G, long *C, int nThreads, int* colo
 	long* currCommAss;	//Store current community assignment
 	//long* targetCommAss;	//Store the target of community assignment
 	double* vDegree;	//Store each vertex's degree
-	double* clusterWeightInternal;//use for Modularity calculation (eii)
 	
 	/* Indexs are community */
 	Comm* cInfo;	 //Community info. (ai and size)
@@ -96,38 +95,40 @@ double algoLouvainWithDistOneColoring(graph* G, long *C, int nThreads, int* colo
         /*** Assign each vertex to its own Community ***/
 	initCommAss( pastCommAss, currCommAss, NV);
 
-	clusterWeightInternal = (double*) malloc (NV*sizeof(double)); assert(clusterWeightInternal != 0);
 	
 	/*** Create a CSR-like datastructure for vertex-colors ***/
 	long * colorPtr = (long *) malloc ((numColor+1) * sizeof(long));
 	long * colorIndex = (long *) malloc (NV * sizeof(long));
-	long * colorAdded = (long *)malloc (numColor*sizeof(long));
 	assert(colorPtr != 0);
     assert(colorIndex != 0);
-	assert(colorAdded != 0);
-	// Initialization
-#pragma omp parallel for
-	for(long i = 0; i < numColor; i++) {	
-		colorPtr[i] = 0;
-		colorAdded[i] = 0;
+	//Group vertices with the same color, in increasing vertex order
+	buildCSRByKey(color, NV, numColor, colorPtr, colorIndex);
+	//Degree-aware schedule of each color class: edge-balanced chunks, hubs split across threads
+	hybridSchedule *colorSched = (hybridSchedule *) malloc (numColor * sizeof(hybridSchedule)); assert(colorSched != 0);
+	long maxHubDeg = 0, numHubs = 0;
+	for (long ci = 0; ci < numColor; ci++) {
+		buildHybridSchedule(&colorSched[ci], &colorIndex[colorPtr[ci]], colorPtr[ci+1]-colorPtr[ci], vtxPtr, hubThreshold, nT);
+		long hubDeg = maxHubDegree(&colorSched[ci], vtxPtr);
+		if (hubDeg > maxHubDeg)
+			maxHubDeg = hubDeg;
+		numHubs += colorSched[ci].numHubs;
 	}
-	colorPtr[numColor] = 0;
-	// Count the size of each color
-#pragma omp parallel for
-	for(long i = 0; i < NV; i++) {
-		__sync_fetch_and_add(&colorPtr[(long)color[i]+1],1);
-	}
-	//Prefix sum:
-	for(long i=0; i<numColor; i++) {
-		colorPtr[i+1] += colorPtr[i];
-	}	
-	//Group vertices with the same color in particular order
-#pragma omp parallel for
-	for (long i=0; i<NV; i++) {
-		long tc = (long)color[i];
-		long Where = colorPtr[tc] + __sync_fetch_and_add(&(colorAdded[tc]), 1);
-		colorIndex[Where] = i;
+	hubScratch *hubWork = 0;
+	if (numHubs > 0) {
+		hubWork = allocHubScratch(nT, maxHubDeg);
+		printf("Hybrid schedule: %ld hubs (degree > %ld) processed by all threads\n", numHubs, hubThreshold);
 	}
+	//Community updates: per-thread delta buffers unless the atomic fallback is requested
+	deltaBuffer *deltaBuf = 0;
+	if (!atomicUpdates)
+		deltaBuf = allocDeltaBuffers(nT, 4096);
+	double *busyTime = (double *) malloc (nT * sizeof(double)); assert(busyTime != 0);
+	for (int t=0; t<nT; t++)
+		busyTime[t] = 0;
+	//e_xx and a2_x are updated from the moves of each color class: the vertices of a class
+	//are not adjacent, so the counters they see are exact when they move
+	double e_xx = sumInternalWeight(vtxPtr, vtxInd, currCommAss, NV);
+	double a2_x = sumSquaredDegrees(cInfo, NV);
 	time2 = omp_get_wtime();
 	printf("Time to initialize: %3.3lf\n", time2-time1);
 #ifdef PRINT_DETAILED_STATS_	
@@ -148,16 +149,17 @@ double algoLouvainWithDistOneColoring(graph* G, long *C, int nThreads, int* colo
 		{
 #pragma omp parallel for
 			for (long i=0; i<NV; i++) {
-				clusterWeightInternal[i] = 0; //Initialize to zero
 				cUpdate[i].degree =0;
 				cUpdate[i].size =0;
 			}
-			long coloradj1 = colorPtr[ci];
-			long coloradj2 = colorPtr[ci+1];
-			
-#pragma omp parallel for  
-			for (long K = coloradj1; K<coloradj2; K++) {
-				long i = colorIndex[K];
+			hybridSchedule *cs = &colorSched[ci];
+			double exxChange = 0;
+#pragma omp parallel reduction(+:exxChange)
+			{
+				int tid = omp_get_thread_num();
+				double lightStartTime = omp_get_wtime();
+				for (long K = cs->lightStart[tid]; K<cs->lightStart[tid+1]; K++) {
+				long i = cs->light[K];
 				long localTarget = -1;
 				long adj1 = vtxPtr[i];
 				long adj2 = vtxPtr[i+1];
@@ -175,19 +177,26 @@ double algoLouvainWithDistOneColoring(graph* G, long *C, int nThreads, int* colo
 					selfLoop = buildLocalMapCounter(adj1, adj2, clusterLocalMap, Counter, vtxInd, currCommAss, i);
 					//Calculate the max
 					localTarget = max(clusterLocalMap, Counter, selfLoop, cInfo, vDegree[i], currCommAss[i], constantForSecondTerm);
+					if(localTarget != currCommAss[i]) //e_iy - e_ix on both sides of every edge; the self loop moves with i
+						exxChange += 2*(Counter[clusterLocalMap[localTarget]] - (Counter[0] - selfLoop));
 				} else {
 					localTarget = -1;
 				}					
 				//Update prepare
 				if(localTarget != currCommAss[i] && localTarget != -1) {
-          #pragma omp atomic update
-          cUpdate[localTarget].degree += vDegree[i];
-          #pragma omp atomic update
-          cUpdate[localTarget].size += 1;
-          #pragma omp atomic update
-          cUpdate[currCommAss[i]].degree -= vDegree[i];
-          #pragma omp atomic update
-          cUpdate[currCommAss[i]].size -=1;
+          if (deltaBuf != 0) { //Per-thread buffers, merged after the sweep
+            addDeltaBuffer(&deltaBuf[tid], localTarget, 1, vDegree[i]);
+            addDeltaBuffer(&deltaBuf[tid], currCommAss[i], -1, -vDegree[i]);
+          } else {
+            #pragma omp atomic update
+            cUpdate[localTarget].degree += vDegree[i];
+            #pragma omp atomic update
+            cUpdate[localTarget].size += 1;
+            #pragma omp atomic update
+            cUpdate[currCommAss[i]].degree -= vDegree[i];
+            #pragma omp atomic update
+            cUpdate[currCommAss[i]].size -=1;
+          }
           /*
 					__sync_fetch_and_add(&cUpdate[localTarget].degree, vDegree[i]);
 	         			__sync_fetch_and_add(&cUpdate[localTarget].size, 1);
@@ -196,42 +205,59 @@ double algoLouvainWithDistOneColoring(graph* G, long *C, int nThreads, int* colo
 				}//End of If()
 				currCommAss[i] = localTarget;      
 				clusterLocalMap.clear();      
-			}//End of for(i)
+			}//End of for(K)
+				busyTime[tid] += omp_get_wtime() - lightStartTime;
+
+				//Hubs: all threads work together on one vertex at a time
+				for (long h=0; h<cs->numHubs; h++) {
+					long i = cs->hubs[h];
+					double hubStartTime = omp_get_wtime();
+					double eix = 0, hubExxChange = 0;
+					long localTarget = maxHubParallel(i, vtxPtr, vtxInd, currCommAss, cInfo, vDegree[i],
+					                                  constantForSecondTerm, hubWork, &eix, &hubExxChange);
+					busyTime[tid] += omp_get_wtime() - hubStartTime;
+					if (tid == 0) {
+						if(localTarget != currCommAss[i]) {
+							exxChange += hubExxChange;
+							if (deltaBuf != 0) { //Per-thread buffers, merged after the sweep
+								addDeltaBuffer(&deltaBuf[tid], localTarget, 1, vDegree[i]);
+								addDeltaBuffer(&deltaBuf[tid], currCommAss[i], -1, -vDegree[i]);
+							} else {
+								#pragma omp atomic update
+								cUpdate[localTarget].degree += vDegree[i];
+								#pragma omp atomic update
+								cUpdate[localTarget].size += 1;
+								#pragma omp atomic update
+								cUpdate[currCommAss[i]].degree -= vDegree[i];
+								#pragma omp atomic update
+								cUpdate[currCommAss[i]].size -=1;
+							}
+						}
+						currCommAss[i] = localTarget;
+					}
+				}//End of for(h)
+				if (deltaBuf != 0)
+					mergeDeltaBuffers(deltaBuf, cUpdate, NV);
+			}//End of parallel region
 			
+			e_xx += exxChange;
 			// UPDATE
-#pragma omp parallel for  
+			double a2Change = 0;
+#pragma omp parallel for reduction(+:a2Change)
 			for (long i=0; i<NV; i++) {
+				a2Change += cUpdate[i].degree*(2*cInfo[i].degree + cUpdate[i].degree); //(a+d)^2 - a^2
 				cInfo[i].size += cUpdate[i].size;
 				cInfo[i].degree += cUpdate[i].degree;
 			}
+			a2_x += a2Change;
 		}//End of Color loop						
 		time2 = omp_get_wtime();
 		
-		time3 = omp_get_wtime();    
-		double e_xx = 0;
-		double a2_x = 0;	
-		
-		// CALCULATE MOD
-#pragma omp parallel for  //Parallelize on each vertex
-		for (long i =0; i<NV;i++){
-			clusterWeightInternal[i] = 0;
-		}
-#pragma omp parallel for  //Parallelize on each vertex
-		for (long i=0; i<NV; i++) {
-			long adj1 = vtxPtr[i];
-			long adj2 = vtxPtr[i+1];
-			for(long j=adj1; j<adj2; j++) {
-				if(currCommAss[vtxInd[j].tail] == currCommAss[i]){
-					clusterWeightInternal[i] += vtxInd[j].weight;
-				}
-			}
-		}		
-		
-#pragma omp parallel for \
-reduction(+:e_xx) reduction(+:a2_x)
-		for (long i=0; i<NV; i++) {
-			e_xx += clusterWeightInternal[i];
-			a2_x += (cInfo[i].degree)*(cInfo[i].degree);
+		time3 = omp_get_wtime();
+		// CALCULATE MOD: exact recomputation (O(E)) only every MOD_EXACT_PERIOD iterations
+		if (numItrs % MOD_EXACT_PERIOD == 0) {
+			e_xx = sumInternalWeight(vtxPtr, vtxInd, currCommAss, NV);
+			a2_x = sumSquaredDegrees(cInfo, NV);
 		}
 		time4 = omp_get_wtime();
 		
@@ -266,9 +292,18 @@ reduction(+:e_xx) reduction(+:a2_x)
 	printf("========================================================================================================\n");
 #endif
 	//Cleanup:
-        free(vDegree); free(cInfo); free(cUpdate); free(clusterWeightInternal);
-        free(colorPtr); free(colorIndex); free(colorAdded);
+        free(vDegree); free(cInfo); free(cUpdate);
+        free(colorPtr); free(colorIndex);
 	free(pastCommAss);
+	reportThreadBusyTime(busyTime, nT);
+	free(busyTime);
+	if (deltaBuf != 0)
+		freeDeltaBuffers(deltaBuf, nT);
+	for (long ci = 0; ci < numColor; ci++)
+		freeHybridSchedule(&colorSched[ci]);
+	free(colorSched);
+	if (hubWork != 0)
+		freeHubScratch(hubWork, nT);
 	
 	return prevMod;
 	
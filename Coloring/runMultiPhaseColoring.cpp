@@ -31,6 +31,7 @@
 #include "defs.h"
 #include "basic_comm.h"
 #include "color_comm.h"
+#include "input_output.h"
 using namespace std;
 //WARNING: This will overwrite the original graph data structure to 
 //         minimize memory footprint
@@ -38,11 +39,13 @@ using namespace std;
 //         Assume C_orig is initialized appropriately
 //WARNING: Graph G will be destroyed at the end of this routine
 void runMultiPhaseColoring(graph *G, long *C_orig, int coloring, long minGraphSize,
-			double threshold, double C_threshold, int numThreads, int threadsOpt)
+			double threshold, double C_threshold, runtimeContext *ctx, int threadsOpt, long localMapCap, long hubThreshold,
+			bool atomicUpdates)
 {
   double totTimeClustering=0, totTimeBuildingPhase=0, totTimeColoring=0, tmpTime;
   int tmpItr=0, totItr = 0;  
   long NV = G->numVertices;
+  int numThreads = ctx->nT;
 
   //long minGraphSize = 100000; //Need at least 100,000 vertices to turn coloring on
 
@@ -80,29 +83,34 @@ void runMultiPhaseColoring(graph *G, long *C_orig, int coloring, long minGraphSi
   }	
   
 	bool nonColor = false; //Make sure that at least one phase with lower threshold runs
+  clusterHierarchy *H = createClusterHierarchy(); //Maps of phases 2, 3, ...
+  resetPeakRSS(); //Per-phase peaks, the peak of loading is in the summary
   while(1){
     printf("===============================\n");
 	  printf("Phase %ld\n", phase);
     printf("===============================\n");
+    bindRuntimeContext(ctx, G); //Team size and partition for this graph
+    numThreads = ctx->active;
    	prevMod = currMod;
 	  //Compute clusters
 	  if((G->numVertices > minGraphSize)&&(nonColor == false)) {
 		  // No Map is not constructed yet
-			// currMod = algoLouvainWithDistOneColoringNoMap(G, C, numThreads, colors, numColors, currMod, C_threshold, &tmpTime, &tmpItr);
-      currMod = algoLouvainWithDistOneColoring(G, C, numThreads, colors, numColors, currMod, C_threshold, &tmpTime, &tmpItr);
+			// currMod = algoLouvainWithDistOneColoringNoMap(G, C, numThreads, colors, numColors, currMod, C_threshold, &tmpTime, &tmpItr, localMapCap, hubThreshold, atomicUpdates);
+      currMod = algoLouvainWithDistOneColoring(G, C, numThreads, colors, numColors, currMod, C_threshold, &tmpTime, &tmpItr, hubThreshold, atomicUpdates);
 		  totTimeClustering += tmpTime;
       totItr += tmpItr;
 			if(phase == 1)
 				nonColor = true;
 	  }else {
-      parallelLouvianMethodNoMap(G, C, numThreads, currMod, threshold, &tmpTime, &tmpItr);
+      parallelLouvianMethodNoMap(G, C, numThreads, currMod, threshold, &tmpTime, &tmpItr, localMapCap, hubThreshold, atomicUpdates);
       totTimeClustering += tmpTime;
       totItr += tmpItr;
 	  } 
   
     //Renumber the clusters contiguiously
-  	numClusters = renumberClustersContiguously(C, G->numVertices);
+  	numClusters = renumberClusters(G, C);
   	printf("Number of unique clusters: %ld\n", numClusters);
+  	addDendrogramLevel(C, G->numVertices, numClusters); //Written while the next phase runs (-w)
   
     //printf("About to update C_orig\n");
 	  //Keep track of clusters in C_orig
@@ -112,12 +120,7 @@ void runMultiPhaseColoring(graph *G, long *C_orig, int coloring, long minGraphSi
 	  	  C_orig[i] = C[i]; //After the first phase
 	    } 	
 	  } else {
-      #pragma omp parallel for
-	    for (long i=0; i<NV; i++) {
-        assert(C_orig[i] < G->numVertices);
-        if (C_orig[i] >=0)
-	  		  C_orig[i] = C[C_orig[i]]; //Each cluster in a previous phase becomes a vertex
-	    }	
+	    pushClusterLevel(H, C, G->numVertices); //Composed into C_orig after the last phase
 	  }
     printf("Done updating C_orig\n");
 	  //Break if too many phases or iterations
@@ -129,6 +132,8 @@ void runMultiPhaseColoring(graph *G, long *C_orig, int coloring, long minGraphSi
 	  //In case coloring is used, make sure the non-coloring routine is run at least once
 
     if( (currMod - prevMod) > threshold ) {
+		  long sweepPeak = getPhasePeakRSS(); //Louvain sweep of this phase
+		  resetPeakRSS();
 		  Gnew = (graph *) malloc (sizeof(graph)); assert(Gnew != 0);
 		  tmpTime =  buildNextLevelGraphOpt(G, Gnew, C, numClusters, numThreads);
 		  totTimeBuildingPhase += tmpTime;
@@ -139,6 +144,8 @@ void runMultiPhaseColoring(graph *G, long *C_orig, int coloring, long minGraphSi
 		  G = Gnew; //Swap the pointers
       G->edgeListPtrs = Gnew->edgeListPtrs;
       G->edgeList = Gnew->edgeList;
+      placeGraph(G, numThreads); //NUMA placement of the new graph (-n)
+      reportNumaLocality(G, numThreads);
 		  
       //Free up the previous cluster & create new one of a different size
 		  free(C);
@@ -148,6 +155,9 @@ void runMultiPhaseColoring(graph *G, long *C_orig, int coloring, long minGraphSi
 		  for (long i=0; i<numClusters; i++) {
 			  C[i] = -1;
 		  }
+		  printf("Phase %ld memory (KB): peak RSS %ld in the sweep, %ld while coarsening, %ld after\n",
+		         phase, sweepPeak, getPhasePeakRSS(), getCurrentRSS());
+		  resetPeakRSS();
 		  phase++; //Increment phase number
 		  //If coloring is enabled & graph is of minimum size, recolor the new graph
 		  /*if((coloring == 1)&&(G->numVertices > minGraphSize)&&(nonColor = false)){
@@ -177,11 +187,14 @@ void runMultiPhaseColoring(graph *G, long *C_orig, int coloring, long minGraphSi
 		  }
 	  } 	
   } //End of while(1)
+  composeClusterHierarchy(H, C_orig, NV);
+  destroyClusterHierarchy(H);
+  printf("Phase %ld memory (KB): peak RSS %ld in the sweep\n", phase, getPhasePeakRSS());
  
   printf("********************************************\n"); 
   printf("*********    Compact Summary   *************\n");
   printf("********************************************\n");
-  printf("Number of threads              : %ld\n", numThreads);
+  printf("Number of threads              : %ld\n", ctx->nT);
   printf("Total number of phases         : %ld\n", phase);
   printf("Total number of iterations     : %ld\n", totItr);
   printf("Final number of clusters       : %ld\n", numClusters);
@@ -193,6 +206,7 @@ void runMultiPhaseColoring(graph *G, long *C_orig, int coloring, long minGraphSi
   }
   printf("********************************************\n");
   printf("TOTAL TIME                     : %lf\n", (totTimeClustering+totTimeBuildingPhase+totTimeColoring) );
+  printf("Peak memory (RSS, KB)          : %ld\n", getPeakRSS());
   printf("********************************************\n");
 
   //Clean up:
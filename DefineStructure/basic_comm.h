@@ -33,16 +33,35 @@
 
 // Define in louvainMultiPhaseRun.cpp
 void runMultiPhaseBasic(graph *G, long *C_orig, int basicOpt, long minGraphSize,
-			double threshold, double C_threshold, int numThreads, int threadsOpt);
+			double threshold, double C_threshold, runtimeContext *ctx, int threadsOpt, long localMapCap, long hubThreshold,
+			bool atomicUpdates);
 
 // Define in parallelLouvianMethod.cpp
-double parallelLouvianMethod(graph *G, long *C, int nThreads, double Lower, 
-				double thresh, double *totTime, int *numItr);
+double parallelLouvianMethod(graph *G, long *C, runtimeContext *ctx, double Lower, 
+				double thresh, double *totTime, int *numItr, long hubThreshold, bool atomicUpdates);
 
 // Define in parallelLouvianMethodNoMap.cpp
 double parallelLouvianMethodNoMap(graph *G, long *C, int nThreads, double Lower,
-				double thresh, double *totTime, int *numItr);
+				double thresh, double *totTime, int *numItr, long localMapCap, long hubThreshold, bool atomicUpdates);
 				
+// Define in parallelLouvainMethodFrontier.cpp
+double parallelLouvianMethodFrontier(graph *G, long *C, int nThreads, double Lower,
+				double thresh, double *totTime, int *numItr, long localMapCap);
+
+// Define in runMultiPhaseCompact.cpp
+void runMultiPhaseCompact(graph *G, long *C_orig, double threshold, runtimeContext *ctx, long localMapCap,
+			long hubThreshold, bool atomicUpdates);
+
+// Define in parallelLouvainMethodCompact.cpp (instantiated for <long,double>, <int,double>, <int,float>)
+// Weighted = false runs on a graph without a weight array (unit weights)
+template<typename IdxT, typename WtT, bool Weighted>
+double parallelLouvianMethodCompact(compactGraphT<IdxT, WtT> *G, long *C, int nThreads, double Lower,
+				double thresh, double *totTime, int *numItr, long localMapCap, long hubThreshold, bool atomicUpdates);
+
+// Define in parallelLouvainMethodHash.cpp
+double parallelLouvianMethodHash(graph *G, long *C, int nThreads, double Lower,
+				double thresh, double *totTime, int *numItr);
+
 // Define in parallelLouvianMethodScale.cpp
 double parallelLouvianMethodScale(graph *G, long *C, int nThreads, double Lower, 
 				double thresh, double *totTime, int *numItr);
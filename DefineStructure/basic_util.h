@@ -33,17 +33,77 @@
 
 // Define in buildNextPhase.cpp
 long renumberClustersContiguously(long *C, long size);
+void selectClusterOrder(int order);
+template<typename GraphT> //graph or compactGraphT
+long renumberClusters(GraphT *G, long *C);
 double buildNextLevelGraphOpt(graph *Gin, graph *Gout, long *C, long numUniqueClusters, int nThreads);
 void buildNextLevelGraph(graph *Gin, graph *Gout, long *C, long numUniqueClusters);
+template<typename IdxT, typename WtT, bool Weighted>
+double buildNextLevelGraphCompact(compactGraphT<IdxT, WtT> *Gin, compactGraphT<IdxT, WtT> *Gout, long *C,
+                                  long numUniqueClusters, int nThreads);
 long buildCommunityBasedOnVoltages(graph *G, long *Volts, long *C, long *Cvolts);
 void segregateEdgesBasedOnVoltages(graph *G, long *Volts);
 inline void Visit(long v, long myCommunity, short *Visited, long *Volts, 
 				  long* vtxPtr, edge* vtxInd, long *C);
 				  
+// Define in clusterHierarchy.cpp
+clusterHierarchy* createClusterHierarchy();
+void pushClusterLevel(clusterHierarchy *H, long *C, long size);
+void composeClusterHierarchy(clusterHierarchy *H, long *C_orig, long NV);
+void destroyClusterHierarchy(clusterHierarchy *H);
+
+// Define in coarsenGraph.cpp
+void selectInPlaceCoarsening(bool inPlace);
+long coarsenGraph(graph *Gin, graph *Gout, long *C, long numUniqueClusters, bool withSelf, bool truncateWeights);
+template<typename IdxT, typename WtT, bool Weighted>
+long coarsenGraph(compactGraphT<IdxT, WtT> *Gin, compactGraphT<IdxT, WtT> *Gout, long *C,
+                  long numUniqueClusters, bool withSelf);
+
+// Define in edgePartition.cpp
+long* buildEdgePartition(long *vtxPtr, long NV, int nT);
+
+// Define in numaPlacement.cpp
+void selectNumaPlacement(int mode);
+int numaPlacementMode();
+void placeGraph(graph *G, int nT);
+void reportNumaLocality(graph *G, int nT);
+
+// Define in parallelScan.cpp
+long parallelPrefixSum(long *A, long n);
+template<typename KeyT>
+long buildCSRByKey(const KeyT *Key, long n, long numKeys, long *Ptr, long *Index);
+long buildCSRFromEdges(const edge *list, long NE, long NV, bool bothDirections, long *Ptr, edge *Out);
+
+// Define in phaseArena.cpp
+void createPhaseArena(graph *G, int nT, bool withLocalMaps);
+void* phaseAlloc(size_t bytes);
+void phaseFree(void *p);
+void reportPhaseArena(long phase);
+void destroyPhaseArena();
+
+// Define in runtimeContext.cpp
+runtimeContext* createRuntimeContext(int nThreads, long serialCutoff);
+template<typename GraphT>
+void bindRuntimeContext(runtimeContext *ctx, GraphT *G);
+double sumThreadValues(runtimeContext *ctx);
+void destroyRuntimeContext(runtimeContext *ctx);
+
+// Define in reorderGraph.cpp
+long* reorderGraph(graph *G, int ordering);
+double meanNeighborGap(graph *G);
+
 // Define in vertexFollowing.cpp
 long vertexFollowing(graph *G, long *C);
 double buildNewGraphVF(graph *Gin, graph *Gout, long *C, long numUniqueClusters);
 
+// Define in compactGraph.cpp
+void graphToCompact(graph *G, compactGraph *CG);
+void compactToGraph(compactGraph *CG, graph *G);
+template<typename IdxT, typename WtT>
+void narrowCompactGraph(compactGraph *CG, compactGraphT<IdxT, WtT> *TG);
+template<typename IdxT, typename WtT>
+void freeCompactGraph(compactGraphT<IdxT, WtT> *CG);
+
 // Define in utilityFunctions.cpp
 double computeGiniCoefficient(long *colorSize, int numColors);
 void generateRandomNumbers(double *RandVec, long size);
@@ -52,6 +112,10 @@ void duplicateGivenGraph(graph *Gin, graph *Gout);
 void displayGraphEdgeList(graph *G);
 void writeEdgeListToFile(graph *G, FILE* out);
 void displayGraphCharacteristics(graph *G);
+long getPeakRSS();
+long getCurrentRSS();
+void resetPeakRSS();
+long getPhasePeakRSS();
 
 
 #endif
@@ -36,12 +36,13 @@
 #include "coloring.h"
 
 void runMultiPhaseColoring(graph *G, long *C_orig, int coloring, long minGraphSize,
-			double threshold, double C_threshold, int numThreads, int threadsOpt);
+			double threshold, double C_threshold, runtimeContext *ctx, int threadsOpt, long localMapCap, long hubThreshold,
+			bool atomicUpdates);
 
 double algoLouvainWithDistOneColoring(graph* G, long *C, int nThreads, int* color, 
-			int numColor, double Lower, double thresh, double *totTime, int *numItr);
+			int numColor, double Lower, double thresh, double *totTime, int *numItr, long hubThreshold, bool atomicUpdates);
 			
 double algoLouvainWithDistOneColoringNoMap(graph* G, long *C, int nThreads, int* color,
-			int numColor, double Lower, double thresh, double *totTime, int *numItr);
+			int numColor, double Lower, double thresh, double *totTime, int *numItr, long localMapCap, long hubThreshold, bool atomicUpdates);
 			
 #endif
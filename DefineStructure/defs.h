@@ -52,11 +52,18 @@
 #define PRINT_DETAILED_STATS_
 //#define PRINT_TERSE_STATS_
 
-typedef struct comm
+//The engines update e_xx and a2_x from the moves of each iteration;
+//both are recomputed exactly every MOD_EXACT_PERIOD iterations to bound the drift
+#define MOD_EXACT_PERIOD 10
+
+//Community info., templated on the index and weight types of the compact kernels
+template<typename IdxT, typename WtT>
+struct CommT
 {
-  long size;
-  double degree;
-}Comm;
+  IdxT size;
+  WtT degree;
+};
+typedef CommT<long, double> Comm;
 
 typedef struct
 {
@@ -64,6 +71,105 @@ typedef struct
     double Counter; //Weight relative to that community
 } mapElement;
 
+typedef struct
+{
+    long tableSize;  //Number of slots (a power of two)
+    int  shift;      //64 - log2(tableSize): used for hashing
+    long *key;       //Community ID held in a slot (-1 if empty)
+    long *position;  //Position of that community in the local map
+    long numTouched; //Number of slots occupied by the current vertex
+    long *touched;   //Occupied slots -- used to clear the table
+} hashLocalMap;
+
+typedef struct
+{
+    long stamp;    //Visit in which the community was last seen
+    long position; //Position of that community in the local map
+} spaElement;
+
+typedef struct
+{
+    long stampValue;  //Current visit: bumped once per vertex, so no clearing is needed
+    spaElement *slot; //Dense sparse accumulator (SPA) indexed by community ID
+} denseSPA;
+
+typedef struct
+{
+    long capacity;             //Entries in localMap: max degree + 1, or the configured cap
+    mapElement *localMap;      //Reused for every vertex processed by the thread
+    mapElement *overflow;      //Temporary local map for a vertex above the cap (else NULL)
+    denseSPA spa;              //Lookup in the default mode (slot is NULL in bounded mode)
+    hashLocalMap hash;         //Lookup in the bounded mode
+    hashLocalMap overflowHash; //Lookup for the temporary local map
+} localMapScratch;
+
+typedef struct
+{
+    long numLight;    //Vertices at or below the hub threshold
+    long *light;      //Their IDs in the original order (NULL: the identity 0..numLight-1)
+    long *lightStart; //nT+1 boundaries into light: each thread gets about the same number of edges
+    long numHubs;     //Vertices above the hub threshold
+    long *hubs;       //Their IDs: each hub is processed by all the threads together
+} hybridSchedule;
+
+typedef struct
+{
+    mapElement *partial;      //Counters for this thread's slice of the hub's adjacency
+    hashLocalMap partialHash;
+    mapElement *bucketed;     //The same counters grouped by owner thread (cid % nT)
+    long *bucketStart;        //nT+1 boundaries into bucketed
+    mapElement *merged;       //Counters of the communities owned by this thread, over all slices
+    hashLocalMap mergedHash;
+    double selfLoop;          //Self-loop weight found in this thread's slice
+    double eix;               //Counter of the current community (written by its owner only)
+    long maxIndex;            //Best community among the ones owned by this thread
+    double maxGain;
+    double maxCounter;        //Its counter (e_iy)
+} hubScratch;
+
+typedef struct
+{
+    hashLocalMap table; //Community ID -> position in cid/delta (grows when full)
+    long capacity;      //Entries available in cid/delta
+    long num;           //Communities touched by this thread in the current sweep
+    long *cid;          //Touched communities, in first-touch order
+    Comm *delta;        //Accumulated change of size and degree for each of them
+    long *bucketStart;  //nT+1 boundaries of the entries grouped by owner thread
+    long *bucketedCid;  //Entries grouped by owner thread: used for the merge
+    Comm *bucketedDelta;
+} deltaBuffer;
+
+typedef struct
+{
+    long numWords;      //64 vertices per word
+    unsigned long *bits; //Concurrent marking: one bit per vertex, set with an atomic OR
+    long *list;         //Marked vertices in increasing order, after compactFrontier()
+    long num;           //Entries in list
+    long *threadCount;  //nT+1 per-thread counts (prefix sums) for the compaction
+} frontierSet;
+
+//Per-thread slots are CTX_PAD doubles apart so that they sit on separate cache lines
+#define CTX_PAD 8
+
+typedef struct
+{
+    int nT;             //Team size, probed once by the driver
+    int active;         //Threads used for the current graph: 1 below serialCutoff
+    long serialCutoff;  //Graphs with fewer vertices run on a single thread
+    long NV;            //Size of the graph the partition was built for
+    long *part;         //active+1 edge-balanced vertex ranges of the current graph
+    double *busyTime;   //Per-thread sweep time (nT entries)
+    double *threadSum;  //Per-thread partial sums, CTX_PAD apart (nT*CTX_PAD entries)
+} runtimeContext;
+
+typedef struct
+{
+    long numLevels;     //Maps kept since the last composition
+    long capacity;      //Entries available in map and size
+    long **map;         //map[l][v]: community of vertex v of level l, a vertex of level l+1
+    long *size;         //Number of vertices of each level
+} clusterHierarchy;
+
 typedef struct /* the edge data structure */
 {
   long head;
@@ -80,6 +186,44 @@ typedef struct /* the graph data structure */
   edge * edgeList;         /* end   vertex of edge, sorted, secondary key      */
 } graph;
 
+/* compact CSR: the head of an edge is implied by edgeListPtrs */
+/* IdxT/WtT: <long,double> (16 bytes/edge), <int,double> (12) or <int,float> (8) */
+/* weight is NULL for an unweighted graph (every edge has weight 1)        */
+template<typename IdxT, typename WtT>
+struct compactGraphT
+{
+  long numVertices;        /* Same meaning as in graph                         */
+  long sVertices;
+  long numEdges;
+  long * edgeListPtrs;
+  IdxT * tail;             /* end vertex of each edge                          */
+  WtT * weight;            /* weight of each edge                              */
+};
+typedef compactGraphT<long, double> compactGraph;
+
+//Weight of edge j: unweighted graphs (weight == NULL) get 1 at compile time, without a load
+template<bool Weighted, typename WtT>
+inline WtT edgeWeight(const WtT *weight, long j) {
+  return Weighted ? weight[j] : (WtT) 1;
+}
+
+//Tail and weight of edge j, for the routines written once for graph and compactGraphT
+inline long edgeTail(graph *G, long j) {
+  return G->edgeList[j].tail;
+}
+template<typename IdxT, typename WtT>
+inline long edgeTail(compactGraphT<IdxT, WtT> *G, long j) {
+  return G->tail[j];
+}
+template<bool Weighted>
+inline double edgeWeightAt(graph *G, long j) {
+  return G->edgeList[j].weight;
+}
+template<bool Weighted, typename IdxT, typename WtT>
+inline double edgeWeightAt(compactGraphT<IdxT, WtT> *G, long j) {
+  return edgeWeight<Weighted>(G->weight, j);
+}
+
 struct clustering_parameters 
 {
   const char *inFile; //Input file
@@ -91,6 +235,16 @@ struct clustering_parameters
   int coloring; // Type of coloring
   int syncType; // Type of synchronization method
   int basicOpt; //If map data structure is replaced with a vector
+  long localMapCap; //Bounded-memory local maps for NoMap kernels (-1: off, 0: max degree)
+  long hubThreshold; //Vertices with a higher degree are split across threads (0: off)
+  bool atomicUpdates; //Atomics on cUpdate in place of per-thread delta buffers
+  bool inPlace; //Coarsen into the arrays of the previous level
+  bool dendrogram; //Write every level of the hierarchy to <input>_dendrogram
+  int gainKernel; //Gain argmax kernel: (0) auto (1) scalar (2) AVX2 (3) AVX-512
+  int numaPlacement; //Graph placement: (0) as loaded (1) first touch by the owner thread (2) interleaved
+  long serialCutoff; //Graphs (phases) with fewer vertices run on a single thread
+  int reorder; //Vertex reordering before clustering: (0) none (1) degree (2) RCM (3) rabbit
+  int clusterOrder; //Super-vertex ids of the next level: (0) first appearance (1) BFS over the quotient graph (2) old id
   bool threadsOpt;
   double C_thresh; //Threshold with coloring on
   long minGraphSize; //Min |V| to enable coloring
@@ -47,6 +47,17 @@ void writeGraphBinaryFormatNew(graph* G, char *filename, long weighted);
 void writeGraphMetisSimpleFormat(graph* G, char *filename);
 void writeGraphMatrixMarketFormatSymmetric(graph* G, char *filename);
 
+//Binary dendrogram (-w): "GRPDENDR", long #levels, long #vertices, then per level
+//long sizeIn, long sizeOut and long map[sizeIn]. Level 0 maps the ids of the output
+//to the vertices of phase 1 (the identity unless reordered); level k maps the
+//vertices of phase k to their communities, i.e. the vertices of phase k+1.
+#define DENDROGRAM_MAGIC "GRPDENDR"
+void openDendrogram(const char *fileName, long NV, long *inputMap);
+void addDendrogramLevel(long *C, long sizeIn, long sizeOut);
+void closeDendrogram();
+void displayDendrogram(const char *fileName);
+long* loadDendrogramLevel(const char *fileName, long *level, long *NV, long *numCommunities);
+
 using namespace std;
 
 #endif
@@ -35,22 +35,27 @@
 #include "utilityClusteringFunctions.h"
 
 void runMultiPhaseSyncType(graph *G, long *C_orig, int syncType, long minGraphSize,
-			double threshold, double C_threshold, int numThreads, int threadsOpt);
+			double threshold, double C_threshold, runtimeContext *ctx, int threadsOpt, long localMapCap);
 
 double parallelLouvainMethodFullSyncEarly(graph *G, long *C, int nThreads, double Lower,
-				double thresh, double *totTime, int *numItr,int ytype, int freedom);
+				double thresh, double *totTime, int *numItr,int ytype, int freedom, long localMapCap);
 				
 double parallelLouvainMethodFullSync(graph *G, long *C, int nThreads, double Lower,
-				double thresh, double *totTime, int *numItr,int ytype, int freedom);
+				double thresh, double *totTime, int *numItr,int ytype, int freedom, long localMapCap);
 				
 double parallelLouvianMethodEarlyTerminate(graph *G, long *C, int nThreads, double Lower,
-				double thresh, double *totTime, int *numItr);
+				double thresh, double *totTime, int *numItr, long localMapCap);
+
+// Define in parallelLouvainMethodAsync.cpp: lock-free in-place moves (-y 5)
+double parallelLouvainMethodAsync(graph *G, long *C, int nThreads, double Lower,
+				double thresh, double *totTime, int *numItr, long localMapCap);
 				
 // Define in fullSyncUtility.cpp
-double buildAndLockLocalMapCounter(long v, mapElement* clusterLocalMap, long* vtxPtr, edge* vtxInd,
-                               long* currCommAss, long &numUniqueClusters, omp_lock_t* vlocks, omp_lock_t* clocks, int ytype, double& eix, int freedom);
+double buildAndLockLocalMapCounter(long v, mapElement* localMap, long* vtxPtr, edge* vtxInd,
+                               long* currCommAss, long &numUniqueClusters, omp_lock_t* vlocks, omp_lock_t* clocks, int ytype, double& eix, int freedom, localMapScratch *S);
 
-void maxAndFree(long v, mapElement* clusterLocalMap, long* vtxPtr, edge* vtxInd, double selfLoop, Comm* cInfo, long* CA, 
-							double constant, long numUniqueClusters, omp_lock_t* vlocks, omp_lock_t* clocks, int ytype, double eix, double* vDegree);
+void maxAndFree(long v, mapElement* localMap, long* vtxPtr, edge* vtxInd, double selfLoop, Comm* cInfo, long* CA, 
+							double constant, long numUniqueClusters, omp_lock_t* vlocks, omp_lock_t* clocks, int ytype, double eix, double* vDegree,
+							double& exxChange, double& a2Change);
 
 #endif
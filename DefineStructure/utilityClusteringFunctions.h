@@ -38,12 +38,21 @@ using namespace std;
 
 void sumVertexDegree(edge* vtxInd, long* vtxPtr, double* vDegree, long NV, Comm* cInfo);
 
+void updateAxForOpt(Comm* cInfo, long* currCommAss, double* vDegree, long NV);
+
 double calConstantForSecondTerm(double* vDegree, long NV);
 
+//Exact modularity terms: the engines maintain them incrementally and recompute them
+//every MOD_EXACT_PERIOD iterations (instantiated for <long,double>, <int,double> and <int,float>)
+template<typename IdxT, typename WtT>
+double sumSquaredDegrees(CommT<IdxT, WtT>* cInfo, long NV);
+double sumInternalWeight(long* vtxPtr, edge* vtxInd, long* currCommAss, long NV);
+
 void initCommAss(long* pastCommAss, long* currCommAss, long NV);
+void initCommAss(long* pastCommAss, long* currCommAss, long NV, long* vtxPtr);
 
 void initCommAssOpt(long* pastCommAss, long* currCommAss, long NV, 
-		    mapElement* clusterLocalMap, long* vtxPtr, edge* vtxInd,
+		    localMapScratch* scratch, long* vtxPtr, edge* vtxInd,
 		    Comm* cInfo, double constant, double* vDegree );
 
 double buildLocalMapCounter(long adj1, long adj2, map<long, long> &clusterLocalMap, 
@@ -58,6 +67,104 @@ long max(map<long, long> &clusterLocalMap, vector<double> &Counter,
 long maxNoMap(long v, mapElement* clusterLocalMap, long* vtxPtr, double selfLoop, Comm* cInfo, double degree,
               long sc, double constant, long numUniqueClusters );
 
+long maxLocalMap(mapElement* localMap, double selfLoop, Comm* cInfo, double degree,
+                 long sc, double constant, long numUniqueClusters );
+
+//Scalar version for the narrow community types of the compact kernels (<int,double>, <int,float>)
+template<typename IdxT, typename WtT>
+long maxLocalMap(mapElement* localMap, double selfLoop, CommT<IdxT, WtT>* cInfo, double degree,
+                 long sc, double constant, long numUniqueClusters );
+
+//Gain argmax over a local map: scalar, AVX2 or AVX-512, chosen at runtime
+//Define in gainKernel.cpp
+void selectGainKernel(int kernel);
+long maxGainLocalMap(mapElement* localMap, long numUniqueClusters, Comm* cInfo,
+                     double eix, double ax, double degree, double constant, long sc);
+
+long maxDegreeOfGraph(long* vtxPtr, long NV);
+
+//Open-addressing replacement for map<long,long>: one per thread, reused across vertices
+void initHashLocalMap(hashLocalMap *H, long maxEntries);
+void freeHashLocalMap(hashLocalMap *H);
+void clearHashLocalMap(hashLocalMap *H);
+
+//Return the slot that holds cid, or the empty slot where it should go (linear probing)
+inline long findSlotHashLocalMap(hashLocalMap *H, long cid) {
+  long mask = H->tableSize - 1;
+  long slot = (long)(((unsigned long)cid * 11400714819323198485UL) >> H->shift); //Fibonacci hashing
+  while ( (H->key[slot] != -1) && (H->key[slot] != cid) ) {
+    slot = (slot + 1) & mask;
+  }
+  return slot;
+}//End of findSlotHashLocalMap()
+
+double buildLocalMapCounterHash(long v, mapElement* localMap, long* vtxPtr, edge* vtxInd,
+                                long* currCommAss, long &numUniqueClusters, hashLocalMap *H);
+
+//Dense community-indexed lookup in place of the linear scan of buildLocalMapCounterNoMap
+void initDenseSPA(denseSPA *spa, long NV);
+void freeDenseSPA(denseSPA *spa);
+
+double buildLocalMapCounterSPA(long v, mapElement* localMap, long* vtxPtr, edge* vtxInd,
+                               long* currCommAss, long &numUniqueClusters, denseSPA *spa);
+
+//Per-thread scratch of the NoMap kernels: memory proportional to max degree (or a cap)
+localMapScratch* allocLocalMapScratch(int nT, long NV, long maxDegree, long localMapCap);
+void freeLocalMapScratch(localMapScratch *S, int nT);
+mapElement* acquireLocalMap(localMapScratch *S, long degree);
+void releaseLocalMap(localMapScratch *S);
+
+double buildLocalMapCounterScratch(long v, mapElement* localMap, long* vtxPtr, edge* vtxInd,
+                                   long* currCommAss, long &numUniqueClusters, localMapScratch *S);
+
+//Kernels on the compact graph (tail[] and weight[] in place of edge[])
+//Instantiated for <long,double>, <int,double> and <int,float>; Weighted = false for weight == NULL
+//Define in compactGraph.cpp
+template<typename IdxT, typename WtT, bool Weighted>
+void sumVertexDegreeCompact(WtT* vtxWeight, long* vtxPtr, double* vDegree, long NV, CommT<IdxT, WtT>* cInfo);
+template<typename IdxT, typename WtT, bool Weighted>
+void initCommAssOptCompact(IdxT* pastCommAss, IdxT* currCommAss, long NV,
+                           localMapScratch* scratch, long* vtxPtr, IdxT* vtxTail, WtT* vtxWeight,
+                           CommT<IdxT, WtT>* cInfo, double constant, double* vDegree );
+template<typename IdxT, typename WtT, bool Weighted>
+double buildLocalMapCounterCompact(long v, mapElement* localMap, long* vtxPtr, IdxT* vtxTail, WtT* vtxWeight,
+                                   IdxT* currCommAss, long &numUniqueClusters, localMapScratch *S);
+
+//Degree-aware scheduling of a sweep: edge-balanced chunks of light vertices, hubs split across threads
+//Define in hybridScheduler.cpp
+void buildHybridSchedule(hybridSchedule *S, long *vertices, long numVertices, long *vtxPtr,
+                         long hubThreshold, int nT);
+void freeHybridSchedule(hybridSchedule *S);
+long maxHubDegree(hybridSchedule *S, long *vtxPtr);
+hubScratch* allocHubScratch(int nT, long maxDegree);
+void freeHubScratch(hubScratch *H, int nT);
+long maxHubParallel(long v, long* vtxPtr, edge* vtxInd, long* currCommAss, Comm* cInfo,
+                    double degree, double constant, hubScratch *H, double *eix, double *exxChange);
+template<typename IdxT, typename WtT, bool Weighted>
+long maxHubParallelCompact(long v, long* vtxPtr, IdxT* vtxTail, WtT* vtxWeight, IdxT* currCommAss, CommT<IdxT, WtT>* cInfo,
+                           double degree, double constant, hubScratch *H, double *eix);
+void reportThreadBusyTime(double *busyTime, int nT);
+
+//Per-thread sparse buffers for the community updates of a sweep (in place of atomics)
+//Define in communityDeltaBuffer.cpp
+deltaBuffer* allocDeltaBuffers(int nT, long initialCapacity);
+void freeDeltaBuffers(deltaBuffer *D, int nT);
+void addDeltaBuffer(deltaBuffer *D, long cid, long size, double degree);
+double mergeDeltaBuffers(deltaBuffer *D, Comm *cUpdate, long NV);
+
+//Active set of the frontier sweep: concurrent bitmap + compacted worklist
+//Define in frontierSet.cpp
+frontierSet* allocFrontierSet(long NV, int nT);
+void freeFrontierSet(frontierSet *F);
+long compactFrontier(frontierSet *F, int nT);
+//Mark v; safe to call from any thread (inline: called once per edge of a moved vertex)
+//The plain read avoids the atomic for vertices already marked.
+inline void markFrontier(frontierSet *F, long v) {
+  unsigned long mask = 1UL << (v & 63);
+  if ((F->bits[v >> 6] & mask) == 0)
+    __sync_fetch_and_or(&F->bits[v >> 6], mask);
+}
+
 double computeMerkinMetric(long* C1, long N1, long* C2, long N2);
 double computeVanDongenMetric(long* C1, long N1, long* C2, long N2);
 
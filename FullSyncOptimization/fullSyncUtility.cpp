@@ -42,8 +42,8 @@ bool byCommId(mapElement c1,mapElement c2){
 
 
 //Build the local-map data structure using vectors
-double buildAndLockLocalMapCounter(long v, mapElement* clusterLocalMap, long* vtxPtr, edge* vtxInd,
-                               long* currCommAss, long &numUniqueClusters, omp_lock_t* vlocks, omp_lock_t* clocks, int ytype, double& eix, int freedom) {
+double buildAndLockLocalMapCounter(long v, mapElement* localMap, long* vtxPtr, edge* vtxInd,
+                               long* currCommAss, long &numUniqueClusters, omp_lock_t* vlocks, omp_lock_t* clocks, int ytype, double& eix, int freedom, localMapScratch *S) {
   double selfLoop = 0;
 	long adj1  = vtxPtr[v];
 	long adj2  = vtxPtr[v+1];
@@ -63,35 +63,14 @@ double buildAndLockLocalMapCounter(long v, mapElement* clusterLocalMap, long* vt
 	
 
 	// Aggregate the neighbors and lock their Community
-	long sPosition = vtxPtr[v]+v; //Starting position of local map for v
-	long storedAlready = 0;
-
-	for(long j=adj1; j<adj2; j++) {
-		if(vtxInd[j].tail == v) {	// SelfLoop need to be recorded
-			selfLoop += vtxInd[j].weight;
-		}
-		
-		bool storedAlready = false; //Initialize to zero
-		for(long k=0; k<numUniqueClusters; k++) { //Check if it already exists
-			if(currCommAss[vtxInd[j].tail] ==  clusterLocalMap[sPosition+k].cid) {
-				storedAlready = true;
-				clusterLocalMap[sPosition + k].Counter += vtxInd[j].weight; //Increment the counter with weight
-				break;
-			}
-		}
-		if( storedAlready == false ) {	//Does not exist, add to the map
-			clusterLocalMap[sPosition + numUniqueClusters].cid     = currCommAss[vtxInd[j].tail];
-			clusterLocalMap[sPosition + numUniqueClusters].Counter = vtxInd[j].weight; //Initialize the count
-			numUniqueClusters++;
-		}
-	}//End of for(j)*/
-	eix = clusterLocalMap[sPosition].Counter - selfLoop;
+	selfLoop = buildLocalMapCounterScratch(v, localMap, vtxPtr, vtxInd, currCommAss, numUniqueClusters, S);
+	eix = localMap[0].Counter - selfLoop;
 
 	if(ytype == 1){
 		// Locking the community information for all neighbors // This lock is to protect Data: Allow to have error
-		std::sort(&clusterLocalMap[sPosition],&clusterLocalMap[sPosition+numUniqueClusters],byCommId);  
-		for(long j=sPosition; j<sPosition + numUniqueClusters; j++){
-			omp_set_lock(&clocks[clusterLocalMap[j].cid]);
+		std::sort(&localMap[0],&localMap[numUniqueClusters],byCommId);  
+		for(long j=0; j<numUniqueClusters; j++){
+			omp_set_lock(&clocks[localMap[j].cid]);
 		}
 	}
 
@@ -99,14 +78,17 @@ double buildAndLockLocalMapCounter(long v, mapElement* clusterLocalMap, long* vt
 }//End of buildLocalMapCounter()
 
 
-void maxAndFree(long v, mapElement* clusterLocalMap, long* vtxPtr, edge* vtxInd, double selfLoop, Comm* cInfo, long* CA, 
-							double constant, long numUniqueClusters, omp_lock_t* vlocks, omp_lock_t* clocks, int ytype, double eix, double* vDegree) {
+//Move v in place and release the locks taken by buildAndLockLocalMapCounter().
+//exxChange and a2Change accumulate the change of e_xx and a2_x caused by the move.
+void maxAndFree(long v, mapElement* localMap, long* vtxPtr, edge* vtxInd, double selfLoop, Comm* cInfo, long* CA, 
+							double constant, long numUniqueClusters, omp_lock_t* vlocks, omp_lock_t* clocks, int ytype, double eix, double* vDegree,
+							double& exxChange, double& a2Change) {
                                                                                 
 	long maxIndex = CA[v];	//Assign the initial value as the current community
 	long sc = CA[v];		
 	double curGain = 0;
 	double maxGain = 0;
-	long sPosition = vtxPtr[v]+v; //Starting position of local map for v
+	double maxEiy = 0;
 	double degree = vDegree[v];
 	double ax  = cInfo[sc].degree - degree;
 	double eiy = 0;
@@ -115,43 +97,49 @@ void maxAndFree(long v, mapElement* clusterLocalMap, long* vtxPtr, edge* vtxInd,
 		
 	/*********** Calculate DeltaQ using aii ***************/    
 	for(long k=0; k<numUniqueClusters; k++) {
-		if(sc != clusterLocalMap[sPosition + k].cid) {
-			ay = cInfo[clusterLocalMap[sPosition + k].cid].degree; // degree of cluster y
-			eiy = clusterLocalMap[sPosition + k].Counter; 	//Total edges incident on cluster y
+		if(sc != localMap[k].cid) {
+			ay = cInfo[localMap[k].cid].degree; // degree of cluster y
+			eiy = localMap[k].Counter; 	//Total edges incident on cluster y
 			curGain = 2*(eiy - eix) - 2*degree*(ay - ax)*constant;
 			if( (curGain > maxGain) ||
-					((curGain==maxGain) && (curGain != 0) && (clusterLocalMap[sPosition + k].cid < maxIndex)) ) {
+					((curGain==maxGain) && (curGain != 0) && (localMap[k].cid < maxIndex)) ) {
 				maxGain  = curGain;
-				maxIndex = clusterLocalMap[sPosition + k].cid;
+				maxIndex = localMap[k].cid;
+				maxEiy   = eiy;
 			}
 		}
 	}//End of for()
 
 	if (sc != maxIndex){
+		double aTarget, aSource; //Degrees of both communities just before the update
 		if(ytype == 1){
 			CA[v] = maxIndex;
+			aTarget = cInfo[maxIndex].degree;
 			cInfo[maxIndex].degree += vDegree[v];
 			cInfo[maxIndex].size += 1;
+			aSource = cInfo[sc].degree;
 			cInfo[sc].degree -= vDegree[v];
 			cInfo[sc].size -=1;
 		
 		}else{
 			CA[v] = maxIndex;
-			#pragma omp atomic update
-			cInfo[maxIndex].degree += vDegree[v];
+			#pragma omp atomic capture
+			{ aTarget = cInfo[maxIndex].degree; cInfo[maxIndex].degree += vDegree[v]; }
 			#pragma omp atomic update
 			cInfo[maxIndex].size += 1;
-			#pragma omp atomic update
-			cInfo[sc].degree -= vDegree[v];
+			#pragma omp atomic capture
+			{ aSource = cInfo[sc].degree; cInfo[sc].degree -= vDegree[v]; }
 			#pragma omp atomic update
 			cInfo[sc].size -=1;
 		}
+		exxChange += 2*(maxEiy - eix); //Exact unless a neighbor moves at the same time
+		a2Change  += degree*(2*aTarget + degree) - degree*(2*aSource - degree); //(a+d)^2 - a^2 for both
 	}
 
 	if(ytype == 1){
 		// unLock all neighbors community 	
-		for(long j=sPosition; j<sPosition + numUniqueClusters; j++){
-				omp_unset_lock(&clocks[clusterLocalMap[j].cid]);
+		for(long j=0; j<numUniqueClusters; j++){
+				omp_unset_lock(&clocks[localMap[j].cid]);
 		}
 	}
 
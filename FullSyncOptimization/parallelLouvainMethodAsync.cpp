@@ -0,0 +1,318 @@
+// **************************************************************************************************
+// Grappolo: A C++ library for parallel graph community detection
+// Hao Lu, Ananth Kalyanaraman (hao.lu@wsu.edu, ananth@eecs.wsu.edu) Washington State University
+// Mahantesh Halappanavar (hala@pnnl.gov) Pacific Northwest National Laboratory
+//
+// For citation, please cite the following paper:
+// Lu, Hao, Mahantesh Halappanavar, and Ananth Kalyanaraman. 
+// "Parallel heuristics for scalable community detection." Parallel Computing 47 (2015): 19-37.
+//
+// **************************************************************************************************
+// Copyright (c) 2016. Washington State University ("WSU"). All Rights Reserved.
+// Permission to use, copy, modify, and distribute this software and its documentation
+// for educational, research, and not-for-profit purposes, without fee, is hereby
+// granted, provided that the above copyright notice, this paragraph and the following
+// two paragraphs appear in all copies, modifications, and distributions. For
+// commercial licensing opportunities, please contact The Office of Commercialization,
+// WSU, 280/286 Lighty, PB Box 641060, Pullman, WA 99164, (509) 335-5526,
+// commercialization@wsu.edu<mailto:commercialization@wsu.edu>, https://commercialization.wsu.edu/
+
+// IN NO EVENT SHALL WSU BE LIABLE TO ANY PARTY FOR DIRECT, INDIRECT, SPECIAL, INCIDENTAL,
+// OR CONSEQUENTIAL DAMAGES, INCLUDING LOST PROFITS, ARISING OUT OF THE USE OF
+// THIS SOFTWARE AND ITS DOCUMENTATION, EVEN IF WSU HAS BEEN ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+// WSU SPECIFICALLY DISCLAIMS ANY WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. THE SOFTWARE AND
+// ACCOMPANYING DOCUMENTATION, IF ANY, PROVIDED HEREUNDER IS PROVIDED "AS IS". WSU HAS NO
+// OBLIGATION TO PROVIDE MAINTENANCE, SUPPORT, UPDATES, ENHANCEMENTS, OR MODIFICATIONS.
+// **************************************************************************************************
+
+#include "defs.h"
+#include "utilityClusteringFunctions.h"
+#include "sync_comm.h"
+
+using namespace std;
+
+//Other threads store C[] and cInfo[] with atomics while this sweep reads them:
+//every read of a live label or community goes through a relaxed atomic load
+static inline long liveLabel(long *C, long v) {
+  long c;
+#pragma omp atomic read
+  c = C[v];
+  return c;
+}//End of liveLabel()
+
+static inline double liveDegree(Comm *cInfo, long c) {
+  double d;
+#pragma omp atomic read
+  d = cInfo[c].degree;
+  return d;
+}//End of liveDegree()
+
+static inline long liveSize(Comm *cInfo, long c) {
+  long s;
+#pragma omp atomic read
+  s = cInfo[c].size;
+  return s;
+}//End of liveSize()
+
+//Same as buildLocalMapCounterScratch(), with the labels of the neighbors read atomically
+static double buildLiveLocalMap(long v, mapElement* localMap, long* vtxPtr, edge* vtxInd,
+                                long* C, long &numUniqueClusters, localMapScratch *S) {
+  double selfLoop = 0;
+  denseSPA *spa = (S->spa.slot != 0) ? &S->spa : 0;
+  hashLocalMap *H = (S->overflow != 0) ? &S->overflowHash : &S->hash;
+  long stamp = (spa != 0) ? ++(spa->stampValue) : 0;
+
+  for(long k=0; k<numUniqueClusters; k++) { //Register the existing entries
+    long cid = localMap[k].cid;
+    if (spa != 0) {
+      spa->slot[cid].stamp    = stamp;
+      spa->slot[cid].position = k;
+    } else {
+      long slot = findSlotHashLocalMap(H, cid);
+      H->key[slot] = cid;
+      H->position[slot] = k;
+      H->touched[H->numTouched++] = slot;
+    }
+  }
+
+  for(long j=vtxPtr[v]; j<vtxPtr[v+1]; j++) {
+    if(vtxInd[j].tail == v) {	// SelfLoop need to be recorded
+      selfLoop += vtxInd[j].weight;
+    }
+    long cid = liveLabel(C, vtxInd[j].tail);
+    long position = -1;
+    if (spa != 0) {
+      if (spa->slot[cid].stamp == stamp)
+        position = spa->slot[cid].position;
+      else {
+        spa->slot[cid].stamp    = stamp;
+        spa->slot[cid].position = numUniqueClusters;
+      }
+    } else {
+      long slot = findSlotHashLocalMap(H, cid);
+      if (H->key[slot] == cid)
+        position = H->position[slot];
+      else {
+        H->key[slot] = cid;
+        H->position[slot] = numUniqueClusters;
+        H->touched[H->numTouched++] = slot;
+      }
+    }
+    if (position >= 0) {	//Already exists
+      localMap[position].Counter += vtxInd[j].weight;
+    } else {	//Does not exist, add to the map
+      localMap[numUniqueClusters].cid     = cid;
+      localMap[numUniqueClusters].Counter = vtxInd[j].weight;
+      numUniqueClusters++;
+    }
+  }//End of for(j)
+
+  if (spa == 0)
+    clearHashLocalMap(H); //Leave the table empty for the next vertex
+  return selfLoop;
+}//End of buildLiveLocalMap()
+
+//Same gain, tie-break and swap protection as maxLocalMap(), with the community info read atomically
+//(scalar: the vector kernels gather cInfo[].degree with plain loads)
+static long maxLiveLocalMap(mapElement* localMap, double selfLoop, Comm* cInfo, double degree,
+                            long sc, double constant, long numUniqueClusters) {
+  long maxIndex = sc;
+  double maxGain = 0;
+  double eix = localMap[0].Counter - selfLoop;
+  double ax  = liveDegree(cInfo, sc) - degree;
+
+  for(long k=0; k<numUniqueClusters; k++) {
+    long cid = localMap[k].cid;
+    if(sc != cid) {
+      double curGain = 2*(localMap[k].Counter - eix) - 2*degree*(liveDegree(cInfo, cid) - ax)*constant;
+      if( (curGain > maxGain) ||
+         ((curGain==maxGain) && (curGain != 0) && (cid < maxIndex)) ) {
+        maxGain  = curGain;
+        maxIndex = cid;
+      }
+    }
+  }//End of for(k)
+
+  if(liveSize(cInfo, maxIndex) == 1 && liveSize(cInfo, sc) == 1 && maxIndex > sc) { //Swap protection
+    maxIndex = sc;
+  }
+  return maxIndex;
+}//End of maxLiveLocalMap()
+
+//Relaxed asynchronous (Gauss-Seidel) sweep: every vertex reads the live assignment
+//and community info, and its move is visible to the vertices processed after it.
+//No locks are taken: labels are written with an atomic store and the community
+//info is updated with atomics. The gain, the min-label tie-break and the swap
+//protection are the same as in maxLocalMap(); reads of a neighbor in the middle
+//of a move may be stale (but never torn), which only makes a decision slightly suboptimal.
+double parallelLouvainMethodAsync(graph *G, long *C, int nThreads, double Lower,
+				double thresh, double *totTime, int *numItr, long localMapCap) {
+#ifdef PRINT_DETAILED_STATS_  
+  printf("Within parallelLouvainMethodAsync()\n");
+#endif
+  if (nThreads < 1)
+    omp_set_num_threads(1);
+  else
+    omp_set_num_threads(nThreads);
+  int nT;
+#pragma omp parallel
+  {
+    nT = omp_get_num_threads();
+  }
+#ifdef PRINT_DETAILED_STATS_
+  printf("Actual number of threads: %d (requested: %d)\n", nT, nThreads);
+#endif
+  double time1, time2, time3, time4; //For timing purposes  
+  double total = 0, totItr = 0;
+  
+  long    NV        = G->numVertices;
+  long    *vtxPtr   = G->edgeListPtrs;
+  edge    *vtxInd   = G->edgeList;
+ 
+  /* Variables for computing modularity */
+  double constantForSecondTerm;
+  double prevMod=-1;
+  double currMod=-1;
+  double thresMod = thresh; //Input parameter
+  int numItrs = 0;
+  
+  /********************** Initialization **************************/
+  time1 = omp_get_wtime();
+  //Store the degree of all vertices
+  double* vDegree = (double *) malloc (NV * sizeof(double)); assert(vDegree != 0);
+  //Community info. (ai and size)
+  Comm *cInfo = (Comm *) malloc (NV * sizeof(Comm)); assert(cInfo != 0);
+
+  sumVertexDegree(vtxInd, vtxPtr, vDegree, NV , cInfo);	// Sum up the vertex degree
+  
+  /*** Compute the total edge weight (2m) and 1/2m ***/
+  constantForSecondTerm = calConstantForSecondTerm(vDegree, NV); // 1 over sum of the degree
+     
+  //Per-thread local maps sized to the max degree (or to the cap) in place of a |V|+2*|E| buffer
+  localMapScratch *scratch = allocLocalMapScratch(nT, NV, maxDegreeOfGraph(vtxPtr, NV), localMapCap);
+ 
+  //Initialize each vertex to its own cluster: C is the live assignment
+  initCommAss(C, C, NV); 
+  //Modularity terms, updated from the moves of each iteration
+  double e_xx = sumInternalWeight(vtxPtr, vtxInd, C, NV);
+  double a2_x = sumSquaredDegrees(cInfo, NV);
+  
+  time2 = omp_get_wtime();
+  printf("Time to initialize: %3.3lf\n", time2-time1);
+
+#ifdef PRINT_DETAILED_STATS_
+  printf("========================================================================================================\n");
+  printf("Itr      NV         Moved           Curr-Mod\n");
+  printf("========================================================================================================\n");
+#endif
+#ifdef PRINT_TERSE_STATS_
+  printf("=====================================================\n");
+  printf("Itr      Curr-Mod         T/Itr(s)      T-Cumulative\n");
+  printf("=====================================================\n");
+#endif
+  //Start maximizing modularity
+  while(true) {
+    numItrs++;    
+    time1 = omp_get_wtime();
+    long numMoved = 0;
+    double exxChange = 0, a2Change = 0;
+
+    //Dynamic chunks: a thread that finishes early keeps taking vertices, no barrier per vertex
+#pragma omp parallel for schedule(dynamic, 256) reduction(+:numMoved) reduction(+:exxChange) reduction(+:a2Change)
+    for (long i=0; i<NV; i++) {
+      long adj1 = vtxPtr[i];
+      long adj2 = vtxPtr[i+1];
+      if(adj1 == adj2)
+        continue;
+      long sc = C[i]; //Only this iteration of the loop writes C[i]
+      localMapScratch *S = &scratch[omp_get_thread_num()];
+      mapElement *localMap = acquireLocalMap(S, adj2-adj1); //Local map for i
+      long numUniqueClusters = 1;
+      localMap[0].Counter = 0;  //Initialize the counter to ZERO (no edges incident yet)
+      localMap[0].cid = sc;     //Initialize with current community
+      //Find unique cluster ids and #of edges incident (eicj) to them from the live labels
+      double selfLoop = buildLiveLocalMap(i, localMap, vtxPtr, vtxInd, C, numUniqueClusters, S);
+      long target = maxLiveLocalMap(localMap, selfLoop, cInfo, vDegree[i], sc,
+                                    constantForSecondTerm, numUniqueClusters);
+      if(target != sc) {
+        double eiy = 0;
+        for(long k=1; k<numUniqueClusters; k++) {
+          if(localMap[k].cid == target) {
+            eiy = localMap[k].Counter;
+            break;
+          }
+        }
+        double degree = vDegree[i];
+        double aTarget, aSource; //Degrees of both communities just before the update
+#pragma omp atomic write
+        C[i] = target;
+#pragma omp atomic capture
+        { aTarget = cInfo[target].degree; cInfo[target].degree += degree; }
+#pragma omp atomic update
+        cInfo[target].size += 1;
+#pragma omp atomic capture
+        { aSource = cInfo[sc].degree; cInfo[sc].degree -= degree; }
+#pragma omp atomic update
+        cInfo[sc].size -= 1;
+        exxChange += 2*(eiy - (localMap[0].Counter - selfLoop)); //Exact unless a neighbor moves at the same time
+        a2Change  += degree*(2*aTarget + degree) - degree*(2*aSource - degree); //(a+d)^2 - a^2 for both
+        numMoved++;
+      }
+      releaseLocalMap(S);
+    }//End of for(i)
+    time2 = omp_get_wtime();
+    
+    time3 = omp_get_wtime();
+    //Neighbors moving at the same time make the e_xx update approximate:
+    //recompute both terms exactly every MOD_EXACT_PERIOD iterations and before stopping
+    e_xx += exxChange;
+    a2_x += a2Change;
+    currMod = (e_xx*(double)constantForSecondTerm) - (a2_x*(double)constantForSecondTerm*(double)constantForSecondTerm);
+    if ((numItrs % MOD_EXACT_PERIOD == 0) || ((currMod - prevMod) < thresMod)) {
+      e_xx = sumInternalWeight(vtxPtr, vtxInd, C, NV);
+      a2_x = sumSquaredDegrees(cInfo, NV);
+      currMod = (e_xx*(double)constantForSecondTerm) - (a2_x*(double)constantForSecondTerm*(double)constantForSecondTerm);
+    }
+    time4 = omp_get_wtime();
+    totItr = (time2-time1) + (time4-time3);
+    total += totItr;
+
+#ifdef PRINT_DETAILED_STATS_
+    printf("%d %ld %ld %3.5lf\n",numItrs, NV, numMoved, currMod);
+#endif
+#ifdef PRINT_TERSE_STATS_
+   printf("%d \t %lf \t %3.3lf  \t %3.3lf\n",numItrs, currMod, totItr, total);
+#endif
+
+    //Break if modularity gain is not sufficient
+    if((currMod - prevMod) < thresMod) {
+      break;
+    }
+    prevMod = currMod;
+    if(prevMod < Lower)
+      prevMod = Lower;
+  }//End of while(true)
+  *totTime = total; //Return back the total time for clustering
+  *numItr  = numItrs;
+
+#ifdef PRINT_DETAILED_STATS_
+  printf("========================================================================================================\n");
+  printf("Total time for %d iterations is: %lf\n",numItrs, total);  
+  printf("========================================================================================================\n");
+#endif  
+#ifdef PRINT_TERSE_STATS_
+  printf("========================================================================================================\n");
+  printf("Total time for %d iterations is: %lf\n",numItrs, total);  
+  printf("========================================================================================================\n");
+#endif
+
+  //Cleanup
+  free(vDegree);
+  free(cInfo);
+  freeLocalMapScratch(scratch, nT);
+
+  return currMod;
+}//End of parallelLouvainMethodAsync()
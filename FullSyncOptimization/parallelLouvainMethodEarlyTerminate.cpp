@@ -31,11 +31,12 @@
 #include "defs.h"
 #include "utilityClusteringFunctions.h"
 #include "sync_comm.h"
+#include "basic_util.h"
 
 using namespace std;
 
 double parallelLouvianMethodEarlyTerminate(graph *G, long *C, int nThreads, double Lower,
-				double thresh, double *totTime, int *numItr) {
+				double thresh, double *totTime, int *numItr, long localMapCap) {
 #ifdef PRINT_DETAILED_STATS_  
   printf("Within parallelLouvianMethodNoMap()\n");
 #endif
@@ -100,17 +101,23 @@ double parallelLouvianMethodEarlyTerminate(graph *G, long *C, int nThreads, doub
 	bool* verT = (bool *) malloc (NV * sizeof(bool)); assert(verT != 0);	
 	
 	
-  //Vectors used in place of maps: Total size = |V|+2*|E| -- The |V| part takes care of self loop
-  mapElement* clusterLocalMap = (mapElement *) malloc ((NV + 2*NE) * sizeof(mapElement)); assert(clusterLocalMap != 0);
+  //Per-thread local maps sized to the max degree (or to the cap) in place of a |V|+2*|E| buffer
+  localMapScratch *scratch = allocLocalMapScratch(nT, NV, maxDegreeOfGraph(vtxPtr, NV), localMapCap);
   //double* Counter             = (double *)     malloc ((NV + 2*NE) * sizeof(double));     assert(Counter != 0);
  
   //Initialize each vertex to its own cluster
 //  initCommAss(pastCommAss, currCommAss, NV); 
-  initCommAssOpt(pastCommAss, currCommAss, NV, clusterLocalMap, vtxPtr, vtxInd, cInfo, constantForSecondTerm, vDegree);
+  initCommAssOpt(pastCommAss, currCommAss, NV, scratch, vtxPtr, vtxInd, cInfo, constantForSecondTerm, vDegree);
 	#pragma omp parallel for
     for (long i=0; i<NV; i++) {
       verT[i] = false;
+      clusterWeightInternal[i] = 0;
     }
+  //Terminated vertices keep their e_ix: e_xx is updated from the others only
+  double e_xx = 0;
+  double a2_x = sumSquaredDegrees(cInfo, NV); //Maintained from the community updates
+  //Edge-balanced vertex ranges for the sweep (one per thread)
+  long *part = buildEdgePartition(vtxPtr, NV, nT);
 
   
   time2 = omp_get_wtime();
@@ -133,10 +140,13 @@ double parallelLouvianMethodEarlyTerminate(graph *G, long *C, int nThreads, doub
 	termNodes = 0;
 	
     /* Re-initialize datastructures */
-#pragma omp parallel for reduction(+:termNodes)
+    double exxChange = 0;
+#pragma omp parallel for reduction(+:termNodes) reduction(+:exxChange)
     for (long i=0; i<NV; i++) {
-      if(!verT[i])
+      if(!verT[i]) {
+        exxChange -= clusterWeightInternal[i]; //Replaced by the new e_ix
         clusterWeightInternal[i] = 0; 
+      }
       cUpdate[i].degree =0;
       cUpdate[i].size =0;
 			if(verT[i])
@@ -146,8 +156,10 @@ double parallelLouvianMethodEarlyTerminate(graph *G, long *C, int nThreads, doub
     long totalEdgeTravel= 0;
 	long totalUniqueComm = 0;
 	
-#pragma omp parallel for reduction(+:totalEdgeTravel), reduction(+:totalUniqueComm)
-    for (long i=0; i<NV; i++) {
+#pragma omp parallel reduction(+:totalEdgeTravel), reduction(+:totalUniqueComm), reduction(+:exxChange)
+  {
+    int tid = omp_get_thread_num();
+    for (long i=part[tid]; i<part[tid+1]; i++) {
 		  if(verT[i])
 				continue;
       long adj1 = vtxPtr[i];
@@ -163,18 +175,21 @@ double parallelLouvianMethodEarlyTerminate(graph *G, long *C, int nThreads, doub
 	    //Add v's current cluster:
 	    if(adj1 != adj2){
         //Add the current cluster of i to the local map
-        long sPosition = vtxPtr[i]+i; //Starting position of local map for i
-        clusterLocalMap[sPosition].Counter = 0;          //Initialize the counter to ZERO (no edges incident yet)
-        clusterLocalMap[sPosition].cid = currCommAss[i]; //Initialize with current community
+        localMapScratch *S = &scratch[omp_get_thread_num()];
+        mapElement *localMap = acquireLocalMap(S, adj2-adj1); //Local map for i
+        localMap[0].Counter = 0;          //Initialize the counter to ZERO (no edges incident yet)
+        localMap[0].cid = currCommAss[i]; //Initialize with current community
         numUniqueClusters++; //Added the first entry
           
 	      //Find unique cluster ids and #of edges incident (eicj) to them
-          selfLoop = buildLocalMapCounterNoMap(i, clusterLocalMap, vtxPtr, vtxInd, currCommAss, numUniqueClusters);
+          selfLoop = buildLocalMapCounterScratch(i, localMap, vtxPtr, vtxInd, currCommAss, numUniqueClusters, S);
 	      // Update delta Q calculation
-	      clusterWeightInternal[i] += clusterLocalMap[sPosition].Counter; //(e_ix)
+	      clusterWeightInternal[i] += localMap[0].Counter; //(e_ix)
+	      exxChange += localMap[0].Counter;
 	      //Calculate the max
-	      targetCommAss[i] = maxNoMap(i, clusterLocalMap, vtxPtr, selfLoop, cInfo, vDegree[i], currCommAss[i],
+	      targetCommAss[i] = maxLocalMap(localMap, selfLoop, cInfo, vDegree[i], currCommAss[i],
                                       constantForSecondTerm, numUniqueClusters);
+	      releaseLocalMap(S);
               //assert((targetCommAss[i] >= 0)&&(targetCommAss[i] < NV));
       } else {
 		    targetCommAss[i] = -1;	
@@ -207,17 +222,18 @@ double parallelLouvianMethodEarlyTerminate(graph *G, long *C, int nThreads, doub
       }//End of If()      
         //numClustSize = 0;
     }//End of for(i)
+  }//End of parallel region
     time2 = omp_get_wtime();
  
-    time3 = omp_get_wtime();    
-    double e_xx = 0;
-    double a2_x = 0;	
-
-#pragma omp parallel for \
-  reduction(+:e_xx) reduction(+:a2_x)
-    for (long i=0; i<NV; i++) {
-      e_xx += clusterWeightInternal[i];
-      a2_x += (cInfo[i].degree)*(cInfo[i].degree);
+    time3 = omp_get_wtime();
+    e_xx += exxChange;
+    if (numItrs % MOD_EXACT_PERIOD == 0) { //Bound the drift
+      e_xx = 0;
+#pragma omp parallel for reduction(+:e_xx)
+      for (long i=0; i<NV; i++) {
+        e_xx += clusterWeightInternal[i];
+      }
+      a2_x = sumSquaredDegrees(cInfo, NV);
     }
     time4 = omp_get_wtime();
 
@@ -241,11 +257,14 @@ double parallelLouvianMethodEarlyTerminate(graph *G, long *C, int nThreads, doub
     prevMod = currMod;
     if(prevMod < Lower)
 	prevMod = Lower;
-#pragma omp parallel for 
+    double a2Change = 0;
+#pragma omp parallel for reduction(+:a2Change)
     for (long i=0; i<NV; i++) {
+      a2Change += cUpdate[i].degree*(2*cInfo[i].degree + cUpdate[i].degree); //(a+d)^2 - a^2
       cInfo[i].size += cUpdate[i].size;
       cInfo[i].degree += cUpdate[i].degree;
     }
+    a2_x += a2Change;
     
     //Do pointer swaps to reuse memory:
     long* tmp;
@@ -281,9 +300,10 @@ double parallelLouvianMethodEarlyTerminate(graph *G, long *C, int nThreads, doub
   free(targetCommAss);
   free(vDegree);
   free(cInfo);
+  free(part);
   free(cUpdate);
   free(clusterWeightInternal);
-  free(clusterLocalMap);
+  freeLocalMapScratch(scratch, nT);
 
   return prevMod;
 }
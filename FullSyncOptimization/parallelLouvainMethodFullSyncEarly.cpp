@@ -31,11 +31,12 @@
 #include "defs.h"
 #include "utilityClusteringFunctions.h"
 #include "sync_comm.h"
+#include "basic_util.h"
 
 using namespace std;
 
 double parallelLouvainMethodFullSyncEarly(graph *G, long *C, int nThreads, double Lower,
-				double thresh, double *totTime, int *numItr,int ytype, int freedom) {
+				double thresh, double *totTime, int *numItr,int ytype, int freedom, long localMapCap) {
 #ifdef PRINT_DETAILED_STATS_  
   printf("Within parallelLouvianMethodNoMap()\n");
 #endif
@@ -77,16 +78,13 @@ double parallelLouvainMethodFullSyncEarly(graph *G, long *C, int nThreads, doubl
   omp_lock_t* vlocks = (omp_lock_t*) malloc (NV*sizeof(*vlocks));
   omp_lock_t* clocks = (omp_lock_t*) malloc (NV*sizeof(*clocks));
 
-  //use for Modularity calculation (eii)
-  double* clusterWeightInternal = (double*) malloc (NV*sizeof(double)); assert(clusterWeightInternal != 0);
-
   sumVertexDegree(vtxInd, vtxPtr, vDegree, NV , cInfo);	// Sum up the vertex degree
   
   /*** Compute the total edge weight (2m) and 1/2m ***/
   constantForSecondTerm = calConstantForSecondTerm(vDegree, NV); // 1 over sum of the degree
      
-  //Vectors used in place of maps: Total size = |V|+2*|E| -- The |V| part takes care of self loop
-  mapElement* clusterLocalMap = (mapElement *) malloc ((NV + 2*NE) * sizeof(mapElement)); assert(clusterLocalMap != 0);
+  //Per-thread local maps sized to the max degree (or to the cap) in place of a |V|+2*|E| buffer
+  localMapScratch *scratch = allocLocalMapScratch(nT, NV, maxDegreeOfGraph(vtxPtr, NV), localMapCap);
 
   
   //Store previous iteration's community assignment
@@ -118,7 +116,12 @@ double parallelLouvainMethodFullSyncEarly(graph *G, long *C, int nThreads, doubl
     omp_init_lock(&vlocks[i]);
     omp_init_lock(&clocks[i]);
   }
+  //Modularity terms, updated from the moves of each iteration
+  double e_xx = sumInternalWeight(vtxPtr, vtxInd, C, NV);
+  double a2_x = sumSquaredDegrees(cInfo, NV);
 
+  //Edge-balanced vertex ranges for the sweep (one per thread)
+  long *part = buildEdgePartition(vtxPtr, NV, nT);
 
 #ifdef PRINT_DETAILED_STATS_
   printf("========================================================================================================\n");
@@ -138,9 +141,12 @@ double parallelLouvainMethodFullSyncEarly(graph *G, long *C, int nThreads, doubl
     
 	long totalEdgeTravel= 0;
 	long totalUniqueComm = 0;
+	double exxChange = 0, a2Change = 0;
 	
-	#pragma omp parallel for reduction(+:totalEdgeTravel), reduction(+:totalUniqueComm)
-    for (long i=0; i<NV; i++) {
+#pragma omp parallel reduction(+:totalEdgeTravel), reduction(+:totalUniqueComm), reduction(+:exxChange), reduction(+:a2Change)
+  {
+    int tid = omp_get_thread_num();
+    for (long i=part[tid]; i<part[tid+1]; i++) {
 		if(verT[i])
 			continue;
       long adj1 = vtxPtr[i];
@@ -151,17 +157,19 @@ double parallelLouvainMethodFullSyncEarly(graph *G, long *C, int nThreads, doubl
 	    //Add v's current cluster:
 	    if(adj1 != adj2){
 			//Add the current cluster of i to the local map
-			long sPosition = vtxPtr[i]+i; //Starting position of local map for i
+			localMapScratch *S = &scratch[omp_get_thread_num()];
+			mapElement *localMap = acquireLocalMap(S, adj2-adj1); //Local map for i
 			double eix;        
-			clusterLocalMap[sPosition].Counter = 0;          //Initialize the counter to ZERO (no edges incident yet)
-			clusterLocalMap[sPosition].cid = C[i]; //Initialize with current community
+			localMap[0].Counter = 0;          //Initialize the counter to ZERO (no edges incident yet)
+			localMap[0].cid = C[i]; //Initialize with current community
 			numUniqueClusters++; //Added the first entry
           
 			//Find unique cluster ids and #of edges incident (eicj) to them
-			selfLoop = buildAndLockLocalMapCounter(i, clusterLocalMap, vtxPtr, vtxInd, C, numUniqueClusters, vlocks, clocks, ytype, eix, freedom);
+			selfLoop = buildAndLockLocalMapCounter(i, localMap, vtxPtr, vtxInd, C, numUniqueClusters, vlocks, clocks, ytype, eix, freedom, S);
 			// Update delta Q calculation
 			//Calculate the max
-			maxAndFree(i, clusterLocalMap, vtxPtr, vtxInd, selfLoop, cInfo, C, constantForSecondTerm, numUniqueClusters, vlocks, clocks, ytype, eix, vDegree);
+			maxAndFree(i, localMap, vtxPtr, vtxInd, selfLoop, cInfo, C, constantForSecondTerm, numUniqueClusters, vlocks, clocks, ytype, eix, vDegree, exxChange, a2Change);
+			releaseLocalMap(S);
             //assert((targetCommAss[i] >= 0)&&(targetCommAss[i] < NV));
 			  
 			if(numItrs > 2 && C[i] == currCommAss[i] && pastCommAss[i]==currCommAss[i]){
@@ -178,36 +186,21 @@ double parallelLouvainMethodFullSyncEarly(graph *G, long *C, int nThreads, doubl
       }
 	  totalUniqueComm += numUniqueClusters;
     }//End of for(i)
+  }//End of parallel region
     time2 = omp_get_wtime();
     
-		time3 = omp_get_wtime();    
-    double e_xx = 0;
-    double a2_x = 0;	
-
-
-		// Calculate Modularity
-		#pragma omp parallel for  //Parallelize on each vertex
-		for (long i =0; i<NV;i++){
-			clusterWeightInternal[i] = 0;
-		}
-		#pragma omp parallel for  //Parallelize on each vertex
-		for (long i=0; i<NV; i++) {
-			long adj1 = vtxPtr[i];
-			long adj2 = vtxPtr[i+1];
-			for(long j=adj1; j<adj2; j++) {
-				if(C[vtxInd[j].tail] == C[i]){
-					clusterWeightInternal[i] += vtxInd[j].weight;
-				}
-			}
-		}		
-		#pragma omp parallel for reduction(+:e_xx) reduction(+:a2_x)
-    for (long i=0; i<NV; i++) {
-      e_xx += clusterWeightInternal[i];
-      a2_x += (cInfo[i].degree)*(cInfo[i].degree);
+    time3 = omp_get_wtime();
+    //Neighbors moving at the same time make the e_xx update approximate:
+    //recompute both terms exactly every MOD_EXACT_PERIOD iterations and before stopping
+    e_xx += exxChange;
+    a2_x += a2Change;
+    currMod = (e_xx*(double)constantForSecondTerm) - (a2_x*(double)constantForSecondTerm*(double)constantForSecondTerm);
+    if ((numItrs % MOD_EXACT_PERIOD == 0) || ((currMod - prevMod) < thresMod)) {
+      e_xx = sumInternalWeight(vtxPtr, vtxInd, C, NV);
+      a2_x = sumSquaredDegrees(cInfo, NV);
+      currMod = (e_xx*(double)constantForSecondTerm) - (a2_x*(double)constantForSecondTerm*(double)constantForSecondTerm);
     }
     time4 = omp_get_wtime();
-
-    currMod = (e_xx*(double)constantForSecondTerm) - (a2_x*(double)constantForSecondTerm*(double)constantForSecondTerm);
     totItr = (time2-time1) + (time4-time3);
     total += totItr;
 
@@ -242,8 +235,8 @@ double parallelLouvainMethodFullSyncEarly(graph *G, long *C, int nThreads, doubl
   //Cleanup
   free(vDegree);
   free(cInfo);
-  free(clusterWeightInternal);
-  free(clusterLocalMap);
+  free(part);
+  freeLocalMapScratch(scratch, nT);
 
   return currMod;
 }
@@ -30,6 +30,7 @@
 
 #include "defs.h"
 #include "sync_comm.h"
+#include "input_output.h"
 
 using namespace std;
 //WARNING: This will overwrite the original graph data structure to 
@@ -38,11 +39,12 @@ using namespace std;
 //         Assume C_orig is initialized appropriately
 //WARNING: Graph G will be destroyed at the end of this routine
 void runMultiPhaseSyncType(graph *G, long *C_orig, int syncType, long minGraphSize,
-			double threshold, double C_threshold, int numThreads, int threadsOpt) 
+			double threshold, double C_threshold, runtimeContext *ctx, int threadsOpt, long localMapCap) 
 {
   double totTimeClustering=0, totTimeBuildingPhase=0, totTimeColoring=0, tmpTime=0;
   int tmpItr=0, totItr = 0;  
   long NV = G->numVertices;
+  int numThreads = ctx->nT;
 
  	
   /* Step 1: Find communities */
@@ -59,28 +61,34 @@ void runMultiPhaseSyncType(graph *G, long *C_orig, int syncType, long minGraphSi
   for (long i=0; i<NV; i++) {
   	C[i] = -1;
   }	
+  clusterHierarchy *H = createClusterHierarchy(); //Maps of phases 2, 3, ...
+  resetPeakRSS(); //Per-phase peaks, the peak of loading is in the summary
 	
   while(1){
     printf("===============================\n");
 	  printf("Phase %ld\n", phase);
     printf("===============================\n");
+    bindRuntimeContext(ctx, G); //Team size and partition for this graph
+    numThreads = ctx->active;
    	prevMod = currMod;
 	  
 		
 		switch (syncType){
-			case 2: currMod = parallelLouvainMethodFullSync(G, C, numThreads, currMod, threshold, &tmpTime, &tmpItr,syncType, freedom); break;
-			case 4: currMod = parallelLouvainMethodFullSyncEarly(G, C, numThreads, currMod, threshold, &tmpTime, &tmpItr,syncType, freedom); break;
-			case 3: currMod = parallelLouvianMethodEarlyTerminate(G, C, numThreads, currMod, threshold, &tmpTime, &tmpItr); break;
+			case 2: currMod = parallelLouvainMethodFullSync(G, C, numThreads, currMod, threshold, &tmpTime, &tmpItr,syncType, freedom, localMapCap); break;
+			case 4: currMod = parallelLouvainMethodFullSyncEarly(G, C, numThreads, currMod, threshold, &tmpTime, &tmpItr,syncType, freedom, localMapCap); break;
+			case 3: currMod = parallelLouvianMethodEarlyTerminate(G, C, numThreads, currMod, threshold, &tmpTime, &tmpItr, localMapCap); break;
+			case 5: currMod = parallelLouvainMethodAsync(G, C, numThreads, currMod, threshold, &tmpTime, &tmpItr, localMapCap); break;
 			default:
-				currMod = parallelLouvainMethodFullSync(G, C, numThreads, currMod, threshold, &tmpTime, &tmpItr,syncType, freedom); break;
+				currMod = parallelLouvainMethodFullSync(G, C, numThreads, currMod, threshold, &tmpTime, &tmpItr,syncType, freedom, localMapCap); break;
     }
 		
 		totTimeClustering += tmpTime;
 		totItr += tmpItr; 
   
     //Renumber the clusters contiguiously
-  	numClusters = renumberClustersContiguously(C, G->numVertices);
+  	numClusters = renumberClusters(G, C);
   	printf("Number of unique clusters: %ld\n", numClusters);
+  	addDendrogramLevel(C, G->numVertices, numClusters); //Written while the next phase runs (-w)
   
     //printf("About to update C_orig\n");
 	  //Keep track of clusters in C_orig
@@ -90,12 +98,7 @@ void runMultiPhaseSyncType(graph *G, long *C_orig, int syncType, long minGraphSi
 	  	  C_orig[i] = C[i]; //After the first phase
 	    } 	
 	  } else {
-      #pragma omp parallel for
-	    for (long i=0; i<NV; i++) {
-        assert(C_orig[i] < G->numVertices);
-        if (C_orig[i] >=0)
-	  		  C_orig[i] = C[C_orig[i]]; //Each cluster in a previous phase becomes a vertex
-	    }	
+	    pushClusterLevel(H, C, G->numVertices); //Composed into C_orig after the last phase
 	  }
     printf("Done updating C_orig\n");
 	  
@@ -107,6 +110,8 @@ void runMultiPhaseSyncType(graph *G, long *C_orig, int syncType, long minGraphSi
     //Check for modularity gain and build the graph for next phase
 	  //In case coloring is used, make sure the non-coloring routine is run at least once
     if( (currMod - prevMod) > threshold ) {
+		  long sweepPeak = getPhasePeakRSS(); //Louvain sweep of this phase
+		  resetPeakRSS();
 		  Gnew = (graph *) malloc (sizeof(graph)); assert(Gnew != 0);
 		  tmpTime =  buildNextLevelGraphOpt(G, Gnew, C, numClusters, numThreads);
 		  totTimeBuildingPhase += tmpTime;
@@ -117,6 +122,8 @@ void runMultiPhaseSyncType(graph *G, long *C_orig, int syncType, long minGraphSi
 		  G = Gnew; //Swap the pointers
       G->edgeListPtrs = Gnew->edgeListPtrs;
       G->edgeList = Gnew->edgeList;
+      placeGraph(G, numThreads); //NUMA placement of the new graph (-n)
+      reportNumaLocality(G, numThreads);
 		  
       //Free up the previous cluster & create new one of a different size
 		  free(C);
@@ -126,17 +133,23 @@ void runMultiPhaseSyncType(graph *G, long *C_orig, int syncType, long minGraphSi
 		  for (long i=0; i<numClusters; i++) {
 			  C[i] = -1;
 		  }
+		  printf("Phase %ld memory (KB): peak RSS %ld in the sweep, %ld while coarsening, %ld after\n",
+		         phase, sweepPeak, getPhasePeakRSS(), getCurrentRSS());
+		  resetPeakRSS();
 		  phase++; //Increment phase number
 		}else {
 			break; //Modularity gain is not enough. Exit.
 			}
 	   	
   } //End of while(1)
+  composeClusterHierarchy(H, C_orig, NV);
+  destroyClusterHierarchy(H);
+  printf("Phase %ld memory (KB): peak RSS %ld in the sweep\n", phase, getPhasePeakRSS());
  
   printf("********************************************\n"); 
   printf("*********    Compact Summary   *************\n");
   printf("********************************************\n");
-  printf("Number of threads              : %ld\n", numThreads);
+  printf("Number of threads              : %ld\n", ctx->nT);
   printf("Total number of phases         : %ld\n", phase);
   printf("Total number of iterations     : %ld\n", totItr);
   printf("Final number of clusters       : %ld\n", numClusters);
@@ -145,6 +158,7 @@ void runMultiPhaseSyncType(graph *G, long *C_orig, int syncType, long minGraphSi
   printf("Total time for building phases : %lf\n", totTimeBuildingPhase);
   printf("********************************************\n");
   printf("TOTAL TIME                     : %lf\n", (totTimeClustering+totTimeBuildingPhase+totTimeColoring) );
+  printf("Peak memory (RSS, KB)          : %ld\n", getPeakRSS());
   printf("********************************************\n");
 
   //Clean up:
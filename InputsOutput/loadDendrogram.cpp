@@ -0,0 +1,99 @@
+// **************************************************************************************************
+// Grappolo: A C++ library for parallel graph community detection
+// Hao Lu, Ananth Kalyanaraman (hao.lu@wsu.edu, ananth@eecs.wsu.edu) Washington State University
+// Mahantesh Halappanavar (hala@pnnl.gov) Pacific Northwest National Laboratory
+//
+// For citation, please cite the following paper:
+// Lu, Hao, Mahantesh Halappanavar, and Ananth Kalyanaraman. 
+// "Parallel heuristics for scalable community detection." Parallel Computing 47 (2015): 19-37.
+//
+// **************************************************************************************************
+// Copyright (c) 2016. Washington State University ("WSU"). All Rights Reserved.
+// Permission to use, copy, modify, and distribute this software and its documentation
+// for educational, research, and not-for-profit purposes, without fee, is hereby
+// granted, provided that the above copyright notice, this paragraph and the following
+// two paragraphs appear in all copies, modifications, and distributions. For
+// commercial licensing opportunities, please contact The Office of Commercialization,
+// WSU, 280/286 Lighty, PB Box 641060, Pullman, WA 99164, (509) 335-5526,
+// commercialization@wsu.edu<mailto:commercialization@wsu.edu>, https://commercialization.wsu.edu/
+
+// IN NO EVENT SHALL WSU BE LIABLE TO ANY PARTY FOR DIRECT, INDIRECT, SPECIAL, INCIDENTAL,
+// OR CONSEQUENTIAL DAMAGES, INCLUDING LOST PROFITS, ARISING OUT OF THE USE OF
+// THIS SOFTWARE AND ITS DOCUMENTATION, EVEN IF WSU HAS BEEN ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+// WSU SPECIFICALLY DISCLAIMS ANY WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. THE SOFTWARE AND
+// ACCOMPANYING DOCUMENTATION, IF ANY, PROVIDED HEREUNDER IS PROVIDED "AS IS". WSU HAS NO
+// OBLIGATION TO PROVIDE MAINTENANCE, SUPPORT, UPDATES, ENHANCEMENTS, OR MODIFICATIONS.
+// **************************************************************************************************
+
+#include "input_output.h"
+
+//Read the header of a dendrogram file written by openDendrogram()
+static FILE* openDendrogramFile(const char *fileName, long *numLevels, long *NV) {
+  FILE *in = fopen(fileName, "rb");
+  if (in == 0) {
+    printf("Could not open the dendrogram file: %s\n", fileName);
+    exit(1);
+  }
+  char magic[8];
+  if ((fread(magic, 1, 8, in) != 8) || (memcmp(magic, DENDROGRAM_MAGIC, 8) != 0) ||
+      (fread(numLevels, sizeof(long), 1, in) != 1) || (fread(NV, sizeof(long), 1, in) != 1)) {
+    printf("Not a dendrogram file: %s\n", fileName);
+    exit(1);
+  }
+  return in;
+}//End of openDendrogramFile()
+
+//Print the number of vertices and communities of every level
+void displayDendrogram(const char *fileName) {
+  long numLevels, NV;
+  FILE *in = openDendrogramFile(fileName, &numLevels, &NV);
+  printf("Dendrogram %s: %ld vertices, %ld levels\n", fileName, NV, numLevels);
+  for (long l=0; l<numLevels; l++) {
+    long size[2];
+    if (fread(size, sizeof(long), 2, in) != 2) {
+      printf("Truncated dendrogram file: %s\n", fileName);
+      exit(1);
+    }
+    printf("Level %ld: %ld vertices -> %ld communities\n", l, size[0], size[1]);
+    fseek(in, size[0] * sizeof(long), SEEK_CUR);
+  }
+  fclose(in);
+}//End of displayDendrogram()
+
+//Community of every vertex of the output at the given level (composition of the
+//maps of levels 0..level); *level < 0 or past the end selects (and is set to) the
+//last one. Returns an array of *NV entries and sets *numCommunities; the caller frees it.
+long* loadDendrogramLevel(const char *fileName, long *level, long *NV, long *numCommunities) {
+  long numLevels;
+  FILE *in = openDendrogramFile(fileName, &numLevels, NV);
+  if ((*level < 0) || (*level >= numLevels))
+    *level = numLevels - 1;
+  long *C = (long *) malloc (*NV * sizeof(long)); assert(C != 0);
+  long *map = (long *) malloc (*NV * sizeof(long)); assert(map != 0); //Levels only shrink
+  for (long l=0; l<=*level; l++) {
+    long size[2];
+    if ((fread(size, sizeof(long), 2, in) != 2) || (size[0] > *NV) ||
+        (fread(map, sizeof(long), size[0], in) != (size_t)size[0])) {
+      printf("Truncated dendrogram file: %s\n", fileName);
+      exit(1);
+    }
+    if (l == 0) {
+#pragma omp parallel for
+      for (long i=0; i<*NV; i++)
+        C[i] = map[i];
+    } else {
+#pragma omp parallel for
+      for (long i=0; i<*NV; i++) {
+        if (C[i] >= 0)
+          C[i] = map[C[i]];
+      }
+    }
+    *numCommunities = size[1];
+  }
+  free(map);
+  fclose(in);
+  return C;
+}//End of loadDendrogramLevel()
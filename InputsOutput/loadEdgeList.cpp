@@ -28,6 +28,7 @@
 // OBLIGATION TO PROVIDE MAINTENANCE, SUPPORT, UPDATES, ENHANCEMENTS, OR MODIFICATIONS.
 // **************************************************************************************************
 #include "input_output.h"
+#include "basic_util.h"
 #include "defs.h"
 #include "sstream"
 #include "utilityStringTokenizer.hpp"
@@ -104,52 +105,13 @@ void parse_DirectedEdgeList(graph * G, char *fileName) {
   for (long i=0; i <= NV; i++)
     edgeListPtr[i] = 0; //For first touch purposes
   
-  //////Build the EdgeListPtr Array: Cumulative addition 
+  //////Build the EdgeListPtr and edgeList Arrays: counts, prefix sum and a stable scatter
+  printf("About to build edgeList...\n");
   time1 = omp_get_wtime();
-//#pragma omp parallel for
-  for(long i=0; i<NE; i++) {
-    __sync_fetch_and_add(&edgeListPtr[tmpEdgeList[i].head+1], 1); //Leave 0th position intact
-  }
-  for (long i=0; i<NV; i++) {
-    edgeListPtr[i+1] += edgeListPtr[i]; //Prefix Sum:
-  }
-  //The last element of Cumulative will hold the total number of characters
+  buildCSRFromEdges(tmpEdgeList, NE, NV, false, edgeListPtr, edgeList);
   time2 = omp_get_wtime();
-  printf("Done cumulative addition for edgeListPtrs:  %9.6lf sec.\n", time2 - time1);
-  printf("Sanity Check: |E| = %ld, edgeListPtr[NV]= %ld\n", NE, edgeListPtr[NV]);
-  printf("*********** (%ld)\n", NV);
-  
-  //time1 = omp_get_wtime();
-  //Keep track of how many edges have been added for a vertex:
-  printf("About to allocate for added vector: %ld\n", NV);
-  long  *added  = (long *)  malloc( NV  * sizeof(long));
-  printf("Done allocating memory fors added vector\n");
-  assert( added != NULL);
-	
-	/*for(long i= 0; i<NV;i++)
-	{
-		printf("%d\n",edgeListPtr[i+1]);
-	}*/
-	
-#pragma omp parallel for
-  for (long i = 0; i < NV; i++) 
-    added[i] = 0;
-  
-  printf("About to build edgeList...\n");
-  //Build the edgeList from edgeListTmp:
-//#pragma omp parallel for
-  for(long i=0; i<NE; i++) {
-    long head      = tmpEdgeList[i].head;
-    long tail      = tmpEdgeList[i].tail;
-    double weight  = tmpEdgeList[i].weight;
-    
-    long Where = edgeListPtr[head] + __sync_fetch_and_add(&added[head], 1);   
-    edgeList[Where].head = head;
-    edgeList[Where].tail = tail;
-    edgeList[Where].weight = weight;
-  }
-  //time2 = omp_get_wtime();
   printf("Time for building edgeList = %lf\n", time2 - time1);
+  printf("Sanity Check: |E| = %ld, edgeListPtr[NV]= %ld\n", NE, edgeListPtr[NV]);
 
   G->sVertices    = NV;
   G->numVertices  = NV;
@@ -159,7 +121,6 @@ void parse_DirectedEdgeList(graph * G, char *fileName) {
   
   //Clean up*/
   free(tmpEdgeList);
-  free(added);
 
 }//End of parse_DirectedEdgeList()
 
@@ -241,48 +202,13 @@ void parse_UndirectedEdgeList(graph * G, char *fileName) {
   for (long i=0; i <= NV; i++)
     edgeListPtr[i] = 0; //For first touch purposes
   
-  //////Build the EdgeListPtr Array: Cumulative addition 
+  //////Build the EdgeListPtr and edgeList Arrays: counts, prefix sum and a stable scatter
+  printf("About to build edgeList...\n");
   time1 = omp_get_wtime();
-//#pragma omp parallel for
-  for(long i=0; i<NE; i++) {
-    __sync_fetch_and_add(&edgeListPtr[tmpEdgeList[i].head+1], 1); //Leave 0th position intact
-  }
-  for (long i=0; i<NV; i++) {
-    edgeListPtr[i+1] += edgeListPtr[i]; //Prefix Sum:
-		//printf("%d ",edgeListPtr[i]);
-  }
-  //The last element of Cumulative will hold the total number of characters
+  buildCSRFromEdges(tmpEdgeList, NE, NV, false, edgeListPtr, edgeList);
   time2 = omp_get_wtime();
-  printf("Done cumulative addition for edgeListPtrs:  %9.6lf sec.\n", time2 - time1);
-  printf("Sanity Check: |E| = %ld, edgeListPtr[NV]= %ld\n", NE, edgeListPtr[NV]);
-  printf("*********** (%ld)\n", NV);
-  
-  //time1 = omp_get_wtime();
-  //Keep track of how many edges have been added for a vertex:
-  printf("About to allocate for added vector: %ld\n", NV);
-  long  *added  = (long *)  malloc( NV  * sizeof(long));
-  printf("Done allocating memory fors added vector\n");
-  assert( added != NULL);
-#pragma omp parallel for
-  for (long i = 0; i < NV; i++) 
-    added[i] = 0;
-  
-  printf("About to build edgeList...\n");
-  //Build the edgeList from edgeListTmp:
-//#pragma omp parallel for
-  for(long i=0; i<NE; i++) {
-    long head      = tmpEdgeList[i].head;
-    long tail      = tmpEdgeList[i].tail;
-    double weight  = tmpEdgeList[i].weight;
-    
-    long Where = edgeListPtr[head] + __sync_fetch_and_add(&added[head], 1);   
-    edgeList[Where].head = head;
-    edgeList[Where].tail = tail;
-    edgeList[Where].weight = weight;
-
-  }
-  //time2 = omp_get_wtime();
   printf("Time for building edgeList = %lf\n", time2 - time1);
+  printf("Sanity Check: |E| = %ld, edgeListPtr[NV]= %ld\n", NE, edgeListPtr[NV]);
 
   G->sVertices    = NV;
   G->numVertices  = NV;
@@ -291,6 +217,5 @@ void parse_UndirectedEdgeList(graph * G, char *fileName) {
   G->edgeList     = edgeList;
   
   free(tmpEdgeList);
-  free(added);
 
 }//End of parse_UndirectedEdgeList()
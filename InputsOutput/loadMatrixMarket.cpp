@@ -28,6 +28,7 @@
 // OBLIGATION TO PROVIDE MAINTENANCE, SUPPORT, UPDATES, ENHANCEMENTS, OR MODIFICATIONS.
 // **************************************************************************************************
 #include "input_output.h"
+#include "basic_util.h"
 #include "defs.h"
 #include "sstream"
 #include "utilityStringTokenizer.hpp"
@@ -146,23 +147,17 @@ void parse_MatrixMarket(graph * G, char *fileName) {
 	edgeListTmp[i].head = Si;       //The S index
 	edgeListTmp[i].tail = NS+Ti;    //The T index 
 	edgeListTmp[i].weight = weight; //The value
-	edgeListPtr[Si+1]++;
-	edgeListPtr[NS+Ti+1]++;
       }
       else { //an off diagonal element: Also store the upper part
 	//LOWER PART:
 	edgeListTmp[i].head = Si;       //The S index 
 	edgeListTmp[i].tail = NS+Ti;    //The T index 
 	edgeListTmp[i].weight = weight; //The value
-	edgeListPtr[Si+1]++;
-	edgeListPtr[NS+Ti+1]++;
 	//UPPER PART:
 	edgeListTmp[NE+newNNZ].head = Ti;       //The S index
 	edgeListTmp[NE+newNNZ].tail = NS+Si;    //The T index
 	edgeListTmp[NE+newNNZ].weight = weight; //The value
 	newNNZ++; //Increment the number of edges
-	edgeListPtr[Ti+1]++;
-	edgeListPtr[NS+Si+1]++;
       }
     }
   } //End of Symmetric
@@ -184,8 +179,6 @@ void parse_MatrixMarket(graph * G, char *fileName) {
       edgeListTmp[i].head = Si;       //The S index
       edgeListTmp[i].tail = NS+Ti;    //The T index
       edgeListTmp[i].weight = weight; //The value
-      edgeListPtr[Si+1]++;
-      edgeListPtr[NS+Ti+1]++;
     }
   } //End of Real or Complex
   fclose(file); //Close the file
@@ -197,53 +190,22 @@ void parse_MatrixMarket(graph * G, char *fileName) {
     printf("to %ld \n",NE);
   }
 
-  //////Build the EdgeListPtr Array: Cumulative addition 
-  time1 = omp_get_wtime();
-  for (long i=0; i<NV; i++) {
-    edgeListPtr[i+1] += edgeListPtr[i]; //Prefix Sum:
-  }
-  //The last element of Cumulative will hold the total number of characters
-  time2 = omp_get_wtime();
-  printf("Done cumulative addition for edgeListPtrs:  %9.6lf sec.\n", time2 - time1);
-  printf("Sanity Check: 2|E| = %ld, edgeListPtr[NV]= %ld\n", NE*2, edgeListPtr[NV]);
-
   /*---------------------------------------------------------------------*/
   /* Allocate memory for G & Build it                                    */
   /*---------------------------------------------------------------------*/    
   time1 = omp_get_wtime();
   edge *edgeList = (edge *) malloc( 2*NE * sizeof(edge)); //Every edge stored twice
   assert(edgeList != 0);
-  //Keep track of how many edges have been added for a vertex:
-  long  *added    = (long *)  malloc( NV  * sizeof(long)); assert(added != 0);
-#pragma omp parallel for
-  for (long i = 0; i < NV; i++) 
-    added[i] = 0;
   time2 = omp_get_wtime();
   printf("Time for allocating memory for marks and edgeList = %lf\n", time2 - time1);
   
-  time1 = omp_get_wtime();
-
-  
+  //////Build the EdgeListPtr and edgeList Arrays: counts, prefix sum and a stable scatter
   printf("About to build edgeList...\n");
-  //Build the edgeList from edgeListTmp:
-#pragma omp parallel for
-  for(long i=0; i<NE; i++) {
-    long head  = edgeListTmp[i].head;
-    long tail  = edgeListTmp[i].tail;
-    double weight      = edgeListTmp[i].weight;
-    
-    long Where = edgeListPtr[head] + __sync_fetch_and_add(&added[head], 1);   
-    edgeList[Where].head = head;
-    edgeList[Where].tail = tail;
-    edgeList[Where].weight = weight;
-    //Now add the counter-edge:
-    Where = edgeListPtr[tail] + __sync_fetch_and_add(&added[tail], 1);
-    edgeList[Where].head = tail;
-    edgeList[Where].tail = head;
-    edgeList[Where].weight = weight;
-  }
+  time1 = omp_get_wtime();
+  buildCSRFromEdges(edgeListTmp, NE, NV, true, edgeListPtr, edgeList);
   time2 = omp_get_wtime();
   printf("Time for building edgeList = %lf\n", time2 - time1);
+  printf("Sanity Check: 2|E| = %ld, edgeListPtr[NV]= %ld\n", NE*2, edgeListPtr[NV]);
   
   G->sVertices    = NS;
   G->numVertices  = NV;
@@ -252,7 +214,6 @@ void parse_MatrixMarket(graph * G, char *fileName) {
   G->edgeList     = edgeList;
   
   free(edgeListTmp);
-  free(added);
 }
 
 
@@ -374,8 +335,6 @@ void parse_MatrixMarket_Sym_AsGraph(graph * G, char *fileName) {
       edgeListTmp[newNNZ].head = Si;       //The S index 
       edgeListTmp[newNNZ].tail = Ti;       //The T index 
       edgeListTmp[newNNZ].weight = weight; //The value
-      edgeListPtr[Si+1]++;
-      edgeListPtr[Ti+1]++;
       newNNZ++;
     }//End of Else
   }//End of for loop
@@ -386,52 +345,22 @@ void parse_MatrixMarket_Sym_AsGraph(graph * G, char *fileName) {
   NE = newNNZ; //#NNZ might change
   printf("to %ld \n", NE);
 
-  //////Build the EdgeListPtr Array: Cumulative addition 
-  time1 = omp_get_wtime();
-  for (long i=0; i<NV; i++) {
-    edgeListPtr[i+1] += edgeListPtr[i]; //Prefix Sum:
-  }
-  //The last element of Cumulative will hold the total number of characters
-  time2 = omp_get_wtime();
-  printf("Done cumulative addition for edgeListPtrs:  %9.6lf sec.\n", time2 - time1);
-  printf("Sanity Check: 2|E| = %ld, edgeListPtr[NV]= %ld\n", NE*2, edgeListPtr[NV]);
-
   /*---------------------------------------------------------------------*/
   /* Allocate memory for G & Build it                                    */
-  /*---------------------------------------------------------------------*/
+  /*---------------------------------------------------------------------*/    
   time1 = omp_get_wtime();
   edge *edgeList = (edge *) malloc( 2*NE * sizeof(edge)); //Every edge stored twice
   assert(edgeList != 0);
-  //Keep track of how many edges have been added for a vertex:
-  long  *Counter = (long *) malloc (NV  * sizeof(long)); assert(Counter != 0);
-#pragma omp parallel for
-  for (long i = 0; i < NV; i++) {
-    Counter[i] = 0;
-  }
   time2 = omp_get_wtime();
   printf("Time for allocating memory for edgeList = %lf\n", time2 - time1);
+  
+  //////Build the EdgeListPtr and edgeList Arrays: counts, prefix sum and a stable scatter
   printf("About to build edgeList...\n");
-
   time1 = omp_get_wtime();
-  //Build the edgeList from edgeListTmp:
-#pragma omp parallel for
-  for(long i=0; i<NE; i++) {
-    long head     = edgeListTmp[i].head;
-    long tail     = edgeListTmp[i].tail;
-    double weight = edgeListTmp[i].weight;
-
-    long Where    = edgeListPtr[head] + __sync_fetch_and_add(&Counter[head], 1);
-    edgeList[Where].head = head;
-    edgeList[Where].tail = tail;
-    edgeList[Where].weight = weight;
-    //Now add the edge the other way:
-    Where                  = edgeListPtr[tail] + __sync_fetch_and_add(&Counter[tail], 1);
-    edgeList[Where].head   = tail;
-    edgeList[Where].tail   = head;
-    edgeList[Where].weight = weight;
-  }
+  buildCSRFromEdges(edgeListTmp, NE, NV, true, edgeListPtr, edgeList);
   time2 = omp_get_wtime();
   printf("Time for building edgeList = %lf\n", time2 - time1);
+  printf("Sanity Check: 2|E| = %ld, edgeListPtr[NV]= %ld\n", NE*2, edgeListPtr[NV]);
 
   G->sVertices    = NV;
   G->numVertices  = NV;
@@ -440,6 +369,5 @@ void parse_MatrixMarket_Sym_AsGraph(graph * G, char *fileName) {
   G->edgeList     = edgeList;
 
   free(edgeListTmp);
-  free(Counter);
 
 }//End of parse_MatrixMarket_Sym_AsGraph()
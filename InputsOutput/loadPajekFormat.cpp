@@ -28,6 +28,7 @@
 // OBLIGATION TO PROVIDE MAINTENANCE, SUPPORT, UPDATES, ENHANCEMENTS, OR MODIFICATIONS.
 // **************************************************************************************************
 #include "input_output.h"
+#include "basic_util.h"
 
 long removeEdges(long NV, long NE, edge *edgeList) {
   printf("Within removeEdges()\n");
@@ -91,8 +92,7 @@ void SortEdgesUndirected(long NV, long NE, edge *list1, edge *list2, long *ptrs)
     ptrs[list1[i].tail]++;
   }
   /* Compute start index of each bucket */
-  for (long i = 1; i < NV; i++) 
-    ptrs[i] += ptrs[i-1];
+  parallelPrefixSum(ptrs, NV);
   ptrs--;
 
   /* Move edges into its bucket's segment */
@@ -243,22 +243,6 @@ void parse_PajekFormat(graph * G, char *fileName) {
   for (long i=0; i <= NV; i++)
     edgeListPtr[i] = 0; //For first touch purposes
 
-#pragma omp parallel for
-  for(long i=0; i<NE; i++) {
-    __sync_fetch_and_add(&edgeListPtr[edgeListTmp[i].head + 1], 1); //Plus one to take care of the zeroth location
-    __sync_fetch_and_add(&edgeListPtr[edgeListTmp[i].tail + 1], 1);
-  }
-  
-  //////Build the EdgeListPtr Array: Cumulative addition 
-  time1 = omp_get_wtime();
-  for (long i=0; i<NV; i++) {
-    edgeListPtr[i+1] += edgeListPtr[i]; //Prefix Sum:
-  }
-  //The last element of Cumulative will hold the total number of characters
-  time2 = omp_get_wtime();
-  printf("Done cumulative addition for edgeListPtrs:  %9.6lf sec.\n", time2 - time1);
-  printf("Sanity Check: 2|E| = %ld, edgeListPtr[NV]= %ld\n", NE*2, edgeListPtr[NV]);
-  
   /*---------------------------------------------------------------------*/
   /* Allocate memory for G & Build it                                    */
   /*---------------------------------------------------------------------*/    
@@ -266,38 +250,16 @@ void parse_PajekFormat(graph * G, char *fileName) {
   time1 = omp_get_wtime();
   edge *edgeList = (edge *) malloc ((2*NE) * sizeof(edge)); //Every edge stored twice
   assert(edgeList != 0);
-  //Keep track of how many edges have been added for a vertex:
-  long  *added = (long *)  malloc (NV * sizeof(long)); assert (added != 0);
-#pragma omp parallel for
-  for (long i = 0; i < NV; i++) 
-    added[i] = 0;
   time2 = omp_get_wtime();  
   printf("Time for allocating memory for edgeList = %lf\n", time2 - time1);
   
-  time1 = omp_get_wtime();
-  
+  //////Build the EdgeListPtr and edgeList Arrays: counts, prefix sum and a stable scatter
   printf("About to build edgeList...\n");
-  //Build the edgeList from edgeListTmp:
-#pragma omp parallel for
-  for(long i=0; i<NE; i++) {
-    long head  = edgeListTmp[i].head;
-    long tail  = edgeListTmp[i].tail;
-    double weight      = edgeListTmp[i].weight;
-    
-    long Where = edgeListPtr[head] + __sync_fetch_and_add(&added[head], 1);   
-    edgeList[Where].head = head; 
-    edgeList[Where].tail = tail;
-    edgeList[Where].weight = weight;
-    //added[head]++;
-    //Now add the counter-edge:
-    Where = edgeListPtr[tail] + __sync_fetch_and_add(&added[tail], 1);
-    edgeList[Where].head = tail;
-    edgeList[Where].tail = head;
-    edgeList[Where].weight = weight;
-    //added[tail]++;
-  }
+  time1 = omp_get_wtime();
+  buildCSRFromEdges(edgeListTmp, NE, NV, true, edgeListPtr, edgeList);
   time2 = omp_get_wtime();
   printf("Time for building edgeList = %lf\n", time2 - time1);
+  printf("Sanity Check: 2|E| = %ld, edgeListPtr[NV]= %ld\n", NE*2, edgeListPtr[NV]);
   
   G->sVertices    = NV;
   G->numVertices  = NV;
@@ -306,7 +268,6 @@ void parse_PajekFormat(graph * G, char *fileName) {
   G->edgeList     = edgeList;
   
   free(edgeListTmp);
-  free(added);
 }
 
 /*-------------------------------------------------------*
@@ -405,21 +366,6 @@ void parse_PajekFormatUndirected(graph * G, char *fileName) {
   for (long i=0; i <= NV; i++) {
     edgeListPtr[i] = 0; //For first touch purposes
   }
-#pragma omp parallel for
-  for(long i=0; i<NE; i++) {
-    __sync_fetch_and_add(&edgeListPtr[edgeListTmp[i].head + 1], 1); //Plus one to take care of the zeroth location
-    //__sync_fetch_and_add(&edgeListPtr[edgeListTmp[i].tail + 1], 1); //No need
-  }
-  
-  //////Build the EdgeListPtr Array: Cumulative addition 
-  time1 = omp_get_wtime();
-  for (long i=0; i<NV; i++) {
-    edgeListPtr[i+1] += edgeListPtr[i]; //Prefix Sum:
-  }
-  //The last element of Cumulative will hold the total number of characters
-  time2 = omp_get_wtime();
-  printf("Done cumulative addition for edgeListPtrs:  %9.6lf sec.\n", time2 - time1);
-  printf("Sanity Check: |E| = %ld, edgeListPtr[NV]= %ld\n", NE, edgeListPtr[NV]);
   /*---------------------------------------------------------------------*/
   /* Allocate memory for G & Build it                                    */
   /*---------------------------------------------------------------------*/    
@@ -427,32 +373,16 @@ void parse_PajekFormatUndirected(graph * G, char *fileName) {
   printf("Size of edge: %ld  and size of NE*edge= %ld\n",  sizeof(edge), NE*sizeof(edge) );
   edge *edgeList = (edge *) malloc( NE * sizeof(edge)); //Every edge stored twice
   assert(edgeList != 0);
-  //Keep track of how many edges have been added for a vertex:
-  long  *added    = (long *)  malloc( NV  * sizeof(long)); assert (added != 0);
- #pragma omp parallel for
-  for (long i = 0; i < NV; i++) 
-    added[i] = 0;
-  
   time2 = omp_get_wtime();
   printf("Time for allocating memory for edgeList = %lf\n", time2 - time1);
   
-  time1 = omp_get_wtime();
-
+  //////Build the EdgeListPtr and edgeList Arrays: counts, prefix sum and a stable scatter
   printf("About to build edgeList...\n");
-  //Build the edgeList from edgeListTmp:
-#pragma omp parallel for
-  for(long i=0; i<NE; i++) {
-    long head  = edgeListTmp[i].head;
-    long tail  = edgeListTmp[i].tail;
-    double weight      = edgeListTmp[i].weight;
-    
-    long Where = edgeListPtr[head] + __sync_fetch_and_add(&added[head], 1);   
-    edgeList[Where].head = head; 
-    edgeList[Where].tail = tail;
-    edgeList[Where].weight = weight;
-  }
+  time1 = omp_get_wtime();
+  buildCSRFromEdges(edgeListTmp, NE, NV, false, edgeListPtr, edgeList);
   time2 = omp_get_wtime();
   printf("Time for building edgeList = %lf\n", time2 - time1);
+  printf("Sanity Check: |E| = %ld, edgeListPtr[NV]= %ld\n", NE, edgeListPtr[NV]);
   
   G->sVertices    = NV;
   G->numVertices  = NV;
@@ -461,7 +391,6 @@ void parse_PajekFormatUndirected(graph * G, char *fileName) {
   G->edgeList     = edgeList;
   
   free(edgeListTmp);
-  free(added);
 }
 
 
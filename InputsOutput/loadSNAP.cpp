@@ -28,6 +28,7 @@
 // OBLIGATION TO PROVIDE MAINTENANCE, SUPPORT, UPDATES, ENHANCEMENTS, OR MODIFICATIONS.
 // **************************************************************************************************
 #include "input_output.h"
+#include "basic_util.h"
 #include "utilityStringTokenizer.hpp"
 
 void parse_SNAP(graph * G, char *fileName) {
@@ -152,49 +153,13 @@ void parse_SNAP(graph * G, char *fileName) {
   for (long i=0; i <= NV; i++)
     edgeListPtr[i] = 0; //For first touch purposes
   
-  //////Build the EdgeListPtr Array: Cumulative addition 
-  time1 = omp_get_wtime();
-#pragma omp parallel for
-  for(long i=0; i<NE; i++) {
-    __sync_fetch_and_add(&edgeListPtr[tmpEdgeList[i].head+1], 1); //Leave 0th position intact
-    __sync_fetch_and_add(&edgeListPtr[tmpEdgeList[i].tail+1], 1);
-  }
-  for (long i=0; i<NV; i++) {
-    edgeListPtr[i+1] += edgeListPtr[i]; //Prefix Sum:
-  }
-  //The last element of Cumulative will hold the total number of characters
-  time2 = omp_get_wtime();
-  printf("Done cumulative addition for edgeListPtrs:  %9.6lf sec.\n", time2 - time1);
-  printf("Sanity Check: 2|E| = %ld, edgeListPtr[NV]= %ld\n", NE*2, edgeListPtr[NV]);
-  printf("*********** (%ld)\n", NV);
-  
+  //////Build the EdgeListPtr and edgeList Arrays: counts, prefix sum and a stable scatter
   printf("About to build edgeList...\n");
   time1 = omp_get_wtime();
-  //Keep track of how many edges have been added for a vertex:
-  long  *added  = (long *)  malloc( NV  * sizeof(long)); assert( added != NULL);
-#pragma omp parallel for
-  for (long i = 0; i < NV; i++) 
-    added[i] = 0;
-
-  //Build the edgeList from edgeListTmp:
-#pragma omp parallel for
-  for(long i=0; i<NE; i++) {
-    long head      = tmpEdgeList[i].head;
-    long tail      = tmpEdgeList[i].tail;
-    double weight  = tmpEdgeList[i].weight;
-    
-    long Where = edgeListPtr[head] + __sync_fetch_and_add(&added[head], 1);   
-    edgeList[Where].head = head;
-    edgeList[Where].tail = tail;
-    edgeList[Where].weight = weight;
-    //Now add the counter-edge:
-    Where = edgeListPtr[tail] + __sync_fetch_and_add(&added[tail], 1);
-    edgeList[Where].head = tail;
-    edgeList[Where].tail = head;
-    edgeList[Where].weight = weight;    
-  }
+  buildCSRFromEdges(tmpEdgeList, NE, NV, true, edgeListPtr, edgeList);
   time2 = omp_get_wtime();
   printf("Time for building edgeList = %lf\n", time2 - time1);
+  printf("Sanity Check: 2|E| = %ld, edgeListPtr[NV]= %ld\n", NE*2, edgeListPtr[NV]);
 
   G->sVertices    = NV;
   G->numVertices  = NV;
@@ -204,6 +169,5 @@ void parse_SNAP(graph * G, char *fileName) {
   
   //Clean up
   free(tmpEdgeList);
-  free(added);
 
-}
\ No newline at end of file
+}
\ No newline at end of file
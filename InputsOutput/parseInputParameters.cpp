@@ -34,7 +34,7 @@ using namespace std;
 
 clustering_parameters::clustering_parameters()
 : ftype(7), strongScaling(false), output(false), VF(false), coloring(0), syncType(0),
-threadsOpt(false), basicOpt(0), C_thresh(0.01), minGraphSize(100000), threshold(0.000001)
+threadsOpt(false), basicOpt(0), localMapCap(-1), hubThreshold(0), atomicUpdates(false), inPlace(false), dendrogram(false), gainKernel(0), numaPlacement(0), serialCutoff(2048), reorder(0), clusterOrder(0), C_thresh(0.01), minGraphSize(100000), threshold(0.000001)
 {}
 
 void clustering_parameters::usage() {
@@ -50,10 +50,22 @@ void clustering_parameters::usage() {
     cout << "Strong scaling : -s   [default=false]							" << endl;
     cout << "VF             : -v   [default=false]							" << endl;
     cout << "Output         : -o   [default=false]							" << endl;
+    cout << "Atomic updates : -a   [default=false] (atomics on cUpdate in place of per-thread buffers)" << endl;
+    cout << "In-place coarse: -i   [default=false] (next level written into the arrays of the previous one)" << endl;
+    cout << "Dendrogram     : -w   [default=false] (every level to <input>_dendrogram; see extractDendrogramLevel)" << endl;
     cout << "Coloring       : -c   [default=0]   							" << endl;
-    cout << "BasicOpt       : -b   [default=0]  (0) basic (1) replaceMap    " << endl;
-    cout << "syncType       : -y   [default=0]  (1) FullSync (2) NeighborSync (3) EarlyTerm (4) 1+3   " << endl;
+    cout << "BasicOpt       : -b   [default=0]  (0) basic (1) replaceMap (2) hashMap (3) replaceMap on compact CSR " << endl;
+    cout << "               :                   (4) replaceMap, revisiting only the active frontier " << endl;
+    cout << "syncType       : -y   [default=0]  (1) FullSync (2) NeighborSync (3) EarlyTerm (4) 1+3 (5) Async" << endl;
     cout << "--------------------------------------------------------------------------------------" << endl;
+    cout << "Local-map cap  : -l <value> -- default=off (bounded memory for NoMap kernels; 0 = max degree)" << endl;
+    cout << "Hub threshold  : -g <value> -- default=0 (off; vertices above this degree are split across threads)" << endl;
+    cout << "Gain kernel    : -k <0-3>  -- default=0 (0) best available (1) scalar (2) AVX2 (3) AVX-512" << endl;
+    cout << "NUMA placement : -n <0-2>  -- default=0 (0) as loaded (1) first touch by the sweeping thread (2) interleaved" << endl;
+    cout << "                 pin the threads for (1): OMP_PROC_BIND=close OMP_PLACES=cores" << endl;
+    cout << "Serial cutoff  : -p <value> -- default=2048 (phases on graphs with fewer vertices run on one thread)" << endl;
+    cout << "Reorder        : -r <0-3>  -- default=0 (0) input order (1) degree-descending (2) reverse Cuthill-McKee (3) rabbit-order" << endl;
+    cout << "Cluster order  : -q <0-2>  -- default=0 ids of the next level by (0) first appearance (1) BFS over the quotient graph (2) old community id" << endl;
     cout << "Min-size       : -m <value> -- default=100000" << endl;
     cout << "C-threshold    : -d <value> -- default=0.01" << endl;
     cout << "Threshold      : -t <value> -- default=0.000001" << endl;
@@ -61,7 +73,7 @@ void clustering_parameters::usage() {
 }//end of usage()
 
 bool clustering_parameters::parse(int argc, char *argv[]) {
-    static const char *opt_string = "c:b:y:svof:t:d:m:";
+    static const char *opt_string = "c:b:y:svoaiwf:t:d:m:l:g:k:n:p:r:q:";
     int opt = getopt(argc, argv, opt_string);
     while (opt != -1) {
         switch (opt) {
@@ -72,6 +84,9 @@ bool clustering_parameters::parse(int argc, char *argv[]) {
             case 's': strongScaling = true; break;
             case 'v': VF = true; break;
             case 'o': output = true; break;
+            case 'i': inPlace = true; break;
+            case 'w': dendrogram = true; break;
+            case 'a': atomicUpdates = true; break;
                 
             case 'f': ftype = atoi(optarg);
                 if((ftype >10)||(ftype<0)) {
@@ -101,6 +116,55 @@ bool clustering_parameters::parse(int argc, char *argv[]) {
                 }
                 break;
                 
+            case 'l': localMapCap = atol(optarg);
+                if(localMapCap <0) {
+                    cout << "Local-map cap must be non-negative" << endl;
+                    return false;
+                }
+                break;
+                
+            case 'g': hubThreshold = atol(optarg);
+                if(hubThreshold <0) {
+                    cout << "Hub threshold must be non-negative" << endl;
+                    return false;
+                }
+                break;
+                
+            case 'k': gainKernel = atoi(optarg);
+                if((gainKernel <0)||(gainKernel >3)) {
+                    cout << "Gain kernel must be an integer between 0 to 3" << endl;
+                    return false;
+                }
+                break;
+                
+            case 'n': numaPlacement = atoi(optarg);
+                if((numaPlacement <0)||(numaPlacement >2)) {
+                    cout << "NUMA placement must be an integer between 0 to 2" << endl;
+                    return false;
+                }
+                break;
+                
+            case 'p': serialCutoff = atol(optarg);
+                if(serialCutoff < 0) {
+                    cout << "Serial cutoff must be a non-negative integer" << endl;
+                    return false;
+                }
+                break;
+                
+            case 'r': reorder = atoi(optarg);
+                if((reorder <0)||(reorder >3)) {
+                    cout << "Reorder must be an integer between 0 to 3" << endl;
+                    return false;
+                }
+                break;
+                
+            case 'q': clusterOrder = atoi(optarg);
+                if((clusterOrder <0)||(clusterOrder >2)) {
+                    cout << "Cluster order must be 0, 1 or 2" << endl;
+                    return false;
+                }
+                break;
+                
             default:
                 cerr << "unknown argument" << endl;
                 return false;
@@ -127,6 +191,13 @@ bool clustering_parameters::parse(int argc, char *argv[]) {
     cout << "Min-size   : " << minGraphSize << endl;
     cout << "basicOpt   : " << basicOpt << endl;
     cout << "SyncType   : " << syncType << endl;
+    cout << "Local-map cap: " << localMapCap << endl;
+    cout << "Hub threshold: " << hubThreshold << endl;
+    cout << "Gain kernel  : " << gainKernel << endl;
+    cout << "NUMA placement: " << numaPlacement << endl;
+    cout << "Serial cutoff: " << serialCutoff << endl;
+    cout << "Reorder      : " << reorder << endl;
+    cout << "Cluster order: " << clusterOrder << endl;
     cout << "--------------------------------------------" << endl;
     if (coloring)
         cout << "Coloring   : TRUE" << endl;
@@ -144,6 +215,18 @@ bool clustering_parameters::parse(int argc, char *argv[]) {
         cout << "VF         : TRUE" << endl;
     else
         cout << "VF         : FLASE" << endl;
+    if(atomicUpdates)
+        cout << "Atomic updates : TRUE"  << endl;
+    else
+        cout << "Atomic updates : FALSE"  << endl;
+    if(inPlace)
+        cout << "In-place coarsening : TRUE"  << endl;
+    else
+        cout << "In-place coarsening : FALSE"  << endl;
+    if(dendrogram)
+        cout << "Dendrogram : TRUE"  << endl;
+    else
+        cout << "Dendrogram : FALSE"  << endl;
     if(output)
         cout << "Output     : TRUE"  << endl;
     else
@@ -0,0 +1,123 @@
+// **************************************************************************************************
+// Grappolo: A C++ library for parallel graph community detection
+// Hao Lu, Ananth Kalyanaraman (hao.lu@wsu.edu, ananth@eecs.wsu.edu) Washington State University
+// Mahantesh Halappanavar (hala@pnnl.gov) Pacific Northwest National Laboratory
+//
+// For citation, please cite the following paper:
+// Lu, Hao, Mahantesh Halappanavar, and Ananth Kalyanaraman. 
+// "Parallel heuristics for scalable community detection." Parallel Computing 47 (2015): 19-37.
+//
+// **************************************************************************************************
+// Copyright (c) 2016. Washington State University ("WSU"). All Rights Reserved.
+// Permission to use, copy, modify, and distribute this software and its documentation
+// for educational, research, and not-for-profit purposes, without fee, is hereby
+// granted, provided that the above copyright notice, this paragraph and the following
+// two paragraphs appear in all copies, modifications, and distributions. For
+// commercial licensing opportunities, please contact The Office of Commercialization,
+// WSU, 280/286 Lighty, PB Box 641060, Pullman, WA 99164, (509) 335-5526,
+// commercialization@wsu.edu<mailto:commercialization@wsu.edu>, https://commercialization.wsu.edu/
+
+// IN NO EVENT SHALL WSU BE LIABLE TO ANY PARTY FOR DIRECT, INDIRECT, SPECIAL, INCIDENTAL,
+// OR CONSEQUENTIAL DAMAGES, INCLUDING LOST PROFITS, ARISING OUT OF THE USE OF
+// THIS SOFTWARE AND ITS DOCUMENTATION, EVEN IF WSU HAS BEEN ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+// WSU SPECIFICALLY DISCLAIMS ANY WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. THE SOFTWARE AND
+// ACCOMPANYING DOCUMENTATION, IF ANY, PROVIDED HEREUNDER IS PROVIDED "AS IS". WSU HAS NO
+// OBLIGATION TO PROVIDE MAINTENANCE, SUPPORT, UPDATES, ENHANCEMENTS, OR MODIFICATIONS.
+// **************************************************************************************************
+
+#include "input_output.h"
+#include <pthread.h>
+
+//Writer of the binary dendrogram (layout in input_output.h). Each level is copied
+//and handed to a background thread, which writes it while the next phase runs;
+//a level waits only for the write of the previous one.
+
+typedef struct
+{
+  FILE *out;
+  long numLevels;
+  long *map;        //Level being written (owned by the writer thread)
+  long sizeIn;
+  long sizeOut;
+  pthread_t writer;
+  bool pending;     //A writer thread has been started and not joined
+} dendrogramWriter;
+
+static dendrogramWriter *dw = 0;
+
+static void* writeDendrogramLevel(void *arg) {
+  dendrogramWriter *W = (dendrogramWriter *) arg;
+  size_t count = fwrite(&W->sizeIn, sizeof(long), 1, W->out);
+  count += fwrite(&W->sizeOut, sizeof(long), 1, W->out);
+  count += fwrite(W->map, sizeof(long), W->sizeIn, W->out);
+  assert(count == (size_t)(W->sizeIn + 2));
+  free(W->map);
+  W->map = 0;
+  return 0;
+}//End of writeDendrogramLevel()
+
+static void waitForDendrogramWriter() {
+  if (dw->pending) {
+    pthread_join(dw->writer, 0);
+    dw->pending = false;
+  }
+}//End of waitForDendrogramWriter()
+
+//Start the dendrogram of a clustering of NV vertices. inputMap (may be 0 for the
+//identity) maps the ids of the output to the vertices of the first phase.
+void openDendrogram(const char *fileName, long NV, long *inputMap) {
+  FILE *out = fopen(fileName, "wb");
+  if (out == 0) {
+    printf("Could not open the dendrogram file: %s\n", fileName);
+    exit(1);
+  }
+  dw = (dendrogramWriter *) malloc (sizeof(dendrogramWriter)); assert(dw != 0);
+  dw->out = out;
+  dw->numLevels = 0;
+  dw->map = 0;
+  dw->pending = false;
+  long numLevels = 0; //Patched by closeDendrogram()
+  fwrite(DENDROGRAM_MAGIC, 1, 8, out);
+  fwrite(&numLevels, sizeof(long), 1, out);
+  fwrite(&NV, sizeof(long), 1, out);
+  printf("Dendrogram will be stored in file: %s\n", fileName);
+  addDendrogramLevel(inputMap, NV, NV);
+}//End of openDendrogram()
+
+//Append the map of a level: C[i] is the community (vertex of the next level) of
+//vertex i, with sizeIn vertices and sizeOut communities. C == 0 is the identity.
+//No-op unless openDendrogram() was called.
+void addDendrogramLevel(long *C, long sizeIn, long sizeOut) {
+  if (dw == 0)
+    return;
+  long *map = (long *) malloc (sizeIn * sizeof(long)); assert(map != 0);
+#pragma omp parallel for
+  for (long i=0; i<sizeIn; i++)
+    map[i] = (C != 0) ? C[i] : i;
+  waitForDendrogramWriter();
+  dw->map = map;
+  dw->sizeIn = sizeIn;
+  dw->sizeOut = sizeOut;
+  dw->numLevels++;
+  int rc = pthread_create(&dw->writer, 0, writeDendrogramLevel, dw);
+  if (rc != 0) //Write it here
+    writeDendrogramLevel(dw);
+  else
+    dw->pending = true;
+}//End of addDendrogramLevel()
+
+//Wait for the last level, record the number of levels and close the file
+void closeDendrogram() {
+  if (dw == 0)
+    return;
+  waitForDendrogramWriter();
+  fseek(dw->out, 8, SEEK_SET);
+  fwrite(&dw->numLevels, sizeof(long), 1, dw->out);
+  fclose(dw->out);
+  printf("Dendrogram: %ld levels written\n", dw->numLevels);
+  free(dw);
+  dw = 0;
+}//End of closeDendrogram()
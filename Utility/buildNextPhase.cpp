@@ -32,33 +32,67 @@
 #include "basic_util.h"
 using namespace std;
 
+static int clusterOrder = 0;
+
+static inline void atomicMin(long *target, long value) {
+  long old = *target;
+  while ((value < old) && !__sync_bool_compare_and_swap(target, old, value))
+    old = *target;
+}
+
 //WARNING: Will overwrite the old cluster vector
+//Valid ids (0 <= C[i] < size) are flagged in a dense array, the flags are prefix
+//summed into new ids and C is remapped, all in parallel. The new ids follow the
+//order of first appearance in C, or the order of the old ids with -q 2.
 //Returns the number of unique clusters
 long renumberClustersContiguously(long *C, long size) {
 #ifdef PRINT_DETAILED_STATS_
   printf("Within renumberClustersContiguously()\n");
 #endif
   double time1 = omp_get_wtime();
-  //Count the number of unique communities and internal edges
-  map<long, long> clusterLocalMap; //Map each neighbor's cluster to a local number
-  map<long, long>::iterator storedAlready;
   long numUniqueClusters = 0;
-
-  //Do this loop in serial
-  //Will overwrite the old cluster id with the new cluster id
-  for(long i=0; i<size; i++) {
-    assert(C[i]<size);
-    if (C[i] >= 0) { //Only if it is a valid number
-      storedAlready = clusterLocalMap.find(C[i]); //Check if it already exists
-      if( storedAlready != clusterLocalMap.end() ) {	//Already exists
-	      C[i] = storedAlready->second; //Renumber the cluster id
-      } else {
-	      clusterLocalMap[C[i]] = numUniqueClusters; //Does not exist, add to the map
-	      C[i] = numUniqueClusters; //Renumber the cluster id
-	      numUniqueClusters++; //Increment the number
-      }
-    }//End of if() 
-  }//End of for(i)
+  //rank[j+1] flags position j; after the scan rank[j] is the new id of position j
+  long *rank = (long *) malloc ((size+1) * sizeof(long)); assert(rank != 0);
+  rank[0] = 0;
+  if (clusterOrder == 2) { //Positions are the old ids
+#pragma omp parallel for
+    for (long c=0; c<size; c++)
+      rank[c+1] = 0;
+#pragma omp parallel for
+    for (long i=0; i<size; i++) {
+      assert(C[i]<size);
+      if (C[i] >= 0)
+        rank[C[i]+1] = 1; //Every writer stores the same value
+    }
+    numUniqueClusters = parallelPrefixSum(rank, size+1);
+#pragma omp parallel for
+    for (long i=0; i<size; i++) {
+      if (C[i] >= 0)
+        C[i] = rank[C[i]];
+    }
+  } else { //Positions are the vertices where each id first appears
+    long *first = (long *) malloc (size * sizeof(long)); assert(first != 0);
+#pragma omp parallel for
+    for (long c=0; c<size; c++)
+      first[c] = size;
+#pragma omp parallel for
+    for (long i=0; i<size; i++) {
+      assert(C[i]<size);
+      if ((C[i] >= 0) && (i < first[C[i]]))
+        atomicMin(&first[C[i]], i);
+    }
+#pragma omp parallel for
+    for (long i=0; i<size; i++)
+      rank[i+1] = ((C[i] >= 0) && (first[C[i]] == i)) ? 1 : 0;
+    numUniqueClusters = parallelPrefixSum(rank, size+1);
+#pragma omp parallel for
+    for (long i=0; i<size; i++) {
+      if (C[i] >= 0)
+        C[i] = rank[first[C[i]]];
+    }
+    free(first);
+  }
+  free(rank);
   time1 = omp_get_wtime() - time1;
 #ifdef PRINT_DETAILED_STATS_
   printf("Time to renumber clusters: %lf\n", time1);
@@ -67,6 +101,91 @@ long renumberClustersContiguously(long *C, long size) {
   return numUniqueClusters; //Return the number of unique cluster ids
 }//End of renumberClustersContiguously()
 
+//Numbering of the super-vertices of the next level:
+//(0) order of first appearance, i.e. by smallest member vertex; by induction this
+//    is also the order of the smallest original vertex of each community
+//(1) breadth-first over the quotient graph, so that adjacent communities get
+//    nearby ids and the next phase's neighbour lookups stay close in memory
+//(2) order of the old community ids (one flag array less than (0))
+void selectClusterOrder(int order) {
+  clusterOrder = order;
+  if (clusterOrder == 1)
+    printf("Cluster order: breadth-first over the quotient graph\n");
+  else if (clusterOrder == 2)
+    printf("Cluster order: by old community id\n");
+}//End of selectClusterOrder()
+
+//BFS over the communities of G: the neighbours of a community are the
+//communities of its members' neighbours. newId[c] is the visiting rank of c.
+template<typename GraphT>
+static void quotientBfsOrder(GraphT *G, long *C, long numClusters, long *newId) {
+  long NV = G->numVertices;
+  long *vtxPtr = G->edgeListPtrs;
+  //Members of each community (CSR)
+  long *memberPtr = (long *) malloc ((numClusters+1) * sizeof(long)); assert(memberPtr != 0);
+  long *members = (long *) malloc (NV * sizeof(long)); assert(members != 0);
+  long *queue = (long *) malloc (numClusters * sizeof(long)); assert(queue != 0);
+  buildCSRByKey(C, NV, numClusters, memberPtr, members);
+#pragma omp parallel for
+  for (long c=0; c<numClusters; c++)
+    newId[c] = -1;
+
+  long next = 0;
+  for (long s=0; s<numClusters; s++) { //One BFS per connected component
+    if (newId[s] >= 0)
+      continue;
+    long head = next;
+    newId[s] = next;
+    queue[next++] = s;
+    while (head < next) {
+      long c = queue[head++];
+      for (long k=memberPtr[c]; k<memberPtr[c+1]; k++) {
+        long v = members[k];
+        for (long j=vtxPtr[v]; j<vtxPtr[v+1]; j++) {
+          long d = C[edgeTail(G, j)];
+          if ((d >= 0) && (newId[d] < 0)) {
+            newId[d] = next;
+            queue[next++] = d;
+          }
+        }
+      }
+    }
+  }
+  assert(next == numClusters);
+  free(memberPtr);
+  free(members);
+  free(queue);
+}//End of quotientBfsOrder()
+
+//Renumber the clusters of G contiguously, in the order picked by selectClusterOrder().
+//The new ids go straight into C, so the C_orig projection that follows picks them
+//up without an extra pass over the original vertices.
+//Returns the number of unique clusters
+template<typename GraphT>
+long renumberClusters(GraphT *G, long *C) {
+  long NV = G->numVertices;
+  long numClusters = renumberClustersContiguously(C, NV);
+  if ((clusterOrder != 1) || (numClusters < 2))
+    return numClusters;
+  double time1 = omp_get_wtime();
+  long *newId = (long *) malloc (numClusters * sizeof(long)); assert(newId != 0);
+  quotientBfsOrder(G, C, numClusters, newId);
+#pragma omp parallel for
+  for (long i=0; i<NV; i++) {
+    if (C[i] >= 0)
+      C[i] = newId[C[i]];
+  }
+  free(newId);
+#ifdef PRINT_DETAILED_STATS_
+  printf("Time to order clusters (BFS): %lf\n", omp_get_wtime() - time1);
+#endif
+  return numClusters;
+}//End of renumberClusters()
+template long renumberClusters<graph>(graph *G, long *C);
+template long renumberClusters<compactGraphT<long, double> >(compactGraphT<long, double> *G, long *C);
+template long renumberClusters<compactGraphT<int, double> >(compactGraphT<int, double> *G, long *C);
+template long renumberClusters<compactGraphT<int, float> >(compactGraphT<int, float> *G, long *C);
+
 //WARNING: Will assume that the cluster id have been renumbered contiguously
 //Return the total time for building the next level of graph
 double buildNextLevelGraphOpt(graph *Gin, graph *Gout, long *C, long numUniqueClusters, int nThreads) {
@@ -78,170 +197,60 @@ double buildNextLevelGraphOpt(graph *Gin, graph *Gout, long *C, long numUniqueCl
     omp_set_num_threads(1);
   else
     omp_set_num_threads(nThreads);
-  int nT;
-  #pragma omp parallel
-  {
-    nT = omp_get_num_threads();
-  }
-  #ifdef PRINT_DETAILED_STATS_
-    printf("Actual number of threads: %d (requested: %d)\n", nT, nThreads);
-  #endif
-
-  double time1, time2, TotTime=0; //For timing purposes  
-  double total = 0, totItr = 0;
-  //Pointers into the input graph structure:
-  long    NV_in        = Gin->numVertices;
-  long    NE_in        = Gin->numEdges;
-  long    *vtxPtrIn    = Gin->edgeListPtrs;
-  edge    *vtxIndIn    = Gin->edgeList;
-  
-  time1 = omp_get_wtime();
-  // Pointers into the output graph structure
-  long NV_out = numUniqueClusters;
-  long NE_out = 0;
-  long *vtxPtrOut = (long *) malloc ((NV_out+1)*sizeof(long)); assert(vtxPtrOut != 0);
-  vtxPtrOut[0] = 0; //First location is always a zero
-  /* Step 1 : Regroup the node into cluster node */
-  map<long,double>** cluPtrIn = (map<long,double>**) malloc (numUniqueClusters*sizeof(map<long,double>*));
-  assert(cluPtrIn != 0);
 
-  #pragma omp parallel for
-  for (long i=0; i<numUniqueClusters; i++) {
-	  cluPtrIn[i] = new map<long,double>(); 
-    (*(cluPtrIn[i]))[i] = 0; //Add for a self loop with zero weight
-  }
+  double time1 = omp_get_wtime();
+  //Every super-vertex gets a self-loop (of weight zero if the cluster has no internal edge)
+  coarsenGraph(Gin, Gout, C, numUniqueClusters, true, false);
+  double TotTime = omp_get_wtime() - time1;
+#ifdef PRINT_DETAILED_STATS_
+  printf("Total time: %3.3lf\n", TotTime);
+  printf("Mean neighbour id gap of the next level: %.1lf\n", meanNeighborGap(Gout));
+#endif
+#ifdef PRINT_TERSE_STATS_
+  printf("Total time to build next phase: %3.3lf\n", TotTime);
+#endif
   
-  #pragma omp parallel for
-  for (long i=1; i<=NV_out; i++)
-	  vtxPtrOut[i] = 1; //Count self-loops for every vertex
-
-  //Create an array of locks for each cluster
-  omp_lock_t *nlocks = (omp_lock_t *) malloc (numUniqueClusters * sizeof(omp_lock_t));
-  assert(nlocks != 0);
-
-  #pragma omp parallel for
-  for (long i=0; i<numUniqueClusters; i++) {
-    omp_init_lock(&nlocks[i]); //Initialize locks
-  }
-  time2 = omp_get_wtime();
-  TotTime += (time2-time1);
+  return TotTime;
+}//End of buildNextLevelGraphOpt()
 
-  #ifdef PRINT_DETAILED_STATS_
-    printf("Time to initialize: %3.3lf\n", time2-time1);
-  #endif
-  time1 = omp_get_wtime();
-  
-  #pragma omp parallel for
-  for (long i=0; i<NV_in; i++) {
-  	long adj1 = vtxPtrIn[i];
-	  long adj2 = vtxPtrIn[i+1];
-	  map<long, double>::iterator localIterator;
-    assert(C[i] < numUniqueClusters);
-  	//Now look for all the neighbors of this cluster
+//Same as buildNextLevelGraphOpt(), on a compact graph (no head field)
+//The weights are accumulated in double and stored back in WtT
+//Gout is always weighted: an unweighted Gin (Weighted = false) gets weights once edges are merged
+template<typename IdxT, typename WtT, bool Weighted>
+double buildNextLevelGraphCompact(compactGraphT<IdxT, WtT> *Gin, compactGraphT<IdxT, WtT> *Gout, long *C,
+                                  long numUniqueClusters, int nThreads) {
 
-    for(long j=adj1; j<adj2; j++) {
-		  long tail = vtxIndIn[j].tail; 
-		  assert(C[tail] < numUniqueClusters);			
-		  //Add the edge from one endpoint	
-		  if(C[i] >= C[tail]) {
-        omp_set_lock(&nlocks[C[i]]);  // Locking the cluster
-	  		localIterator = cluPtrIn[C[i]]->find(C[tail]); //Check if it exists			
-			  if( localIterator != cluPtrIn[C[i]]->end() ) {	//Already exists
-//				  (*(cluPtrIn[C[i]]))[C[tail]] += (long)vtxIndIn[j].weight;
-          localIterator->second += vtxIndIn[j].weight;
-			  } else {
-				  (*(cluPtrIn[C[i]]))[C[tail]] = vtxIndIn[j].weight; //Add edge i-->j
-				  __sync_fetch_and_add(&vtxPtrOut[C[i]+1], 1); 
-				  if(C[i] > C[tail]) {
-					  __sync_fetch_and_add(&NE_out, 1); //Keep track of non-self #edges
-					  __sync_fetch_and_add(&vtxPtrOut[C[tail]+1], 1); //Count edge j-->i
-				}
-			}
-        omp_unset_lock(&nlocks[C[i]]); // Unlocking the cluster
-		  }//End of if
-	  }//End of for(j)
-  }//End of for(i)  
-  
-  //Prefix sum:
-  for(long i=0; i<NV_out; i++) {
-  	vtxPtrOut[i+1] += vtxPtrOut[i];
-  }
-  
-  time2 = omp_get_wtime();
-  TotTime += (time2-time1);
-  //printf("These should match: %ld == %ld\n",(2*NE_out + NV_out), vtxPtrOut[NV_out]);
- 
-  #ifdef PRINT_DETAILED_STATS_
-    printf("Time to count edges: %3.3lf\n", time2-time1);
-  #endif
-  assert(vtxPtrOut[NV_out] == (NE_out*2+NV_out)); //Sanity check
-  time1 = omp_get_wtime();
-  
-  // Step 3 : build the edge list:
-  long numEdges   = vtxPtrOut[NV_out];
-  long realEdges  = numEdges - NE_out; //Self-loops appear once, others appear twice
-  edge *vtxIndOut = (edge *) malloc (numEdges * sizeof(edge));
-  assert (vtxIndOut != 0);
-  long *Added = (long *) malloc (NV_out * sizeof(long)); //Keep track of what got added
-  assert (Added != 0);
+#ifdef PRINT_DETAILED_STATS_
+  printf("Within buildNextLevelGraphCompact(): # of unique clusters= %ld\n",numUniqueClusters);
+#endif
+  if (nThreads < 1)
+    omp_set_num_threads(1);
+  else
+    omp_set_num_threads(nThreads);
 
-  #pragma omp parallel for
-  for (long i=0; i<NV_out; i++) {
-	  Added[i] = 0;
-  }  
-  
-  //Now add the edges in no particular order
-  #pragma omp parallel for
-  for (long i=0; i<NV_out; i++) {
-	  long Where;
-	  map<long, double>::iterator localIterator = cluPtrIn[i]->begin();
-	  //Now go through the other edges:
-	  while ( localIterator != cluPtrIn[i]->end()) {
-		  Where = vtxPtrOut[i] + __sync_fetch_and_add(&Added[i], 1);
-		  vtxIndOut[Where].head = i; //Head
-		  vtxIndOut[Where].tail = localIterator->first; //Tail
-		  vtxIndOut[Where].weight = localIterator->second; //Weight
-		  if(i != localIterator->first) {		
-			  Where = vtxPtrOut[localIterator->first] + __sync_fetch_and_add(&Added[localIterator->first], 1);
-			  vtxIndOut[Where].head = localIterator->first;
-			  vtxIndOut[Where].tail = i; //Tail
-			  vtxIndOut[Where].weight = localIterator->second; //Weight
-		  }
-		  localIterator++;
-	  }	
-  }//End of for(i)  
-  time2 = omp_get_wtime();
-  TotTime += (time2-time1);
+  double time1 = omp_get_wtime();
+  //Every super-vertex gets a self-loop (of weight zero if the cluster has no internal edge)
+  coarsenGraph<IdxT, WtT, Weighted>(Gin, Gout, C, numUniqueClusters, true);
+  double TotTime = omp_get_wtime() - time1;
 #ifdef PRINT_DETAILED_STATS_
-  printf("Time to build the graph: %3.3lf\n", time2-time1);
   printf("Total time: %3.3lf\n", TotTime);
 #endif
 #ifdef PRINT_TERSE_STATS_
   printf("Total time to build next phase: %3.3lf\n", TotTime);
 #endif
-  // Set the pointers
-  Gout->numVertices  = NV_out;
-  Gout->sVertices    = NV_out;
-  //Note: Self-loops are represented ONCE, but others appear TWICE
-  Gout->numEdges     = realEdges; //Add self loops to the #edges
-  Gout->edgeListPtrs = vtxPtrOut;
-  Gout->edgeList     = vtxIndOut;
-	
-  //Clean up
-  free(Added);
-#pragma omp parallel for
-  for (long i=0; i<numUniqueClusters; i++)
-	delete cluPtrIn[i];	
-  free(cluPtrIn);
-
-#pragma omp parallel for
-  for (long i=0; i<numUniqueClusters; i++) {
-    omp_destroy_lock(&nlocks[i]); 
-  }
-  free(nlocks);
   
   return TotTime;
-}//End of buildNextLevelGraph2()
+}//End of buildNextLevelGraphCompact()
+#define INSTANTIATE_NEXT_LEVEL_COMPACT(IdxT, WtT, Weighted) \
+  template double buildNextLevelGraphCompact<IdxT, WtT, Weighted>(compactGraphT<IdxT, WtT> *Gin, \
+                                                                  compactGraphT<IdxT, WtT> *Gout, long *C, \
+                                                                  long numUniqueClusters, int nThreads);
+INSTANTIATE_NEXT_LEVEL_COMPACT(long, double, true)
+INSTANTIATE_NEXT_LEVEL_COMPACT(int, double, true)
+INSTANTIATE_NEXT_LEVEL_COMPACT(int, float, true)
+INSTANTIATE_NEXT_LEVEL_COMPACT(long, double, false)
+INSTANTIATE_NEXT_LEVEL_COMPACT(int, double, false)
+INSTANTIATE_NEXT_LEVEL_COMPACT(int, float, false)
 
 //WARNING: Will assume that the cluster ids have been renumbered contiguously
 void buildNextLevelGraph(graph *Gin, graph *Gout, long *C, long numUniqueClusters) {
@@ -315,9 +324,7 @@ void buildNextLevelGraph(graph *Gin, graph *Gout, long *C, long numUniqueCluster
   }//End of for(i)
 	
   //Prefix sum:
-  for(long i=0; i<NV_out; i++) {
-    vtxPtrOut[i+1] += vtxPtrOut[i];
-  }
+  parallelPrefixSum(vtxPtrOut, NV_out+1);
   //printf("End Structure %ld %ld vs %ld\n",NE_out, NV_out, vtxPtrOut[NV_out]);
   assert(vtxPtrOut[NV_out] == (NE_out*2+NV_out)); //Sanity check
   
@@ -0,0 +1,103 @@
+// **************************************************************************************************
+// Grappolo: A C++ library for parallel graph community detection
+// Hao Lu, Ananth Kalyanaraman (hao.lu@wsu.edu, ananth@eecs.wsu.edu) Washington State University
+// Mahantesh Halappanavar (hala@pnnl.gov) Pacific Northwest National Laboratory
+//
+// For citation, please cite the following paper:
+// Lu, Hao, Mahantesh Halappanavar, and Ananth Kalyanaraman. 
+// "Parallel heuristics for scalable community detection." Parallel Computing 47 (2015): 19-37.
+//
+// **************************************************************************************************
+// Copyright (c) 2016. Washington State University ("WSU"). All Rights Reserved.
+// Permission to use, copy, modify, and distribute this software and its documentation
+// for educational, research, and not-for-profit purposes, without fee, is hereby
+// granted, provided that the above copyright notice, this paragraph and the following
+// two paragraphs appear in all copies, modifications, and distributions. For
+// commercial licensing opportunities, please contact The Office of Commercialization,
+// WSU, 280/286 Lighty, PB Box 641060, Pullman, WA 99164, (509) 335-5526,
+// commercialization@wsu.edu<mailto:commercialization@wsu.edu>, https://commercialization.wsu.edu/
+
+// IN NO EVENT SHALL WSU BE LIABLE TO ANY PARTY FOR DIRECT, INDIRECT, SPECIAL, INCIDENTAL,
+// OR CONSEQUENTIAL DAMAGES, INCLUDING LOST PROFITS, ARISING OUT OF THE USE OF
+// THIS SOFTWARE AND ITS DOCUMENTATION, EVEN IF WSU HAS BEEN ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+// WSU SPECIFICALLY DISCLAIMS ANY WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. THE SOFTWARE AND
+// ACCOMPANYING DOCUMENTATION, IF ANY, PROVIDED HEREUNDER IS PROVIDED "AS IS". WSU HAS NO
+// OBLIGATION TO PROVIDE MAINTENANCE, SUPPORT, UPDATES, ENHANCEMENTS, OR MODIFICATIONS.
+// **************************************************************************************************
+
+#include "defs.h"
+#include "basic_util.h"
+
+//The maps of the phases after the first are kept here instead of being projected
+//onto C_orig after every phase: each push copies a map of the size of its level,
+//and the original vertices are visited once, when the hierarchy is composed.
+
+clusterHierarchy* createClusterHierarchy() {
+  clusterHierarchy *H = (clusterHierarchy *) malloc (sizeof(clusterHierarchy)); assert(H != 0);
+  H->numLevels = 0;
+  H->capacity  = 16;
+  H->map  = (long **) malloc (H->capacity * sizeof(long *)); assert(H->map != 0);
+  H->size = (long *) malloc (H->capacity * sizeof(long)); assert(H->size != 0);
+  return H;
+}//End of createClusterHierarchy()
+
+//Keep a copy of C: the community of each of the size vertices of the current level
+void pushClusterLevel(clusterHierarchy *H, long *C, long size) {
+  if (H->numLevels == H->capacity) {
+    H->capacity *= 2;
+    H->map  = (long **) realloc (H->map, H->capacity * sizeof(long *)); assert(H->map != 0);
+    H->size = (long *) realloc (H->size, H->capacity * sizeof(long)); assert(H->size != 0);
+  }
+  long *map = (long *) malloc (size * sizeof(long)); assert(map != 0);
+#pragma omp parallel for
+  for (long i=0; i<size; i++)
+    map[i] = C[i];
+  H->map[H->numLevels]  = map;
+  H->size[H->numLevels] = size;
+  H->numLevels++;
+}//End of pushClusterLevel()
+
+//Apply the kept levels to C_orig (NV entries, ids of the first kept level).
+//The maps are composed from the top: every vertex of a level jumps straight to
+//the top-level community of its parent, so each level is one parallel pass over
+//its own vertices, and C_orig is visited once. The hierarchy is empty afterwards,
+//so this can also be called between phases when C_orig is needed early.
+void composeClusterHierarchy(clusterHierarchy *H, long *C_orig, long NV) {
+  if (H->numLevels == 0)
+    return;
+  double time1 = omp_get_wtime();
+  for (long l=H->numLevels-2; l>=0; l--) {
+    long *map = H->map[l];
+    long *parent = H->map[l+1];
+#pragma omp parallel for
+    for (long v=0; v<H->size[l]; v++) {
+      assert(map[v] < H->size[l+1]);
+      if (map[v] >= 0)
+        map[v] = parent[map[v]];
+    }
+  }
+  long *top = H->map[0];
+#pragma omp parallel for
+  for (long i=0; i<NV; i++) {
+    assert(C_orig[i] < H->size[0]);
+    if (C_orig[i] >= 0)
+      C_orig[i] = top[C_orig[i]];
+  }
+#ifdef PRINT_DETAILED_STATS_
+  printf("Time to compose %ld levels into C_orig: %lf\n", H->numLevels, omp_get_wtime() - time1);
+#endif
+  for (long l=0; l<H->numLevels; l++)
+    free(H->map[l]);
+  H->numLevels = 0;
+}//End of composeClusterHierarchy()
+
+void destroyClusterHierarchy(clusterHierarchy *H) {
+  for (long l=0; l<H->numLevels; l++)
+    free(H->map[l]);
+  free(H->map);
+  free(H->size);
+  free(H);
+}//End of destroyClusterHierarchy()
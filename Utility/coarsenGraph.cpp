@@ -0,0 +1,424 @@
+// **************************************************************************************************
+// Grappolo: A C++ library for parallel graph community detection
+// Hao Lu, Ananth Kalyanaraman (hao.lu@wsu.edu, ananth@eecs.wsu.edu) Washington State University
+// Mahantesh Halappanavar (hala@pnnl.gov) Pacific Northwest National Laboratory
+//
+// For citation, please cite the following paper:
+// Lu, Hao, Mahantesh Halappanavar, and Ananth Kalyanaraman. 
+// "Parallel heuristics for scalable community detection." Parallel Computing 47 (2015): 19-37.
+//
+// **************************************************************************************************
+// Copyright (c) 2016. Washington State University ("WSU"). All Rights Reserved.
+// Permission to use, copy, modify, and distribute this software and its documentation
+// for educational, research, and not-for-profit purposes, without fee, is hereby
+// granted, provided that the above copyright notice, this paragraph and the following
+// two paragraphs appear in all copies, modifications, and distributions. For
+// commercial licensing opportunities, please contact The Office of Commercialization,
+// WSU, 280/286 Lighty, PB Box 641060, Pullman, WA 99164, (509) 335-5526,
+// commercialization@wsu.edu<mailto:commercialization@wsu.edu>, https://commercialization.wsu.edu/
+
+// IN NO EVENT SHALL WSU BE LIABLE TO ANY PARTY FOR DIRECT, INDIRECT, SPECIAL, INCIDENTAL,
+// OR CONSEQUENTIAL DAMAGES, INCLUDING LOST PROFITS, ARISING OUT OF THE USE OF
+// THIS SOFTWARE AND ITS DOCUMENTATION, EVEN IF WSU HAS BEEN ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+// WSU SPECIFICALLY DISCLAIMS ANY WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. THE SOFTWARE AND
+// ACCOMPANYING DOCUMENTATION, IF ANY, PROVIDED HEREUNDER IS PROVIDED "AS IS". WSU HAS NO
+// OBLIGATION TO PROVIDE MAINTENANCE, SUPPORT, UPDATES, ENHANCEMENTS, OR MODIFICATIONS.
+// **************************************************************************************************
+
+#include "defs.h"
+#include "utilityClusteringFunctions.h"
+#include "basic_util.h"
+#include <algorithm>
+#include <limits.h>
+
+using namespace std;
+
+//Lock-free coarsening shared by buildNextLevelGraphOpt(), buildNextLevelGraphCompact()
+//and buildNewGraphVF(): vertices are grouped by community (a CSR of members), each
+//thread aggregates the outgoing edges of one community at a time in a thread-local
+//hash table, and the output CSR is built with a count pass, a prefix sum and a fill pass.
+//The engine is written once for graph and compactGraphT (see edgeTail()/edgeWeightAt()).
+//In place (-i), the fill pass writes the lists into the edge arrays of Gin as they
+//retire (see fillInPlace()), so the two levels never coexist in full.
+
+static bool inPlaceCoarsening = false;
+
+void selectInPlaceCoarsening(bool inPlace) {
+  inPlaceCoarsening = inPlace;
+  if (inPlaceCoarsening)
+    printf("Coarsening: in place, into the arrays of the previous level\n");
+}//End of selectInPlaceCoarsening()
+
+static bool mapElementByCid(const mapElement &a, const mapElement &b) {
+  return a.cid < b.cid;
+}
+
+typedef struct
+{
+  hashLocalMap H;    //Community ID -> position in list
+  mapElement *list;  //Neighbouring communities of the current community
+  long capacity;     //Entries available in list (H is sized for as many)
+} coarsenScratch;
+
+static void growCoarsenScratch(coarsenScratch *S, long entries) {
+  if (entries <= S->capacity)
+    return;
+  if (S->capacity > 0) {
+    freeHashLocalMap(&S->H);
+    free(S->list);
+  }
+  S->capacity = entries;
+  initHashLocalMap(&S->H, entries);
+  S->list = (mapElement *) malloc (entries * sizeof(mapElement)); assert(S->list != 0);
+}//End of growCoarsenScratch()
+
+//Edge arrays of the output: an array of edges for graph, tails and weights for compactGraphT
+static void allocEdges(graph *G, long numEdges) {
+  G->edgeList = (edge *) malloc (numEdges * sizeof(edge)); assert(G->edgeList != 0);
+}
+template<typename IdxT, typename WtT>
+static void allocEdges(compactGraphT<IdxT, WtT> *G, long numEdges) {
+  G->tail   = (IdxT *) malloc (numEdges * sizeof(IdxT)); assert(G->tail != 0);
+  G->weight = (WtT *) malloc (numEdges * sizeof(WtT)); assert(G->weight != 0);
+}
+
+//Hand the edge arrays of Gin over to Gout, resized to numEdges entries (in-place mode)
+//An unweighted compact Gin has no weight array: Gout gets a new one
+static void moveEdges(graph *Gin, graph *Gout, long numEdges) {
+  long size = (numEdges > 0) ? numEdges : 1;
+  Gout->edgeList = (edge *) realloc (Gin->edgeList, size * sizeof(edge)); assert(Gout->edgeList != 0);
+  Gin->edgeList = 0;
+}
+template<typename IdxT, typename WtT>
+static void moveEdges(compactGraphT<IdxT, WtT> *Gin, compactGraphT<IdxT, WtT> *Gout, long numEdges) {
+  long size = (numEdges > 0) ? numEdges : 1;
+  Gout->tail   = (IdxT *) realloc (Gin->tail, size * sizeof(IdxT)); assert(Gout->tail != 0);
+  Gout->weight = (WtT *) realloc (Gin->weight, size * sizeof(WtT)); assert(Gout->weight != 0);
+  Gin->tail   = 0;
+  Gin->weight = 0;
+}
+
+static inline void setEdge(graph *G, long j, long head, long tail, double weight) {
+  G->edgeList[j].head   = head;
+  G->edgeList[j].tail   = tail;
+  G->edgeList[j].weight = weight;
+}
+template<typename IdxT, typename WtT>
+static inline void setEdge(compactGraphT<IdxT, WtT> *G, long j, long /*head: implied by the CSR*/, long tail, double weight) {
+  G->tail[j]   = (IdxT) tail;
+  G->weight[j] = (WtT) weight;
+}
+
+//Sum the weights of the edges from the members of c to every community they reach.
+//With withSelf the community itself is always entry 0 (a self-loop, possibly of weight 0).
+//Returns the number of entries in S->list
+template<bool Weighted, typename GraphT>
+static long aggregateCommunity(long c, long *memberPtr, long *members, GraphT *Gin,
+                               long *C, bool withSelf, bool truncateWeights, coarsenScratch *S) {
+  long *vtxPtr = Gin->edgeListPtrs;
+  hashLocalMap *H = &S->H;
+  mapElement *list = S->list;
+  long num = 0;
+  if (withSelf) {
+    long slot = findSlotHashLocalMap(H, c);
+    H->key[slot] = c;
+    H->position[slot] = 0;
+    H->touched[H->numTouched++] = slot;
+    list[0].cid = c;
+    list[0].Counter = 0;
+    num = 1;
+  }
+  for (long k=memberPtr[c]; k<memberPtr[c+1]; k++) {
+    long v = members[k];
+    for (long j=vtxPtr[v]; j<vtxPtr[v+1]; j++) {
+      long d = C[edgeTail(Gin, j)];
+      if (d < 0)
+        continue;
+      double w = edgeWeightAt<Weighted>(Gin, j);
+      if (truncateWeights)
+        w = (double)((long)w);
+      long slot = findSlotHashLocalMap(H, d);
+      if (H->key[slot] == d) { //Already exists
+        list[H->position[slot]].Counter += w;
+      } else {
+        H->key[slot] = d;
+        H->position[slot] = num;
+        H->touched[H->numTouched++] = slot;
+        list[num].cid = d;
+        list[num].Counter = w;
+        num++;
+      }
+    }
+  }
+  clearHashLocalMap(H);
+  return num;
+}//End of aggregateCommunity()
+
+//Make the edge arrays of G hold numEdges entries, where they hold size (in-place mode)
+//An unweighted compact G has no weight array: it gets one for the output
+static void reserveEdges(graph *G, long size, long numEdges) {
+  if (numEdges > size) {
+    G->edgeList = (edge *) realloc (G->edgeList, numEdges * sizeof(edge)); assert(G->edgeList != 0);
+  }
+}
+template<typename IdxT, typename WtT>
+static void reserveEdges(compactGraphT<IdxT, WtT> *G, long size, long numEdges) {
+  if (numEdges > size) {
+    G->tail = (IdxT *) realloc (G->tail, numEdges * sizeof(IdxT)); assert(G->tail != 0);
+  }
+  if ((G->weight == 0) || (numEdges > size)) {
+    long wSize = (numEdges > size) ? numEdges : size;
+    G->weight = (WtT *) realloc (G->weight, wSize * sizeof(WtT)); assert(G->weight != 0);
+  }
+}
+
+typedef struct
+{
+  long c0, c1;       //Communities of the chunk
+  mapElement *stage; //Their sorted lists, back to back
+  long capacity;     //Entries available in stage
+} coarsenChunk;
+
+//Copy the staged lists of a chunk to their final place in the edge arrays of G
+template<typename GraphT>
+static void writeChunk(GraphT *G, long *vtxPtrOut, coarsenChunk *chunk) {
+  long base = vtxPtrOut[chunk->c0];
+#pragma omp parallel for schedule(dynamic, 256)
+  for (long c=chunk->c0; c<chunk->c1; c++) {
+    for (long j=vtxPtrOut[c]; j<vtxPtrOut[c+1]; j++)
+      setEdge(G, j, c, chunk->stage[j-base].cid, chunk->stage[j-base].Counter);
+  }
+}//End of writeChunk()
+
+//In-place variant of step 3 of coarsenGraph(): Gout is written into the edge arrays of Gin.
+//The lists of c depend only on the edges of c's members, and the members of communities
+//c..NV_out-1 lie at or after readFrom[c] in the edge arrays. Communities are aggregated in
+//chunks of about chunkSize entries; once chunk [c0,c1) is staged, everything before
+//readFrom[c1] is retired, and the chunk is written there as soon as vtxPtrOut[c1] fits.
+//Chunks that do not fit yet wait (in order) for a later chunk to retire more of Gin.
+//Extra memory is one chunk plus the waiting ones, instead of a second copy of the graph.
+//On return Gin has no arrays (edgeListPtrs and its edge arrays are 0).
+template<bool Weighted, typename GraphT>
+static void fillInPlace(GraphT *Gin, GraphT *Gout, long *C, long NV_out, long *memberPtr, long *members,
+                        long *degreeSum, long *vtxPtrOut, bool withSelf, bool truncateWeights) {
+  long *vtxPtr = Gin->edgeListPtrs;
+  long numEdges = vtxPtrOut[NV_out];
+  int nT = omp_get_max_threads();
+  double time1 = omp_get_wtime();
+
+  //readFrom[c]: first edge of Gin still read by the communities c..NV_out-1
+  long *readFrom = (long *) phaseAlloc ((NV_out+1) * sizeof(long)); assert(readFrom != 0);
+  long minMember = Gin->numVertices;
+  readFrom[NV_out] = LONG_MAX;
+  for (long c=NV_out-1; c>=0; c--) {
+    if (members[memberPtr[c]] < minMember) //Members are sorted: the first one is the smallest
+      minMember = members[memberPtr[c]];
+    readFrom[c] = vtxPtr[minMember];
+  }
+  reserveEdges(Gin, vtxPtr[Gin->numVertices], numEdges); //Grown if the self-loops outnumber the merged edges
+
+  coarsenScratch *S = (coarsenScratch *) malloc (nT * sizeof(coarsenScratch)); assert(S != 0);
+  for (int t=0; t<nT; t++) {
+    S[t].capacity = 0;
+    growCoarsenScratch(&S[t], 1024);
+  }
+  long chunkSize = numEdges / 64;
+  if (chunkSize < 65536)
+    chunkSize = 65536;
+  coarsenChunk *waiting = (coarsenChunk *) malloc (sizeof(coarsenChunk)); assert(waiting != 0);
+  long numWaiting = 0, firstWaiting = 0, waitingCapacity = 1;
+  long held = 0, maxHeld = 0; //Entries staged but not written yet
+  coarsenChunk spare;         //Stage of the last chunk written, reused by the next one
+  spare.stage = 0;
+  spare.capacity = 0;
+
+  for (long c0=0; c0<NV_out; ) {
+    //Chunk [c0,c1): at least one community, at most chunkSize entries otherwise
+    long c1 = upper_bound(vtxPtrOut+c0+1, vtxPtrOut+NV_out+1, vtxPtrOut[c0]+chunkSize) - vtxPtrOut - 1;
+    if (c1 <= c0)
+      c1 = c0 + 1;
+    long entries = vtxPtrOut[c1] - vtxPtrOut[c0];
+    coarsenChunk chunk = spare;
+    spare.stage = 0;
+    spare.capacity = 0;
+    if (chunk.capacity < entries) {
+      free(chunk.stage);
+      chunk.capacity = (entries > chunkSize) ? entries : chunkSize;
+      chunk.stage = (mapElement *) malloc (chunk.capacity * sizeof(mapElement)); assert(chunk.stage != 0);
+    }
+    chunk.c0 = c0;
+    chunk.c1 = c1;
+#pragma omp parallel num_threads(nT)
+    {
+      coarsenScratch *myS = &S[omp_get_thread_num()];
+#pragma omp for schedule(dynamic, 64)
+      for (long c=c0; c<c1; c++) {
+        growCoarsenScratch(myS, degreeSum[c]);
+        long num = aggregateCommunity<Weighted>(c, memberPtr, members, Gin, C, withSelf, truncateWeights, myS);
+        assert(num == vtxPtrOut[c+1] - vtxPtrOut[c]);
+        sort(myS->list, myS->list+num, mapElementByCid);
+        mapElement *out = chunk.stage + (vtxPtrOut[c] - vtxPtrOut[c0]);
+        for (long k=0; k<num; k++)
+          out[k] = myS->list[k];
+      }
+    }//End of parallel region
+    if (numWaiting == waitingCapacity) {
+      waitingCapacity *= 2;
+      waiting = (coarsenChunk *) realloc (waiting, waitingCapacity * sizeof(coarsenChunk)); assert(waiting != 0);
+    }
+    waiting[numWaiting++] = chunk;
+    held += entries;
+    if (held > maxHeld)
+      maxHeld = held;
+    //Write, in order, every chunk whose place has been retired
+    while ((firstWaiting < numWaiting) && (vtxPtrOut[waiting[firstWaiting].c1] <= readFrom[c1])) {
+      writeChunk(Gin, vtxPtrOut, &waiting[firstWaiting]);
+      held -= vtxPtrOut[waiting[firstWaiting].c1] - vtxPtrOut[waiting[firstWaiting].c0];
+      if (waiting[firstWaiting].capacity > spare.capacity) {
+        free(spare.stage);
+        spare = waiting[firstWaiting];
+      } else {
+        free(waiting[firstWaiting].stage);
+      }
+      firstWaiting++;
+    }
+    c0 = c1;
+  }//End of for(c0)
+  assert(firstWaiting == numWaiting);
+  free(waiting);
+  free(spare.stage);
+  for (int t=0; t<nT; t++) {
+    freeHashLocalMap(&S[t].H);
+    free(S[t].list);
+  }
+  free(S);
+  phaseFree(readFrom);
+
+  //The edge arrays of Gin become Gout's, shrunk to size; its pointer array is no longer needed
+  moveEdges(Gin, Gout, numEdges);
+  free(Gin->edgeListPtrs);
+  Gin->edgeListPtrs = 0;
+#ifdef PRINT_DETAILED_STATS_
+  printf("Coarsening in place: %3.3lf s to fill, at most %ld of %ld entries held back\n",
+         omp_get_wtime() - time1, maxHeld, numEdges);
+#endif
+}//End of fillInPlace()
+
+//Build Gout, with one vertex per community of C (ids 0..numUniqueClusters-1; C[i] < 0 is skipped).
+//Adjacency lists are sorted by tail; self-loops appear once and other edges twice.
+//withSelf: every vertex gets a self-loop (else only communities with internal edges)
+//truncateWeights: edge weights are truncated to integers before they are summed
+//With selectInPlaceCoarsening(true) the arrays of Gin are consumed (see fillInPlace())
+//Returns the number of self-loops in Gout
+template<bool Weighted, typename GraphT>
+static long coarsenGraphT(GraphT *Gin, GraphT *Gout, long *C, long numUniqueClusters, bool withSelf, bool truncateWeights) {
+  long NV_in   = Gin->numVertices;
+  long *vtxPtr = Gin->edgeListPtrs;
+  long NV_out  = numUniqueClusters;
+  double time1 = omp_get_wtime();
+
+  //Step 1: members of each community, in increasing vertex order
+  long *memberPtr = (long *) phaseAlloc ((NV_out+1) * sizeof(long)); assert(memberPtr != 0);
+  long *members   = (long *) phaseAlloc (NV_in * sizeof(long)); assert(members != 0);
+  long *degreeSum = (long *) phaseAlloc (NV_out * sizeof(long)); assert(degreeSum != 0);
+  buildCSRByKey(C, NV_in, NV_out, memberPtr, members); //Sorted members: deterministic summation order
+#pragma omp parallel for schedule(dynamic, 256)
+  for (long c=0; c<NV_out; c++) {
+    long bound = 1;
+    for (long k=memberPtr[c]; k<memberPtr[c+1]; k++)
+      bound += vtxPtr[members[k]+1] - vtxPtr[members[k]];
+    degreeSum[c] = (bound < NV_out) ? bound : NV_out; //Entries are distinct communities
+  }
+  double time2 = omp_get_wtime();
+#ifdef PRINT_DETAILED_STATS_
+  printf("Coarsening: %3.3lf s to group members\n", time2-time1);
+#endif
+  //Step 2: count the neighbouring communities of each community
+  long *vtxPtrOut = (long *) malloc ((NV_out+1) * sizeof(long)); assert(vtxPtrOut != 0);
+  vtxPtrOut[0] = 0;
+  long numSelf = 0;
+#pragma omp parallel reduction(+:numSelf)
+  {
+    coarsenScratch S;
+    S.capacity = 0;
+    growCoarsenScratch(&S, 1024);
+#pragma omp for schedule(dynamic, 64)
+    for (long c=0; c<NV_out; c++) {
+      growCoarsenScratch(&S, degreeSum[c]);
+      long num = aggregateCommunity<Weighted>(c, memberPtr, members, Gin, C, withSelf, truncateWeights, &S);
+      vtxPtrOut[c+1] = num;
+      bool hasSelf = withSelf;
+      for (long k=0; (k<num) && !hasSelf; k++)
+        hasSelf = (S.list[k].cid == c);
+      if (hasSelf)
+        numSelf++;
+    }
+    freeHashLocalMap(&S.H);
+    free(S.list);
+  }//End of parallel region
+  long numEdges = parallelPrefixSum(vtxPtrOut, NV_out+1);
+  assert(((numEdges - numSelf) % 2) == 0);
+  double time3 = omp_get_wtime();
+
+  //Step 3: fill, each community writing only its own (sorted) adjacency list
+  if (inPlaceCoarsening) {
+    fillInPlace<Weighted>(Gin, Gout, C, NV_out, memberPtr, members, degreeSum, vtxPtrOut, withSelf, truncateWeights);
+  } else {
+    allocEdges(Gout, numEdges);
+#pragma omp parallel
+    {
+      coarsenScratch S;
+      S.capacity = 0;
+      growCoarsenScratch(&S, 1024);
+#pragma omp for schedule(dynamic, 64)
+      for (long c=0; c<NV_out; c++) {
+        growCoarsenScratch(&S, degreeSum[c]);
+        long num = aggregateCommunity<Weighted>(c, memberPtr, members, Gin, C, withSelf, truncateWeights, &S);
+        assert(num == vtxPtrOut[c+1] - vtxPtrOut[c]);
+        sort(S.list, S.list+num, mapElementByCid);
+        for (long k=0; k<num; k++)
+          setEdge(Gout, vtxPtrOut[c]+k, c, S.list[k].cid, S.list[k].Counter);
+      }
+      freeHashLocalMap(&S.H);
+      free(S.list);
+    }//End of parallel region
+  }//End of else
+  double time4 = omp_get_wtime();
+#ifdef PRINT_DETAILED_STATS_
+  printf("Coarsening: %3.3lf s to count, %3.3lf s to fill\n", time3-time2, time4-time3);
+#endif
+
+  Gout->numVertices  = NV_out;
+  Gout->sVertices    = NV_out;
+  //Note: Self-loops are represented ONCE, but others appear TWICE
+  Gout->numEdges     = numSelf + (numEdges - numSelf)/2;
+  Gout->edgeListPtrs = vtxPtrOut;
+
+  phaseFree(degreeSum);
+  phaseFree(members);
+  phaseFree(memberPtr);
+  return numSelf;
+}//End of coarsenGraphT()
+
+long coarsenGraph(graph *Gin, graph *Gout, long *C, long numUniqueClusters, bool withSelf, bool truncateWeights) {
+  return coarsenGraphT<true>(Gin, Gout, C, numUniqueClusters, withSelf, truncateWeights);
+}//End of coarsenGraph()
+
+//Gout always has a weight array: an unweighted Gin (Weighted = false) gets weights once edges are merged
+template<typename IdxT, typename WtT, bool Weighted>
+long coarsenGraph(compactGraphT<IdxT, WtT> *Gin, compactGraphT<IdxT, WtT> *Gout, long *C,
+                  long numUniqueClusters, bool withSelf) {
+  return coarsenGraphT<Weighted>(Gin, Gout, C, numUniqueClusters, withSelf, false);
+}//End of coarsenGraph()
+#define INSTANTIATE_COARSEN_COMPACT(IdxT, WtT, Weighted) \
+  template long coarsenGraph<IdxT, WtT, Weighted>(compactGraphT<IdxT, WtT> *Gin, compactGraphT<IdxT, WtT> *Gout, \
+                                                  long *C, long numUniqueClusters, bool withSelf);
+INSTANTIATE_COARSEN_COMPACT(long, double, true)
+INSTANTIATE_COARSEN_COMPACT(int, double, true)
+INSTANTIATE_COARSEN_COMPACT(int, float, true)
+INSTANTIATE_COARSEN_COMPACT(long, double, false)
+INSTANTIATE_COARSEN_COMPACT(int, double, false)
+INSTANTIATE_COARSEN_COMPACT(int, float, false)
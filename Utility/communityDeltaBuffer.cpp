@@ -0,0 +1,154 @@
+// **************************************************************************************************
+// Grappolo: A C++ library for parallel graph community detection
+// Hao Lu, Ananth Kalyanaraman (hao.lu@wsu.edu, ananth@eecs.wsu.edu) Washington State University
+// Mahantesh Halappanavar (hala@pnnl.gov) Pacific Northwest National Laboratory
+//
+// For citation, please cite the following paper:
+// Lu, Hao, Mahantesh Halappanavar, and Ananth Kalyanaraman. 
+// "Parallel heuristics for scalable community detection." Parallel Computing 47 (2015): 19-37.
+//
+// **************************************************************************************************
+// Copyright (c) 2016. Washington State University ("WSU"). All Rights Reserved.
+// Permission to use, copy, modify, and distribute this software and its documentation
+// for educational, research, and not-for-profit purposes, without fee, is hereby
+// granted, provided that the above copyright notice, this paragraph and the following
+// two paragraphs appear in all copies, modifications, and distributions. For
+// commercial licensing opportunities, please contact The Office of Commercialization,
+// WSU, 280/286 Lighty, PB Box 641060, Pullman, WA 99164, (509) 335-5526,
+// commercialization@wsu.edu<mailto:commercialization@wsu.edu>, https://commercialization.wsu.edu/
+
+// IN NO EVENT SHALL WSU BE LIABLE TO ANY PARTY FOR DIRECT, INDIRECT, SPECIAL, INCIDENTAL,
+// OR CONSEQUENTIAL DAMAGES, INCLUDING LOST PROFITS, ARISING OUT OF THE USE OF
+// THIS SOFTWARE AND ITS DOCUMENTATION, EVEN IF WSU HAS BEEN ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+// WSU SPECIFICALLY DISCLAIMS ANY WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. THE SOFTWARE AND
+// ACCOMPANYING DOCUMENTATION, IF ANY, PROVIDED HEREUNDER IS PROVIDED "AS IS". WSU HAS NO
+// OBLIGATION TO PROVIDE MAINTENANCE, SUPPORT, UPDATES, ENHANCEMENTS, OR MODIFICATIONS.
+// **************************************************************************************************
+
+#include "defs.h"
+#include "utilityClusteringFunctions.h"
+
+using namespace std;
+
+//Per-thread sparse buffers for the community updates of a sweep (in place of atomics on cUpdate)
+//Each thread aggregates its own moves; the buffers are then merged by owner thread,
+//so no two threads ever write to the same community.
+deltaBuffer* allocDeltaBuffers(int nT, long initialCapacity) {
+  if (initialCapacity < 16)
+    initialCapacity = 16;
+  deltaBuffer *D = (deltaBuffer *) malloc (nT * sizeof(deltaBuffer)); assert(D != 0);
+#pragma omp parallel num_threads(nT)
+  {
+    deltaBuffer *myD = &D[omp_get_thread_num()];
+    myD->capacity = initialCapacity;
+    myD->num      = 0;
+    initHashLocalMap(&myD->table, initialCapacity);
+    myD->cid           = (long *) malloc (initialCapacity * sizeof(long)); assert(myD->cid != 0);
+    myD->delta         = (Comm *) malloc (initialCapacity * sizeof(Comm)); assert(myD->delta != 0);
+    myD->bucketedCid   = (long *) malloc (initialCapacity * sizeof(long)); assert(myD->bucketedCid != 0);
+    myD->bucketedDelta = (Comm *) malloc (initialCapacity * sizeof(Comm)); assert(myD->bucketedDelta != 0);
+    myD->bucketStart   = (long *) malloc ((nT+1) * sizeof(long)); assert(myD->bucketStart != 0);
+  }
+  return D;
+}//End of allocDeltaBuffers()
+
+void freeDeltaBuffers(deltaBuffer *D, int nT) {
+  for (int t=0; t<nT; t++) {
+    freeHashLocalMap(&D[t].table);
+    free(D[t].cid);
+    free(D[t].delta);
+    free(D[t].bucketedCid);
+    free(D[t].bucketedDelta);
+    free(D[t].bucketStart);
+  }
+  free(D);
+}//End of freeDeltaBuffers()
+
+//Double the capacity and re-insert the entries recorded so far
+static void growDeltaBuffer(deltaBuffer *D) {
+  long newCapacity = 2 * D->capacity;
+  D->cid           = (long *) realloc (D->cid, newCapacity * sizeof(long)); assert(D->cid != 0);
+  D->delta         = (Comm *) realloc (D->delta, newCapacity * sizeof(Comm)); assert(D->delta != 0);
+  D->bucketedCid   = (long *) realloc (D->bucketedCid, newCapacity * sizeof(long)); assert(D->bucketedCid != 0);
+  D->bucketedDelta = (Comm *) realloc (D->bucketedDelta, newCapacity * sizeof(Comm)); assert(D->bucketedDelta != 0);
+  freeHashLocalMap(&D->table);
+  initHashLocalMap(&D->table, newCapacity);
+  for (long k=0; k<D->num; k++) {
+    long slot = findSlotHashLocalMap(&D->table, D->cid[k]);
+    D->table.key[slot]      = D->cid[k];
+    D->table.position[slot] = k;
+    D->table.touched[D->table.numTouched++] = slot;
+  }
+  D->capacity = newCapacity;
+}//End of growDeltaBuffer()
+
+//Record a change of (size, degree) for community cid
+void addDeltaBuffer(deltaBuffer *D, long cid, long size, double degree) {
+  long slot = findSlotHashLocalMap(&D->table, cid);
+  if (D->table.key[slot] == cid) {
+    D->delta[D->table.position[slot]].size   += size;
+    D->delta[D->table.position[slot]].degree += degree;
+    return;
+  }
+  if (D->num == D->capacity) {
+    growDeltaBuffer(D);
+    slot = findSlotHashLocalMap(&D->table, cid);
+  }
+  D->table.key[slot]      = cid;
+  D->table.position[slot] = D->num;
+  D->table.touched[D->table.numTouched++] = slot;
+  D->cid[D->num]          = cid;
+  D->delta[D->num].size   = size;
+  D->delta[D->num].degree = degree;
+  D->num++;
+}//End of addDeltaBuffer()
+
+//Add the buffered changes to cUpdate and empty the buffers.
+//Community c belongs to thread (c*nT)/NV; each owner adds the entries of all buffers
+//for its own range, in thread order, so the result does not depend on timing.
+//Returns the change of sum(degree^2) over the communities owned by this thread:
+//the change of a2_x when merging straight into cInfo.
+//WARNING: Must be called by every thread of the team (contains barriers)
+double mergeDeltaBuffers(deltaBuffer *D, Comm *cUpdate, long NV) {
+  int tid = omp_get_thread_num();
+  int nT  = omp_get_num_threads();
+  deltaBuffer *myD = &D[tid];
+
+  //Step 1: Group this thread's entries by owner
+  for (int t=0; t<=nT; t++)
+    myD->bucketStart[t] = 0;
+  for (long k=0; k<myD->num; k++)
+    myD->bucketStart[(myD->cid[k] * nT) / NV + 1]++;
+  for (int t=0; t<nT; t++)
+    myD->bucketStart[t+1] += myD->bucketStart[t];
+  for (long k=0; k<myD->num; k++) {
+    long where = myD->bucketStart[(myD->cid[k] * nT) / NV]++;
+    myD->bucketedCid[where]   = myD->cid[k];
+    myD->bucketedDelta[where] = myD->delta[k];
+  }
+  for (int t=nT; t>0; t--) //Restore the starting positions
+    myD->bucketStart[t] = myD->bucketStart[t-1];
+  myD->bucketStart[0] = 0;
+#pragma omp barrier
+
+  //Step 2: Apply the entries owned by this thread
+  double a2Change = 0;
+  for (int t=0; t<nT; t++) {
+    for (long k=D[t].bucketStart[tid]; k<D[t].bucketStart[tid+1]; k++) {
+      long c = D[t].bucketedCid[k];
+      double d = D[t].bucketedDelta[k].degree;
+      a2Change += d*(2*cUpdate[c].degree + d); //(a+d)^2 - a^2
+      cUpdate[c].size   += D[t].bucketedDelta[k].size;
+      cUpdate[c].degree += d;
+    }
+  }
+#pragma omp barrier
+
+  //Step 3: Empty this thread's buffer for the next sweep
+  clearHashLocalMap(&myD->table);
+  myD->num = 0;
+  return a2Change;
+}//End of mergeDeltaBuffers()
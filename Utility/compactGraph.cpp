@@ -0,0 +1,290 @@
+// **************************************************************************************************
+// Grappolo: A C++ library for parallel graph community detection
+// Hao Lu, Ananth Kalyanaraman (hao.lu@wsu.edu, ananth@eecs.wsu.edu) Washington State University
+// Mahantesh Halappanavar (hala@pnnl.gov) Pacific Northwest National Laboratory
+//
+// For citation, please cite the following paper:
+// Lu, Hao, Mahantesh Halappanavar, and Ananth Kalyanaraman. 
+// "Parallel heuristics for scalable community detection." Parallel Computing 47 (2015): 19-37.
+//
+// **************************************************************************************************
+// Copyright (c) 2016. Washington State University ("WSU"). All Rights Reserved.
+// Permission to use, copy, modify, and distribute this software and its documentation
+// for educational, research, and not-for-profit purposes, without fee, is hereby
+// granted, provided that the above copyright notice, this paragraph and the following
+// two paragraphs appear in all copies, modifications, and distributions. For
+// commercial licensing opportunities, please contact The Office of Commercialization,
+// WSU, 280/286 Lighty, PB Box 641060, Pullman, WA 99164, (509) 335-5526,
+// commercialization@wsu.edu<mailto:commercialization@wsu.edu>, https://commercialization.wsu.edu/
+
+// IN NO EVENT SHALL WSU BE LIABLE TO ANY PARTY FOR DIRECT, INDIRECT, SPECIAL, INCIDENTAL,
+// OR CONSEQUENTIAL DAMAGES, INCLUDING LOST PROFITS, ARISING OUT OF THE USE OF
+// THIS SOFTWARE AND ITS DOCUMENTATION, EVEN IF WSU HAS BEEN ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+// WSU SPECIFICALLY DISCLAIMS ANY WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. THE SOFTWARE AND
+// ACCOMPANYING DOCUMENTATION, IF ANY, PROVIDED HEREUNDER IS PROVIDED "AS IS". WSU HAS NO
+// OBLIGATION TO PROVIDE MAINTENANCE, SUPPORT, UPDATES, ENHANCEMENTS, OR MODIFICATIONS.
+// **************************************************************************************************
+
+#include "defs.h"
+#include "basic_util.h"
+#include "utilityClusteringFunctions.h"
+
+using namespace std;
+
+//Move the edges of G into a compact graph: tail[] and weight[] only (16 instead of 24 bytes per edge)
+//The tails are packed inside the old edge array, so the peak is 32 bytes per edge during the move.
+//If every weight is 1 (e.g., edge-list inputs), no weight array is kept at all (weight = NULL).
+//WARNING: G keeps only its sizes; its edgeList is released and edgeListPtrs is handed over to CG
+void graphToCompact(graph *G, compactGraph *CG) {
+  long NV = G->numVertices;
+  long NE = G->edgeListPtrs[NV];
+  edge *vtxInd = G->edgeList;
+
+  CG->numVertices  = NV;
+  CG->sVertices    = G->sVertices;
+  CG->numEdges     = G->numEdges;
+  CG->edgeListPtrs = G->edgeListPtrs;
+  long numNonUnit = 0;
+#pragma omp parallel for reduction(+:numNonUnit)
+  for (long j=0; j<NE; j++) {
+    if (vtxInd[j].weight != 1)
+      numNonUnit++;
+  }
+  CG->weight = 0;
+  if (numNonUnit > 0) {
+    CG->weight = (double *) malloc (NE * sizeof(double)); assert(CG->weight != 0);
+#pragma omp parallel for
+    for (long j=0; j<NE; j++) {
+      CG->weight[j] = vtxInd[j].weight;
+    }
+  }
+  //In-place: tail j goes to word j, which never overtakes an edge that is still to be read (word 3j+1)
+  long *tail = (long *) vtxInd;
+  for (long j=0; j<NE; j++) {
+    tail[j] = vtxInd[j].tail;
+  }
+  CG->tail = (long *) realloc (tail, NE * sizeof(long)); assert(CG->tail != 0);
+
+  G->edgeList     = 0;
+  G->edgeListPtrs = 0;
+}//End of graphToCompact()
+
+//Legacy view of a compact graph (for routines that need the edge structure)
+//CG is not modified; G gets its own copy of the data
+void compactToGraph(compactGraph *CG, graph *G) {
+  long NV = CG->numVertices;
+  long NE = CG->edgeListPtrs[NV];
+  G->numVertices  = NV;
+  G->sVertices    = CG->sVertices;
+  G->numEdges     = CG->numEdges;
+  G->edgeListPtrs = (long *) malloc ((NV+1) * sizeof(long)); assert(G->edgeListPtrs != 0);
+  G->edgeList     = (edge *) malloc (NE * sizeof(edge)); assert(G->edgeList != 0);
+#pragma omp parallel for
+  for (long i=0; i<=NV; i++) {
+    G->edgeListPtrs[i] = CG->edgeListPtrs[i];
+  }
+#pragma omp parallel for
+  for (long i=0; i<NV; i++) {
+    for (long j=CG->edgeListPtrs[i]; j<CG->edgeListPtrs[i+1]; j++) {
+      G->edgeList[j].head   = i;
+      G->edgeList[j].tail   = CG->tail[j];
+      G->edgeList[j].weight = (CG->weight != 0) ? CG->weight[j] : 1;
+    }
+  }
+}//End of compactToGraph()
+
+//Narrow the index and weight types of a compact graph, in place (each array only shrinks)
+//WARNING: CG is consumed; its arrays now belong to TG
+template<typename IdxT, typename WtT>
+void narrowCompactGraph(compactGraph *CG, compactGraphT<IdxT, WtT> *TG) {
+  long NE = CG->edgeListPtrs[CG->numVertices];
+  TG->numVertices  = CG->numVertices;
+  TG->sVertices    = CG->sVertices;
+  TG->numEdges     = CG->numEdges;
+  TG->edgeListPtrs = CG->edgeListPtrs;
+  //Element j moves to a position at or below its old one: a forward copy is safe
+  IdxT *tail = (IdxT *) CG->tail;
+  for (long j=0; j<NE; j++) {
+    tail[j] = (IdxT) CG->tail[j];
+  }
+  TG->tail   = (IdxT *) realloc (tail, NE * sizeof(IdxT)); assert(TG->tail != 0);
+  TG->weight = 0; //Unweighted graph
+  if (CG->weight != 0) {
+    WtT *weight = (WtT *) CG->weight;
+    for (long j=0; j<NE; j++) {
+      weight[j] = (WtT) CG->weight[j];
+    }
+    TG->weight = (WtT *) realloc (weight, NE * sizeof(WtT)); assert(TG->weight != 0);
+  }
+  CG->edgeListPtrs = 0;
+  CG->tail   = 0;
+  CG->weight = 0;
+}//End of narrowCompactGraph()
+
+template<typename IdxT, typename WtT>
+void freeCompactGraph(compactGraphT<IdxT, WtT> *CG) {
+  free(CG->edgeListPtrs);
+  free(CG->tail);
+  free(CG->weight);
+}//End of freeCompactGraph()
+
+//Same as sumVertexDegree(), on the weight array of a compact graph
+template<typename IdxT, typename WtT, bool Weighted>
+void sumVertexDegreeCompact(WtT* vtxWeight, long* vtxPtr, double* vDegree, long NV, CommT<IdxT, WtT>* cInfo) {
+#pragma omp parallel for
+  for (long i=0; i<NV; i++) {
+    long adj1 = vtxPtr[i];
+    long adj2 = vtxPtr[i+1];
+    double totalWt = adj2 - adj1; //Unweighted: the degree is the number of edges
+    if (Weighted) {
+      totalWt = 0; //Accumulate in double whatever the weight type
+      for(long j=adj1; j<adj2; j++) {
+        totalWt += vtxWeight[j];
+      }
+    }
+    vDegree[i] = totalWt; //Degree of each node
+    cInfo[i].degree = totalWt; //Initialize the community
+    cInfo[i].size = 1;
+  }
+}//End of sumVertexDegreeCompact()
+
+//Same as initCommAssOpt(), on a compact graph
+//WARNING: Will ignore duplicate edge entries (multi-graph)
+template<typename IdxT, typename WtT, bool Weighted>
+void initCommAssOptCompact(IdxT* pastCommAss, IdxT* currCommAss, long NV,
+                           localMapScratch* scratch, long* vtxPtr, IdxT* vtxTail, WtT* vtxWeight,
+                           CommT<IdxT, WtT>* cInfo, double constant, double* vDegree ) {
+#pragma omp parallel for
+  for (long v=0; v<NV; v++) {
+    long adj1  = vtxPtr[v];
+    long adj2  = vtxPtr[v+1];
+    localMapScratch *S = &scratch[omp_get_thread_num()];
+    mapElement *clusterLocalMap = acquireLocalMap(S, adj2-adj1); //Local map for v
+
+    pastCommAss[v] = v; //Initialize each vertex to its own cluster
+    long numUniqueClusters = 0;
+    double selfLoop = 0;
+    clusterLocalMap[0].cid     = v; //Add itself
+    clusterLocalMap[0].Counter = 0; //Initialize the count
+    numUniqueClusters++;
+    //Parse through the neighbors: each one is in a separate cluster
+    for(long j=adj1; j<adj2; j++) {
+      if(vtxTail[j] == v) {	// SelfLoop need to be recorded
+        selfLoop += (long)edgeWeight<Weighted>(vtxWeight, j);
+        clusterLocalMap[0].Counter = edgeWeight<Weighted>(vtxWeight, j); //Initialize the count
+        continue;
+      }
+      clusterLocalMap[numUniqueClusters].cid     = vtxTail[j];
+      clusterLocalMap[numUniqueClusters].Counter = edgeWeight<Weighted>(vtxWeight, j);
+      numUniqueClusters++;
+    }//End of for(j)
+
+    currCommAss[v] = maxLocalMap(clusterLocalMap, selfLoop, cInfo, vDegree[v], v, constant, numUniqueClusters);
+    releaseLocalMap(S);
+  }
+
+  //Same as updateAxForOpt()
+#pragma omp parallel for
+  for(long i = 0; i < NV; i++) {
+    if(currCommAss[i] != i) {
+      #pragma omp atomic update
+      cInfo[i].degree -= vDegree[i];
+      #pragma omp atomic update
+      cInfo[i].size -= 1;
+      #pragma omp atomic update
+      cInfo[currCommAss[i]].degree += vDegree[i];
+      #pragma omp atomic update
+      cInfo[currCommAss[i]].size += 1;
+    }
+  }
+}//End of initCommAssOptCompact()
+
+//Same as buildLocalMapCounterScratch(), on a compact graph
+//The counters stay in double (mapElement) whatever the weight type
+template<typename IdxT, typename WtT, bool Weighted>
+double buildLocalMapCounterCompact(long v, mapElement* localMap, long* vtxPtr, IdxT* vtxTail, WtT* vtxWeight,
+                                   IdxT* currCommAss, long &numUniqueClusters, localMapScratch *S) {
+  long adj1 = vtxPtr[v];
+  long adj2 = vtxPtr[v+1];
+  double selfLoop = 0;
+
+  if (S->spa.slot != 0) { //Dense SPA
+    long stamp = ++(S->spa.stampValue);
+    spaElement *slot = S->spa.slot;
+    for(long k=0; k<numUniqueClusters; k++) { //Register the existing entries
+      slot[localMap[k].cid].stamp    = stamp;
+      slot[localMap[k].cid].position = k;
+    }
+    for(long j=adj1; j<adj2; j++) {
+      IdxT tail = vtxTail[j]; //Read once: the stores below may alias the edge arrays
+      double weight = edgeWeight<Weighted>(vtxWeight, j);
+      if(tail == v) {	// SelfLoop need to be recorded
+        selfLoop += weight;
+      }
+      long cid = currCommAss[tail];
+      if( slot[cid].stamp == stamp ) {	//Already exists
+        localMap[slot[cid].position].Counter += weight;
+      } else {	//Does not exist, add to the map
+        slot[cid].stamp    = stamp;
+        slot[cid].position = numUniqueClusters;
+        localMap[numUniqueClusters].cid     = cid;
+        localMap[numUniqueClusters].Counter = weight;
+        numUniqueClusters++;
+      }
+    }//End of for(j)
+    return selfLoop;
+  }
+
+  hashLocalMap *H = (S->overflow != 0) ? &S->overflowHash : &S->hash; //Bounded memory
+  for(long k=0; k<numUniqueClusters; k++) { //Register the existing entries
+    long slot = findSlotHashLocalMap(H, localMap[k].cid);
+    H->key[slot] = localMap[k].cid;
+    H->position[slot] = k;
+    H->touched[H->numTouched++] = slot;
+  }
+  for(long j=adj1; j<adj2; j++) {
+    IdxT tail = vtxTail[j];
+    double weight = edgeWeight<Weighted>(vtxWeight, j);
+    if(tail == v) {	// SelfLoop need to be recorded
+      selfLoop += weight;
+    }
+    long cid  = currCommAss[tail];
+    long slot = findSlotHashLocalMap(H, cid);
+    if( H->key[slot] == cid ) {	//Already exists
+      localMap[H->position[slot]].Counter += weight;
+    } else {	//Does not exist, add to the map
+      H->key[slot] = cid;
+      H->position[slot] = numUniqueClusters;
+      H->touched[H->numTouched++] = slot;
+      localMap[numUniqueClusters].cid     = cid;
+      localMap[numUniqueClusters].Counter = weight;
+      numUniqueClusters++;
+    }
+  }//End of for(j)
+  clearHashLocalMap(H); //Leave the table empty for the next vertex
+  return selfLoop;
+}//End of buildLocalMapCounterCompact()
+
+//Instantiations for the types picked by runMultiPhaseCompact()
+#define INSTANTIATE_COMPACT_KERNELS(IdxT, WtT, Weighted) \
+  template void sumVertexDegreeCompact<IdxT, WtT, Weighted>(WtT* vtxWeight, long* vtxPtr, double* vDegree, long NV, \
+                                                            CommT<IdxT, WtT>* cInfo); \
+  template void initCommAssOptCompact<IdxT, WtT, Weighted>(IdxT* pastCommAss, IdxT* currCommAss, long NV, \
+                                                           localMapScratch* scratch, long* vtxPtr, IdxT* vtxTail, \
+                                                           WtT* vtxWeight, CommT<IdxT, WtT>* cInfo, double constant, \
+                                                           double* vDegree); \
+  template double buildLocalMapCounterCompact<IdxT, WtT, Weighted>(long v, mapElement* localMap, long* vtxPtr, \
+                                                                   IdxT* vtxTail, WtT* vtxWeight, IdxT* currCommAss, \
+                                                                   long &numUniqueClusters, localMapScratch *S);
+#define INSTANTIATE_COMPACT_GRAPH(IdxT, WtT) \
+  template void freeCompactGraph<IdxT, WtT>(compactGraphT<IdxT, WtT> *CG); \
+  INSTANTIATE_COMPACT_KERNELS(IdxT, WtT, true) \
+  INSTANTIATE_COMPACT_KERNELS(IdxT, WtT, false)
+INSTANTIATE_COMPACT_GRAPH(long, double)
+INSTANTIATE_COMPACT_GRAPH(int, double)
+INSTANTIATE_COMPACT_GRAPH(int, float)
+template void narrowCompactGraph<int, double>(compactGraph *CG, compactGraphT<int, double> *TG);
+template void narrowCompactGraph<int, float>(compactGraph *CG, compactGraphT<int, float> *TG);
@@ -0,0 +1,59 @@
+// **************************************************************************************************
+// Grappolo: A C++ library for parallel graph community detection
+// Hao Lu, Ananth Kalyanaraman (hao.lu@wsu.edu, ananth@eecs.wsu.edu) Washington State University
+// Mahantesh Halappanavar (hala@pnnl.gov) Pacific Northwest National Laboratory
+//
+// For citation, please cite the following paper:
+// Lu, Hao, Mahantesh Halappanavar, and Ananth Kalyanaraman. 
+// "Parallel heuristics for scalable community detection." Parallel Computing 47 (2015): 19-37.
+//
+// **************************************************************************************************
+// Copyright (c) 2016. Washington State University ("WSU"). All Rights Reserved.
+// Permission to use, copy, modify, and distribute this software and its documentation
+// for educational, research, and not-for-profit purposes, without fee, is hereby
+// granted, provided that the above copyright notice, this paragraph and the following
+// two paragraphs appear in all copies, modifications, and distributions. For
+// commercial licensing opportunities, please contact The Office of Commercialization,
+// WSU, 280/286 Lighty, PB Box 641060, Pullman, WA 99164, (509) 335-5526,
+// commercialization@wsu.edu<mailto:commercialization@wsu.edu>, https://commercialization.wsu.edu/
+
+// IN NO EVENT SHALL WSU BE LIABLE TO ANY PARTY FOR DIRECT, INDIRECT, SPECIAL, INCIDENTAL,
+// OR CONSEQUENTIAL DAMAGES, INCLUDING LOST PROFITS, ARISING OUT OF THE USE OF
+// THIS SOFTWARE AND ITS DOCUMENTATION, EVEN IF WSU HAS BEEN ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+// WSU SPECIFICALLY DISCLAIMS ANY WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. THE SOFTWARE AND
+// ACCOMPANYING DOCUMENTATION, IF ANY, PROVIDED HEREUNDER IS PROVIDED "AS IS". WSU HAS NO
+// OBLIGATION TO PROVIDE MAINTENANCE, SUPPORT, UPDATES, ENHANCEMENTS, OR MODIFICATIONS.
+// **************************************************************************************************
+
+#include "defs.h"
+#include "basic_util.h"
+
+using namespace std;
+
+//Static partition of the vertices 0..NV-1 into nT contiguous ranges of about the
+//same work, measured as edges + vertices (the +1 accounts for the per-vertex work
+//that does not depend on the degree). Thread t owns part[t] <= i < part[t+1].
+//Each boundary is a binary search over vtxPtr: O(nT log NV), so it is cheap
+//enough to recompute whenever the graph changes (once per phase).
+long* buildEdgePartition(long *vtxPtr, long NV, int nT) {
+  long *part = (long *) malloc ((nT+1) * sizeof(long)); assert(part != 0);
+  long totalWeight = (vtxPtr[NV] - vtxPtr[0]) + NV;
+  part[0]  = 0;
+  part[nT] = NV;
+  for (int t=1; t<nT; t++) {
+    long target = (long)(((double)totalWeight * t) / nT);
+    long low = part[t-1], high = NV;
+    while (low < high) { //First vertex whose prefix weight reaches the target
+      long mid = low + (high - low) / 2;
+      if ((vtxPtr[mid] - vtxPtr[0]) + mid < target)
+        low = mid + 1;
+      else
+        high = mid;
+    }
+    part[t] = low;
+  }
+  return part;
+}//End of buildEdgePartition()
@@ -0,0 +1,92 @@
+// **************************************************************************************************
+// Grappolo: A C++ library for parallel graph community detection
+// Hao Lu, Ananth Kalyanaraman (hao.lu@wsu.edu, ananth@eecs.wsu.edu) Washington State University
+// Mahantesh Halappanavar (hala@pnnl.gov) Pacific Northwest National Laboratory
+//
+// For citation, please cite the following paper:
+// Lu, Hao, Mahantesh Halappanavar, and Ananth Kalyanaraman. 
+// "Parallel heuristics for scalable community detection." Parallel Computing 47 (2015): 19-37.
+//
+// **************************************************************************************************
+// Copyright (c) 2016. Washington State University ("WSU"). All Rights Reserved.
+// Permission to use, copy, modify, and distribute this software and its documentation
+// for educational, research, and not-for-profit purposes, without fee, is hereby
+// granted, provided that the above copyright notice, this paragraph and the following
+// two paragraphs appear in all copies, modifications, and distributions. For
+// commercial licensing opportunities, please contact The Office of Commercialization,
+// WSU, 280/286 Lighty, PB Box 641060, Pullman, WA 99164, (509) 335-5526,
+// commercialization@wsu.edu<mailto:commercialization@wsu.edu>, https://commercialization.wsu.edu/
+
+// IN NO EVENT SHALL WSU BE LIABLE TO ANY PARTY FOR DIRECT, INDIRECT, SPECIAL, INCIDENTAL,
+// OR CONSEQUENTIAL DAMAGES, INCLUDING LOST PROFITS, ARISING OUT OF THE USE OF
+// THIS SOFTWARE AND ITS DOCUMENTATION, EVEN IF WSU HAS BEEN ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+// WSU SPECIFICALLY DISCLAIMS ANY WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. THE SOFTWARE AND
+// ACCOMPANYING DOCUMENTATION, IF ANY, PROVIDED HEREUNDER IS PROVIDED "AS IS". WSU HAS NO
+// OBLIGATION TO PROVIDE MAINTENANCE, SUPPORT, UPDATES, ENHANCEMENTS, OR MODIFICATIONS.
+// **************************************************************************************************
+
+#include "defs.h"
+#include "utilityClusteringFunctions.h"
+
+using namespace std;
+
+//Active set of the frontier sweep: vertices are marked concurrently in a bitmap,
+//then compacted into a sorted worklist (the bitmap is cleared on the way).
+frontierSet* allocFrontierSet(long NV, int nT) {
+  frontierSet *F = (frontierSet *) malloc (sizeof(frontierSet)); assert(F != 0);
+  F->numWords    = (NV + 63) / 64;
+  F->bits        = (unsigned long *) malloc (F->numWords * sizeof(unsigned long)); assert(F->bits != 0);
+  F->list        = (long *) malloc (NV * sizeof(long)); assert(F->list != 0);
+  F->threadCount = (long *) malloc ((nT+1) * sizeof(long)); assert(F->threadCount != 0);
+  F->num         = 0;
+#pragma omp parallel for
+  for (long w=0; w<F->numWords; w++) {
+    F->bits[w] = 0;
+  }
+  return F;
+}//End of allocFrontierSet()
+
+void freeFrontierSet(frontierSet *F) {
+  free(F->bits);
+  free(F->list);
+  free(F->threadCount);
+  free(F);
+}//End of freeFrontierSet()
+
+//Write the marked vertices to list (in increasing order) and clear the bitmap.
+//Each thread takes a contiguous range of words: count, prefix sum over threads, then write.
+//Returns the number of marked vertices.
+long compactFrontier(frontierSet *F, int nT) {
+#pragma omp parallel num_threads(nT)
+  {
+    int tid  = omp_get_thread_num();
+    int nTh  = omp_get_num_threads();
+    long w1  = (F->numWords * tid) / nTh;
+    long w2  = (F->numWords * (tid+1)) / nTh;
+    long cnt = 0;
+    for (long w=w1; w<w2; w++)
+      cnt += __builtin_popcountl(F->bits[w]);
+    F->threadCount[tid+1] = cnt;
+#pragma omp barrier
+#pragma omp single
+    {
+      F->threadCount[0] = 0;
+      for (int t=0; t<nTh; t++)
+        F->threadCount[t+1] += F->threadCount[t];
+      F->num = F->threadCount[nTh];
+    }
+    long where = F->threadCount[tid];
+    for (long w=w1; w<w2; w++) {
+      unsigned long word = F->bits[w];
+      while (word != 0) {
+        F->list[where++] = (w << 6) + __builtin_ctzl(word);
+        word &= word - 1; //Clear the lowest set bit
+      }
+      F->bits[w] = 0;
+    }
+  }
+  return F->num;
+}//End of compactFrontier()
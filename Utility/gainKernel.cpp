@@ -0,0 +1,200 @@
+// **************************************************************************************************
+// Grappolo: A C++ library for parallel graph community detection
+// Hao Lu, Ananth Kalyanaraman (hao.lu@wsu.edu, ananth@eecs.wsu.edu) Washington State University
+// Mahantesh Halappanavar (hala@pnnl.gov) Pacific Northwest National Laboratory
+//
+// For citation, please cite the following paper:
+// Lu, Hao, Mahantesh Halappanavar, and Ananth Kalyanaraman. 
+// "Parallel heuristics for scalable community detection." Parallel Computing 47 (2015): 19-37.
+//
+// **************************************************************************************************
+// Copyright (c) 2016. Washington State University ("WSU"). All Rights Reserved.
+// Permission to use, copy, modify, and distribute this software and its documentation
+// for educational, research, and not-for-profit purposes, without fee, is hereby
+// granted, provided that the above copyright notice, this paragraph and the following
+// two paragraphs appear in all copies, modifications, and distributions. For
+// commercial licensing opportunities, please contact The Office of Commercialization,
+// WSU, 280/286 Lighty, PB Box 641060, Pullman, WA 99164, (509) 335-5526,
+// commercialization@wsu.edu<mailto:commercialization@wsu.edu>, https://commercialization.wsu.edu/
+
+// IN NO EVENT SHALL WSU BE LIABLE TO ANY PARTY FOR DIRECT, INDIRECT, SPECIAL, INCIDENTAL,
+// OR CONSEQUENTIAL DAMAGES, INCLUDING LOST PROFITS, ARISING OUT OF THE USE OF
+// THIS SOFTWARE AND ITS DOCUMENTATION, EVEN IF WSU HAS BEEN ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+// WSU SPECIFICALLY DISCLAIMS ANY WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. THE SOFTWARE AND
+// ACCOMPANYING DOCUMENTATION, IF ANY, PROVIDED HEREUNDER IS PROVIDED "AS IS". WSU HAS NO
+// OBLIGATION TO PROVIDE MAINTENANCE, SUPPORT, UPDATES, ENHANCEMENTS, OR MODIFICATIONS.
+// **************************************************************************************************
+
+#include "defs.h"
+#include "utilityClusteringFunctions.h"
+#include <limits.h>
+#include <immintrin.h>
+
+using namespace std;
+
+//Argmax of the modularity gain over a local map, with the rules of max():
+//only positive gains count, ties go to the smaller community ID, sc is skipped.
+//The local map is an array of (cid, Counter) pairs; the vector kernels split it into
+//a cid vector and a Counter vector with unpacklo/unpackhi and gather cInfo[cid].degree.
+//Lanes end up permuted, which does not matter for an argmax with a total tie-break.
+//All kernels evaluate the gain with the same operations in the same order, so they pick
+//the same community; the Makefile builds this file without FMA contraction or reassociation
+//to keep it that way. Swap protection is left to the caller (maxLocalMap()).
+
+typedef long (*gainKernelFunc)(mapElement* localMap, long numUniqueClusters, Comm* cInfo,
+                               double eix, double ax, double twoDegree, double constant, long sc);
+
+static inline void foldGain(double curGain, long cid, double &maxGain, long &maxIndex) {
+  if( (curGain > maxGain) ||
+     ((curGain==maxGain) && (curGain != 0) && (cid < maxIndex)) ) {
+    maxGain  = curGain;
+    maxIndex = cid;
+  }
+}//End of foldGain()
+
+static inline void foldCandidate(mapElement *candidate, Comm* cInfo, double eix, double ax,
+                                 double twoDegree, double constant, long sc,
+                                 double &maxGain, long &maxIndex) {
+  if (candidate->cid == sc)
+    return;
+  double curGain = 2*(candidate->Counter - eix) - twoDegree*(cInfo[candidate->cid].degree - ax)*constant;
+  foldGain(curGain, candidate->cid, maxGain, maxIndex);
+}//End of foldCandidate()
+
+static long maxGainScalar(mapElement* localMap, long numUniqueClusters, Comm* cInfo,
+                          double eix, double ax, double twoDegree, double constant, long sc) {
+  double maxGain = 0;
+  long maxIndex  = sc;
+  for (long k=0; k<numUniqueClusters; k++)
+    foldCandidate(&localMap[k], cInfo, eix, ax, twoDegree, constant, sc, maxGain, maxIndex);
+  return maxIndex;
+}//End of maxGainScalar()
+
+__attribute__((target("avx2")))
+static long maxGainAVX2(mapElement* localMap, long numUniqueClusters, Comm* cInfo,
+                        double eix, double ax, double twoDegree, double constant, long sc) {
+  const double *degreeBase = &cInfo[0].degree; //cInfo[c].degree is at degreeBase[2*c]
+  __m256d eixV   = _mm256_set1_pd(eix);
+  __m256d axV    = _mm256_set1_pd(ax);
+  __m256d twoV   = _mm256_set1_pd(2.0);
+  __m256d twoDV  = _mm256_set1_pd(twoDegree);
+  __m256d constV = _mm256_set1_pd(constant);
+  __m256d zeroV  = _mm256_setzero_pd();
+  __m256i scV    = _mm256_set1_epi64x(sc);
+  __m256d bestGain = _mm256_setzero_pd();
+  __m256i bestCid  = _mm256_set1_epi64x(LONG_MAX);
+
+  long k = 0;
+  for (; k+4<=numUniqueClusters; k+=4) {
+    __m256d lo = _mm256_loadu_pd((const double*)&localMap[k]);   //cid0 cnt0 cid1 cnt1
+    __m256d hi = _mm256_loadu_pd((const double*)&localMap[k+2]); //cid2 cnt2 cid3 cnt3
+    __m256i cid = _mm256_castpd_si256(_mm256_unpacklo_pd(lo, hi));
+    __m256d eiy = _mm256_unpackhi_pd(lo, hi);
+    __m256d ay  = _mm256_i64gather_pd(degreeBase, _mm256_slli_epi64(cid, 1), 8);
+    __m256d gain = _mm256_sub_pd(_mm256_mul_pd(twoV, _mm256_sub_pd(eiy, eixV)),
+                                 _mm256_mul_pd(_mm256_mul_pd(twoDV, _mm256_sub_pd(ay, axV)), constV));
+    __m256d greater = _mm256_cmp_pd(gain, bestGain, _CMP_GT_OQ);
+    __m256d tie     = _mm256_and_pd(_mm256_cmp_pd(gain, bestGain, _CMP_EQ_OQ),
+                                    _mm256_cmp_pd(gain, zeroV, _CMP_NEQ_UQ));
+    __m256d smaller = _mm256_castsi256_pd(_mm256_cmpgt_epi64(bestCid, cid));
+    __m256d self    = _mm256_castsi256_pd(_mm256_cmpeq_epi64(cid, scV));
+    __m256d take    = _mm256_andnot_pd(self, _mm256_or_pd(greater, _mm256_and_pd(tie, smaller)));
+    bestGain = _mm256_blendv_pd(bestGain, gain, take);
+    bestCid  = _mm256_castpd_si256(_mm256_blendv_pd(_mm256_castsi256_pd(bestCid),
+                                                    _mm256_castsi256_pd(cid), take));
+  }//End of for(k)
+
+  double laneGain[4];
+  long   laneCid[4];
+  _mm256_storeu_pd(laneGain, bestGain);
+  _mm256_storeu_si256((__m256i*)laneCid, bestCid);
+  double maxGain = 0;
+  long maxIndex  = sc;
+  for (int l=0; l<4; l++)
+    foldGain(laneGain[l], laneCid[l], maxGain, maxIndex);
+  for (; k<numUniqueClusters; k++) //Remainder
+    foldCandidate(&localMap[k], cInfo, eix, ax, twoDegree, constant, sc, maxGain, maxIndex);
+  return maxIndex;
+}//End of maxGainAVX2()
+
+__attribute__((target("avx512f")))
+static long maxGainAVX512(mapElement* localMap, long numUniqueClusters, Comm* cInfo,
+                          double eix, double ax, double twoDegree, double constant, long sc) {
+  const double *degreeBase = &cInfo[0].degree; //cInfo[c].degree is at degreeBase[2*c]
+  __m512d eixV   = _mm512_set1_pd(eix);
+  __m512d axV    = _mm512_set1_pd(ax);
+  __m512d twoV   = _mm512_set1_pd(2.0);
+  __m512d twoDV  = _mm512_set1_pd(twoDegree);
+  __m512d constV = _mm512_set1_pd(constant);
+  __m512d zeroV  = _mm512_setzero_pd();
+  __m512i scV    = _mm512_set1_epi64(sc);
+  __m512d bestGain = _mm512_setzero_pd();
+  __m512i bestCid  = _mm512_set1_epi64(LONG_MAX);
+
+  long k = 0;
+  for (; k+8<=numUniqueClusters; k+=8) {
+    __m512d lo = _mm512_loadu_pd((const double*)&localMap[k]);   //Pairs 0-3
+    __m512d hi = _mm512_loadu_pd((const double*)&localMap[k+4]); //Pairs 4-7
+    __m512i cid = _mm512_castpd_si512(_mm512_unpacklo_pd(lo, hi));
+    __m512d eiy = _mm512_unpackhi_pd(lo, hi);
+    __m512d ay  = _mm512_i64gather_pd(_mm512_slli_epi64(cid, 1), degreeBase, 8);
+    __m512d gain = _mm512_sub_pd(_mm512_mul_pd(twoV, _mm512_sub_pd(eiy, eixV)),
+                                 _mm512_mul_pd(_mm512_mul_pd(twoDV, _mm512_sub_pd(ay, axV)), constV));
+    __mmask8 greater = _mm512_cmp_pd_mask(gain, bestGain, _CMP_GT_OQ);
+    __mmask8 tie     = _mm512_cmp_pd_mask(gain, bestGain, _CMP_EQ_OQ) & _mm512_cmp_pd_mask(gain, zeroV, _CMP_NEQ_UQ);
+    __mmask8 smaller = _mm512_cmplt_epi64_mask(cid, bestCid);
+    __mmask8 other   = _mm512_cmpneq_epi64_mask(cid, scV);
+    __mmask8 take    = other & (greater | (tie & smaller));
+    bestGain = _mm512_mask_blend_pd(take, bestGain, gain);
+    bestCid  = _mm512_mask_blend_epi64(take, bestCid, cid);
+  }//End of for(k)
+
+  double laneGain[8];
+  long   laneCid[8];
+  _mm512_storeu_pd(laneGain, bestGain);
+  _mm512_storeu_si512(laneCid, bestCid);
+  double maxGain = 0;
+  long maxIndex  = sc;
+  for (int l=0; l<8; l++)
+    foldGain(laneGain[l], laneCid[l], maxGain, maxIndex);
+  for (; k<numUniqueClusters; k++) //Remainder
+    foldCandidate(&localMap[k], cInfo, eix, ax, twoDegree, constant, sc, maxGain, maxIndex);
+  return maxIndex;
+}//End of maxGainAVX512()
+
+static gainKernelFunc gainKernel = 0;
+
+//Pick the kernel: (0) best supported by the CPU (1) scalar (2) AVX2 (3) AVX-512
+//A kernel the CPU does not support falls back to the next one down.
+void selectGainKernel(int kernel) {
+  __builtin_cpu_init();
+  bool hasAVX512 = __builtin_cpu_supports("avx512f");
+  bool hasAVX2   = __builtin_cpu_supports("avx2");
+  if (kernel == 0)
+    kernel = 3;
+  if ((kernel >= 3) && hasAVX512) {
+    gainKernel = maxGainAVX512;
+    printf("Gain kernel: AVX-512\n");
+  } else if ((kernel >= 2) && hasAVX2) {
+    gainKernel = maxGainAVX2;
+    printf("Gain kernel: AVX2\n");
+  } else {
+    gainKernel = maxGainScalar;
+    printf("Gain kernel: scalar\n");
+  }
+}//End of selectGainKernel()
+
+long maxGainLocalMap(mapElement* localMap, long numUniqueClusters, Comm* cInfo,
+                     double eix, double ax, double degree, double constant, long sc) {
+  if (gainKernel == 0) { //Not selected explicitly: use the best available
+#pragma omp critical (selectGainKernel)
+    {
+      if (gainKernel == 0)
+        selectGainKernel(0);
+    }
+  }
+  return gainKernel(localMap, numUniqueClusters, cInfo, eix, ax, 2*degree, constant, sc);
+}//End of maxGainLocalMap()
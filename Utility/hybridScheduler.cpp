@@ -0,0 +1,298 @@
+// **************************************************************************************************
+// Grappolo: A C++ library for parallel graph community detection
+// Hao Lu, Ananth Kalyanaraman (hao.lu@wsu.edu, ananth@eecs.wsu.edu) Washington State University
+// Mahantesh Halappanavar (hala@pnnl.gov) Pacific Northwest National Laboratory
+//
+// For citation, please cite the following paper:
+// Lu, Hao, Mahantesh Halappanavar, and Ananth Kalyanaraman. 
+// "Parallel heuristics for scalable community detection." Parallel Computing 47 (2015): 19-37.
+//
+// **************************************************************************************************
+// Copyright (c) 2016. Washington State University ("WSU"). All Rights Reserved.
+// Permission to use, copy, modify, and distribute this software and its documentation
+// for educational, research, and not-for-profit purposes, without fee, is hereby
+// granted, provided that the above copyright notice, this paragraph and the following
+// two paragraphs appear in all copies, modifications, and distributions. For
+// commercial licensing opportunities, please contact The Office of Commercialization,
+// WSU, 280/286 Lighty, PB Box 641060, Pullman, WA 99164, (509) 335-5526,
+// commercialization@wsu.edu<mailto:commercialization@wsu.edu>, https://commercialization.wsu.edu/
+
+// IN NO EVENT SHALL WSU BE LIABLE TO ANY PARTY FOR DIRECT, INDIRECT, SPECIAL, INCIDENTAL,
+// OR CONSEQUENTIAL DAMAGES, INCLUDING LOST PROFITS, ARISING OUT OF THE USE OF
+// THIS SOFTWARE AND ITS DOCUMENTATION, EVEN IF WSU HAS BEEN ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+// WSU SPECIFICALLY DISCLAIMS ANY WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. THE SOFTWARE AND
+// ACCOMPANYING DOCUMENTATION, IF ANY, PROVIDED HEREUNDER IS PROVIDED "AS IS". WSU HAS NO
+// OBLIGATION TO PROVIDE MAINTENANCE, SUPPORT, UPDATES, ENHANCEMENTS, OR MODIFICATIONS.
+// **************************************************************************************************
+
+#include "defs.h"
+#include "utilityClusteringFunctions.h"
+#include "basic_util.h"
+
+using namespace std;
+
+//Split a list of vertices into light vertices and hubs (degree > hubThreshold).
+//Light vertices keep their order and are cut into nT contiguous chunks of about the
+//same weight (edges + vertices); hubs are processed later by all threads together.
+//vertices == NULL stands for 0..numVertices-1; hubThreshold <= 0 turns hubs off.
+void buildHybridSchedule(hybridSchedule *S, long *vertices, long numVertices, long *vtxPtr,
+                         long hubThreshold, int nT) {
+  long numHubs = 0;
+  if (hubThreshold > 0) {
+#pragma omp parallel for reduction(+:numHubs)
+    for (long k=0; k<numVertices; k++) {
+      long v = (vertices != 0) ? vertices[k] : k;
+      if ((vtxPtr[v+1] - vtxPtr[v]) > hubThreshold)
+        numHubs++;
+    }
+  }
+  S->numHubs    = numHubs;
+  S->numLight   = numVertices - numHubs;
+  S->hubs       = 0;
+  S->light      = 0;
+
+  long *prefix = 0; //Degree prefix sum of the light vertices, only needed when they are not the identity
+  if ((vertices != 0) || (numHubs > 0)) {
+    S->light = (long *) malloc ((S->numLight+1) * sizeof(long)); assert(S->light != 0);
+    prefix   = (long *) malloc ((S->numLight+1) * sizeof(long)); assert(prefix != 0);
+    if (numHubs > 0) {
+      S->hubs = (long *) malloc (numHubs * sizeof(long)); assert(S->hubs != 0);
+    }
+    long numLight = 0;
+    numHubs = 0;
+    prefix[0] = 0;
+    for (long k=0; k<numVertices; k++) {
+      long v = (vertices != 0) ? vertices[k] : k;
+      long degree = vtxPtr[v+1] - vtxPtr[v];
+      if ((hubThreshold > 0) && (degree > hubThreshold)) {
+        S->hubs[numHubs++] = v;
+      } else {
+        S->light[numLight] = v;
+        prefix[numLight+1] = prefix[numLight] + degree;
+        numLight++;
+      }
+    }
+  }
+
+  //Edge-balanced boundaries over the light list, the same way as for a plain vertex range
+  S->lightStart = buildEdgePartition((prefix != 0) ? prefix : vtxPtr, S->numLight, nT);
+  if (prefix != 0)
+    free(prefix);
+}//End of buildHybridSchedule()
+
+void freeHybridSchedule(hybridSchedule *S) {
+  if (S->light != 0)
+    free(S->light);
+  if (S->hubs != 0)
+    free(S->hubs);
+  free(S->lightStart);
+}//End of freeHybridSchedule()
+
+long maxHubDegree(hybridSchedule *S, long *vtxPtr) {
+  long maxDegree = 0;
+  for (long h=0; h<S->numHubs; h++) {
+    long degree = vtxPtr[S->hubs[h]+1] - vtxPtr[S->hubs[h]];
+    if (degree > maxDegree)
+      maxDegree = degree;
+  }
+  return maxDegree;
+}//End of maxHubDegree()
+
+//Scratch for maxHubParallel(): one per thread, sized for the largest hub
+hubScratch* allocHubScratch(int nT, long maxDegree) {
+  hubScratch *H = (hubScratch *) malloc (nT * sizeof(hubScratch)); assert(H != 0);
+#pragma omp parallel num_threads(nT)
+  {
+    hubScratch *myH = &H[omp_get_thread_num()];
+    myH->partial  = (mapElement *) malloc ((maxDegree+1) * sizeof(mapElement)); assert(myH->partial != 0);
+    myH->bucketed = (mapElement *) malloc ((maxDegree+1) * sizeof(mapElement)); assert(myH->bucketed != 0);
+    myH->merged   = (mapElement *) malloc ((maxDegree+1) * sizeof(mapElement)); assert(myH->merged != 0);
+    myH->bucketStart = (long *) malloc ((nT+1) * sizeof(long)); assert(myH->bucketStart != 0);
+    initHashLocalMap(&myH->partialHash, maxDegree+1);
+    initHashLocalMap(&myH->mergedHash, maxDegree+1);
+  }
+  return H;
+}//End of allocHubScratch()
+
+void freeHubScratch(hubScratch *H, int nT) {
+  for (int t=0; t<nT; t++) {
+    free(H[t].partial);
+    free(H[t].bucketed);
+    free(H[t].merged);
+    free(H[t].bucketStart);
+    freeHashLocalMap(&H[t].partialHash);
+    freeHashLocalMap(&H[t].mergedHash);
+  }
+  free(H);
+}//End of freeHubScratch()
+
+//Add weight to the counter of cid; insert cid if it is not there yet
+static inline void addToHashLocalMap(hashLocalMap *HT, mapElement *list, long &num, long cid, double weight) {
+  long slot = findSlotHashLocalMap(HT, cid);
+  if (HT->key[slot] == cid) {
+    list[HT->position[slot]].Counter += weight;
+  } else {
+    HT->key[slot] = cid;
+    HT->position[slot] = num;
+    HT->touched[HT->numTouched++] = slot;
+    list[num].cid     = cid;
+    list[num].Counter = weight;
+    num++;
+  }
+}
+
+//Steps 2-4 of maxHubParallel(), once each thread has counted its slice (numPartial entries)
+template<typename IdxT, typename WtT>
+static long maxHubMerge(long v, long numPartial, IdxT* currCommAss, CommT<IdxT, WtT>* cInfo,
+                        double degree, double constant, hubScratch *H, double *eix, double *exxChange) {
+  int tid = omp_get_thread_num();
+  int nT  = omp_get_num_threads();
+  hubScratch *myH = &H[tid];
+  long sc   = currCommAss[v];
+
+  //Group the partial counters by owner
+  for (int t=0; t<=nT; t++)
+    myH->bucketStart[t] = 0;
+  for (long k=0; k<numPartial; k++)
+    myH->bucketStart[(myH->partial[k].cid % nT) + 1]++;
+  for (int t=0; t<nT; t++)
+    myH->bucketStart[t+1] += myH->bucketStart[t];
+  for (long k=0; k<numPartial; k++) {
+    long owner = myH->partial[k].cid % nT;
+    myH->bucketed[myH->bucketStart[owner]++] = myH->partial[k];
+  }
+  for (int t=nT; t>0; t--) //Restore the starting positions
+    myH->bucketStart[t] = myH->bucketStart[t-1];
+  myH->bucketStart[0] = 0;
+#pragma omp barrier
+
+  //Step 2: Merge the counters of the communities owned by this thread
+  long numMerged = 0;
+  double selfLoop = 0;
+  for (int t=0; t<nT; t++) {
+    selfLoop += H[t].selfLoop;
+    for (long k=H[t].bucketStart[tid]; k<H[t].bucketStart[tid+1]; k++)
+      addToHashLocalMap(&myH->mergedHash, myH->merged, numMerged, H[t].bucketed[k].cid, H[t].bucketed[k].Counter);
+  }
+  if ((sc % nT) == tid) { //The owner of the current community publishes e_ix
+    long slot = findSlotHashLocalMap(&myH->mergedHash, sc);
+    myH->eix = (myH->mergedHash.key[slot] == sc) ? myH->merged[myH->mergedHash.position[slot]].Counter : 0;
+  }
+  clearHashLocalMap(&myH->mergedHash);
+#pragma omp barrier
+
+  //Step 3: Best community among the ones owned by this thread
+  double counterSc = H[sc % nT].eix;
+  double ex = counterSc - selfLoop;
+  double ax = cInfo[sc].degree - degree;
+  myH->maxIndex   = sc;
+  myH->maxGain    = 0;
+  myH->maxCounter = counterSc;
+  for (long k=0; k<numMerged; k++) {
+    long cid = myH->merged[k].cid;
+    if (cid != sc) {
+      double ay = cInfo[cid].degree; // degree of cluster y
+      double curGain = 2*(myH->merged[k].Counter - ex) - 2*degree*(ay - ax)*constant;
+      if( (curGain > myH->maxGain) || ((curGain==myH->maxGain) && (curGain != 0) && (cid < myH->maxIndex)) ) {
+        myH->maxGain    = curGain;
+        myH->maxIndex   = cid;
+        myH->maxCounter = myH->merged[k].Counter;
+      }
+    }
+  }
+#pragma omp barrier
+
+  //Step 4: Reduce the per-thread winners (every thread gets the same answer)
+  long maxIndex = sc;
+  double maxGain = 0;
+  double maxCounter = counterSc;
+  for (int t=0; t<nT; t++) {
+    if( (H[t].maxGain > maxGain) || ((H[t].maxGain==maxGain) && (H[t].maxGain != 0) && (H[t].maxIndex < maxIndex)) ) {
+      maxGain    = H[t].maxGain;
+      maxIndex   = H[t].maxIndex;
+      maxCounter = H[t].maxCounter;
+    }
+  }
+  if(cInfo[maxIndex].size == 1 && cInfo[sc].size == 1 && maxIndex > sc) { //Swap protection
+    maxIndex = sc;
+  }
+  *eix = counterSc;
+  if (exxChange != 0) //e_iy - e_ix on both sides of every edge; the self loop moves with v
+    *exxChange = (maxIndex != sc) ? 2*(maxCounter - ex) : 0;
+  return maxIndex;
+}//End of maxHubMerge()
+
+//Find the best community for hub v with all threads of the enclosing parallel region:
+//(1) each thread counts a slice of the adjacency, (2) the partial counters are merged
+//by owner thread (cid % nT), (3) each owner evaluates the gain of its communities and
+//(4) the per-thread winners are reduced with the same tie-breaking rules as max().
+//Returns the target community; eix returns the counter of the current community and,
+//unless NULL, exxChange the change of e_xx if v alone moves to the target.
+//WARNING: Must be called by every thread of the team (contains barriers)
+long maxHubParallel(long v, long* vtxPtr, edge* vtxInd, long* currCommAss, Comm* cInfo,
+                    double degree, double constant, hubScratch *H, double *eix, double *exxChange) {
+  int tid = omp_get_thread_num();
+  int nT  = omp_get_num_threads();
+  hubScratch *myH = &H[tid];
+  long adj1 = vtxPtr[v];
+  long len  = vtxPtr[v+1] - adj1;
+
+  //Step 1: Partial counters for this thread's slice
+  long numPartial = 0;
+  myH->selfLoop = 0;
+  for (long j=adj1+(len*tid)/nT; j<adj1+(len*(tid+1))/nT; j++) {
+    if (vtxInd[j].tail == v)
+      myH->selfLoop += vtxInd[j].weight;
+    addToHashLocalMap(&myH->partialHash, myH->partial, numPartial, currCommAss[vtxInd[j].tail], vtxInd[j].weight);
+  }
+  clearHashLocalMap(&myH->partialHash);
+  return maxHubMerge(v, numPartial, currCommAss, cInfo, degree, constant, H, eix, exxChange);
+}//End of maxHubParallel()
+
+//Same as maxHubParallel(), on a compact graph
+//WARNING: Must be called by every thread of the team (contains barriers)
+template<typename IdxT, typename WtT, bool Weighted>
+long maxHubParallelCompact(long v, long* vtxPtr, IdxT* vtxTail, WtT* vtxWeight, IdxT* currCommAss, CommT<IdxT, WtT>* cInfo,
+                           double degree, double constant, hubScratch *H, double *eix) {
+  int tid = omp_get_thread_num();
+  int nT  = omp_get_num_threads();
+  hubScratch *myH = &H[tid];
+  long adj1 = vtxPtr[v];
+  long len  = vtxPtr[v+1] - adj1;
+
+  long numPartial = 0;
+  myH->selfLoop = 0;
+  for (long j=adj1+(len*tid)/nT; j<adj1+(len*(tid+1))/nT; j++) {
+    if (vtxTail[j] == v)
+      myH->selfLoop += edgeWeight<Weighted>(vtxWeight, j);
+    addToHashLocalMap(&myH->partialHash, myH->partial, numPartial, currCommAss[vtxTail[j]], edgeWeight<Weighted>(vtxWeight, j));
+  }
+  clearHashLocalMap(&myH->partialHash);
+  return maxHubMerge(v, numPartial, currCommAss, cInfo, degree, constant, H, eix, 0);
+}//End of maxHubParallelCompact()
+#define INSTANTIATE_HUB_COMPACT(IdxT, WtT, Weighted) \
+  template long maxHubParallelCompact<IdxT, WtT, Weighted>(long v, long* vtxPtr, IdxT* vtxTail, WtT* vtxWeight, \
+                                                           IdxT* currCommAss, CommT<IdxT, WtT>* cInfo, double degree, \
+                                                           double constant, hubScratch *H, double *eix);
+INSTANTIATE_HUB_COMPACT(long, double, true)
+INSTANTIATE_HUB_COMPACT(int, double, true)
+INSTANTIATE_HUB_COMPACT(int, float, true)
+INSTANTIATE_HUB_COMPACT(long, double, false)
+INSTANTIATE_HUB_COMPACT(int, double, false)
+INSTANTIATE_HUB_COMPACT(int, float, false)
+
+//Report how evenly the sweep work was spread over the threads
+void reportThreadBusyTime(double *busyTime, int nT) {
+  double minBusy = busyTime[0], maxBusy = busyTime[0], sumBusy = 0;
+  for (int t=0; t<nT; t++) {
+    if (busyTime[t] < minBusy) minBusy = busyTime[t];
+    if (busyTime[t] > maxBusy) maxBusy = busyTime[t];
+    sumBusy += busyTime[t];
+  }
+  double avgBusy = sumBusy / nT;
+  printf("Sweep busy time per thread (s): min %3.3lf avg %3.3lf max %3.3lf -- imbalance (max/avg): %3.3lf\n",
+         minBusy, avgBusy, maxBusy, (avgBusy > 0) ? maxBusy/avgBusy : 1.0);
+}//End of reportThreadBusyTime()
@@ -0,0 +1,165 @@
+// **************************************************************************************************
+// Grappolo: A C++ library for parallel graph community detection
+// Hao Lu, Ananth Kalyanaraman (hao.lu@wsu.edu, ananth@eecs.wsu.edu) Washington State University
+// Mahantesh Halappanavar (hala@pnnl.gov) Pacific Northwest National Laboratory
+//
+// For citation, please cite the following paper:
+// Lu, Hao, Mahantesh Halappanavar, and Ananth Kalyanaraman. 
+// "Parallel heuristics for scalable community detection." Parallel Computing 47 (2015): 19-37.
+//
+// **************************************************************************************************
+// Copyright (c) 2016. Washington State University ("WSU"). All Rights Reserved.
+// Permission to use, copy, modify, and distribute this software and its documentation
+// for educational, research, and not-for-profit purposes, without fee, is hereby
+// granted, provided that the above copyright notice, this paragraph and the following
+// two paragraphs appear in all copies, modifications, and distributions. For
+// commercial licensing opportunities, please contact The Office of Commercialization,
+// WSU, 280/286 Lighty, PB Box 641060, Pullman, WA 99164, (509) 335-5526,
+// commercialization@wsu.edu<mailto:commercialization@wsu.edu>, https://commercialization.wsu.edu/
+
+// IN NO EVENT SHALL WSU BE LIABLE TO ANY PARTY FOR DIRECT, INDIRECT, SPECIAL, INCIDENTAL,
+// OR CONSEQUENTIAL DAMAGES, INCLUDING LOST PROFITS, ARISING OUT OF THE USE OF
+// THIS SOFTWARE AND ITS DOCUMENTATION, EVEN IF WSU HAS BEEN ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+// WSU SPECIFICALLY DISCLAIMS ANY WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. THE SOFTWARE AND
+// ACCOMPANYING DOCUMENTATION, IF ANY, PROVIDED HEREUNDER IS PROVIDED "AS IS". WSU HAS NO
+// OBLIGATION TO PROVIDE MAINTENANCE, SUPPORT, UPDATES, ENHANCEMENTS, OR MODIFICATIONS.
+// **************************************************************************************************
+
+#include "defs.h"
+#include "basic_util.h"
+#ifdef USE_LIBNUMA
+#include <numa.h>
+#include <numaif.h>
+#include <sched.h>
+#endif
+
+using namespace std;
+
+static int numaPlacement = 0;
+
+//Pick the placement of the graph arrays: (0) as allocated by the loaders
+//(1) first touch: each edge-balanced range is written by the thread that sweeps it
+//(2) interleaved over the NUMA nodes (needs USE_LIBNUMA, else falls back to 1)
+//First touch only helps if the threads stay on their cores: pin them with
+//OMP_PROC_BIND=close (or spread) and OMP_PLACES=cores.
+void selectNumaPlacement(int mode) {
+  numaPlacement = mode;
+#ifdef USE_LIBNUMA
+  if (numa_available() < 0) {
+    printf("NUMA placement: not supported by the system, using first touch\n");
+    if (numaPlacement == 2)
+      numaPlacement = 1;
+  }
+#else
+  if (numaPlacement == 2) {
+    printf("NUMA placement: interleaving needs USE_LIBNUMA (see the Makefile), using first touch\n");
+    numaPlacement = 1;
+  }
+#endif
+  if (numaPlacement == 0)
+    return;
+  printf("NUMA placement: %s\n", (numaPlacement == 1) ? "first touch by the owner thread" : "interleaved");
+  if (omp_get_proc_bind() == omp_proc_bind_false)
+    printf("NUMA placement: WARNING threads are not pinned; set OMP_PROC_BIND=close and OMP_PLACES=cores\n");
+}//End of selectNumaPlacement()
+
+int numaPlacementMode() {
+  return numaPlacement;
+}//End of numaPlacementMode()
+
+//Page-aligned allocation that does not touch the memory: pages land on the node
+//of the thread that writes them first, or are interleaved in mode 2
+static void* allocUntouched(size_t bytes) {
+  void *p = 0;
+  long pageSize = sysconf(_SC_PAGESIZE);
+  int rc = posix_memalign(&p, pageSize, (bytes > 0) ? bytes : 1);
+  assert((rc == 0) && (p != 0));
+#ifdef USE_LIBNUMA
+  if ((numaPlacement == 2) && (bytes > 0))
+    numa_interleave_memory(p, bytes, numa_all_nodes_ptr);
+#endif
+  return p;
+}//End of allocUntouched()
+
+//Move the CSR arrays of G to new pages placed by the selected policy. In first-touch
+//mode the thread that owns an edge-balanced range (buildEdgePartition(), the same
+//ranges as the sweep) copies its vertices and edges. No-op in mode 0.
+void placeGraph(graph *G, int nT) {
+  if (numaPlacement == 0)
+    return;
+  double time1 = omp_get_wtime();
+  long NV       = G->numVertices;
+  long *vtxPtr  = G->edgeListPtrs;
+  edge *vtxInd  = G->edgeList;
+  long *part    = buildEdgePartition(vtxPtr, NV, nT);
+  long *newPtr  = (long *) allocUntouched((NV+1) * sizeof(long));
+  edge *newInd  = (edge *) allocUntouched(vtxPtr[NV] * sizeof(edge));
+#pragma omp parallel num_threads(nT)
+  {
+    int tid = omp_get_thread_num();
+    for (long i=part[tid]; i<part[tid+1]; i++)
+      newPtr[i] = vtxPtr[i];
+    for (long j=vtxPtr[part[tid]]; j<vtxPtr[part[tid+1]]; j++)
+      newInd[j] = vtxInd[j];
+  }
+  newPtr[NV] = vtxPtr[NV];
+  free(vtxPtr);
+  free(vtxInd);
+  G->edgeListPtrs = newPtr;
+  G->edgeList     = newInd;
+  free(part);
+#ifdef PRINT_DETAILED_STATS_
+  printf("Time to place the graph: %3.3lf\n", omp_get_wtime() - time1);
+#endif
+}//End of placeGraph()
+
+//Share of the edge pages that sit on the NUMA node of the thread sweeping them,
+//sampled with move_pages() (up to 1024 pages per thread). Hardware counters for
+//remote accesses are not portable; page locality is what first touch controls.
+void reportNumaLocality(graph *G, int nT) {
+#ifdef USE_LIBNUMA
+  if ((numaPlacement == 0) || (numa_available() < 0) || (numa_max_node() == 0))
+    return;
+  long NV      = G->numVertices;
+  long *vtxPtr = G->edgeListPtrs;
+  long *part   = buildEdgePartition(vtxPtr, NV, nT);
+  long pageSize = sysconf(_SC_PAGESIZE);
+  long numLocal = 0, numSampled = 0;
+#pragma omp parallel num_threads(nT) reduction(+:numLocal) reduction(+:numSampled)
+  {
+    int tid = omp_get_thread_num();
+    int myNode = numa_node_of_cpu(sched_getcpu());
+    char *first = (char *) &G->edgeList[vtxPtr[part[tid]]];
+    char *last  = (char *) &G->edgeList[vtxPtr[part[tid+1]]];
+    long numPages = (last - first) / pageSize;
+    if (numPages > 0) {
+      long count  = (numPages < 1024) ? numPages : 1024;
+      long stride = numPages / count;
+      void **pages = (void **) malloc (count * sizeof(void *)); assert(pages != 0);
+      int *status  = (int *) malloc (count * sizeof(int)); assert(status != 0);
+      for (long k=0; k<count; k++)
+        pages[k] = first + k*stride*pageSize;
+      if (move_pages(0, count, pages, NULL, status, 0) == 0) {
+        for (long k=0; k<count; k++) {
+          if (status[k] < 0)
+            continue; //Not mapped yet
+          numSampled++;
+          if (status[k] == myNode)
+            numLocal++;
+        }
+      }
+      free(pages);
+      free(status);
+    }
+  }
+  free(part);
+  if (numSampled > 0)
+    printf("NUMA locality: %3.1lf%% of %ld sampled edge pages are local to their thread (remote: %3.1lf%%)\n",
+           100.0*numLocal/numSampled, numSampled, 100.0*(numSampled-numLocal)/numSampled);
+#else
+  (void) G; (void) nT; //No page locality to sample without libnuma
+#endif
+}//End of reportNumaLocality()
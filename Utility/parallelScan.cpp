@@ -0,0 +1,225 @@
+// **************************************************************************************************
+// Grappolo: A C++ library for parallel graph community detection
+// Hao Lu, Ananth Kalyanaraman (hao.lu@wsu.edu, ananth@eecs.wsu.edu) Washington State University
+// Mahantesh Halappanavar (hala@pnnl.gov) Pacific Northwest National Laboratory
+//
+// For citation, please cite the following paper:
+// Lu, Hao, Mahantesh Halappanavar, and Ananth Kalyanaraman. 
+// "Parallel heuristics for scalable community detection." Parallel Computing 47 (2015): 19-37.
+//
+// **************************************************************************************************
+// Copyright (c) 2016. Washington State University ("WSU"). All Rights Reserved.
+// Permission to use, copy, modify, and distribute this software and its documentation
+// for educational, research, and not-for-profit purposes, without fee, is hereby
+// granted, provided that the above copyright notice, this paragraph and the following
+// two paragraphs appear in all copies, modifications, and distributions. For
+// commercial licensing opportunities, please contact The Office of Commercialization,
+// WSU, 280/286 Lighty, PB Box 641060, Pullman, WA 99164, (509) 335-5526,
+// commercialization@wsu.edu<mailto:commercialization@wsu.edu>, https://commercialization.wsu.edu/
+
+// IN NO EVENT SHALL WSU BE LIABLE TO ANY PARTY FOR DIRECT, INDIRECT, SPECIAL, INCIDENTAL,
+// OR CONSEQUENTIAL DAMAGES, INCLUDING LOST PROFITS, ARISING OUT OF THE USE OF
+// THIS SOFTWARE AND ITS DOCUMENTATION, EVEN IF WSU HAS BEEN ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+// WSU SPECIFICALLY DISCLAIMS ANY WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. THE SOFTWARE AND
+// ACCOMPANYING DOCUMENTATION, IF ANY, PROVIDED HEREUNDER IS PROVIDED "AS IS". WSU HAS NO
+// OBLIGATION TO PROVIDE MAINTENANCE, SUPPORT, UPDATES, ENHANCEMENTS, OR MODIFICATIONS.
+// **************************************************************************************************
+
+#include "defs.h"
+#include "basic_util.h"
+#include <algorithm>
+
+using namespace std;
+
+//Shared scan and CSR-construction primitives. Every CSR in the code (graph
+//loaders, coarsening, color classes, community member lists) is built the same
+//way: count per key, prefix sum the counts, scatter the items. Both steps are
+//done here in parallel, and the scatter is stable so the result does not depend
+//on the thread schedule.
+
+#define SCAN_SERIAL_CUTOFF 65536  //Shorter arrays are scanned serially
+
+//In-place inclusive prefix sum of A[0..n-1]; returns the total.
+//An exclusive scan of counts stored from A[1] with A[0] = 0 is parallelPrefixSum(A, n+1).
+long parallelPrefixSum(long *A, long n) {
+  if (n <= 0)
+    return 0;
+  int nT = omp_get_max_threads();
+  if ((n < SCAN_SERIAL_CUTOFF) || (nT == 1) || omp_in_parallel()) {
+    for (long i=1; i<n; i++)
+      A[i] += A[i-1];
+    return A[n-1];
+  }
+  //Pass 1: scan each block; serial scan of the block totals; pass 2: add the offsets
+  long *blockSum = (long *) malloc ((nT+1) * sizeof(long)); assert(blockSum != 0);
+  blockSum[0] = 0;
+#pragma omp parallel for schedule(static, 1)
+  for (int t=0; t<nT; t++) {
+    long begin = (n * t) / nT;
+    long end   = (n * (t+1)) / nT;
+    for (long i=begin+1; i<end; i++)
+      A[i] += A[i-1];
+    blockSum[t+1] = (end > begin) ? A[end-1] : 0;
+  }
+  for (int t=0; t<nT; t++)
+    blockSum[t+1] += blockSum[t];
+#pragma omp parallel for schedule(static, 1)
+  for (int t=1; t<nT; t++) {
+    long begin = (n * t) / nT;
+    long end   = (n * (t+1)) / nT;
+    long offset = blockSum[t];
+    for (long i=begin; i<end; i++)
+      A[i] += offset;
+  }
+  free(blockSum);
+  return A[n-1];
+}//End of parallelPrefixSum()
+
+//Stable scatter shared by the CSR builders: the items 0..n-1 are cut into numBlocks
+//blocks, every block counts its keys into a private histogram, which gives each
+//(key, block) pair its own output range, so the items of a key stay in increasing order.
+//Items provides key(i) (negative: left out) and place(i, position). Sets Ptr[0..numKeys].
+template<typename Items>
+static void scatterByKey(const Items &items, long n, long numKeys, int numBlocks, long *Ptr) {
+  long *count = (long *) malloc ((long)numBlocks * numKeys * sizeof(long)); assert(count != 0);
+  Ptr[0] = 0;
+#pragma omp parallel for schedule(static, 1)
+  for (int t=0; t<numBlocks; t++) {
+    long *myCount = count + (long)t * numKeys;
+    for (long k=0; k<numKeys; k++)
+      myCount[k] = 0;
+    long end = (n * (t+1)) / numBlocks;
+    for (long i=(n * t) / numBlocks; i<end; i++) {
+      long k = items.key(i);
+      if (k >= 0) {
+        assert(k < numKeys);
+        myCount[k]++;
+      }
+    }
+  }
+  //Turn the counts of each key into offsets within the key, in block order
+#pragma omp parallel for
+  for (long k=0; k<numKeys; k++) {
+    long sum = 0;
+    for (int t=0; t<numBlocks; t++) {
+      long c = count[(long)t * numKeys + k];
+      count[(long)t * numKeys + k] = sum;
+      sum += c;
+    }
+    Ptr[k+1] = sum;
+  }
+  parallelPrefixSum(Ptr, numKeys+1);
+#pragma omp parallel for schedule(static, 1)
+  for (int t=0; t<numBlocks; t++) {
+    long *myCount = count + (long)t * numKeys;
+    long end = (n * (t+1)) / numBlocks;
+    for (long i=(n * t) / numBlocks; i<end; i++) {
+      long k = items.key(i);
+      if (k >= 0)
+        items.place(i, Ptr[k] + myCount[k]++);
+    }
+  }
+  free(count);
+}//End of scatterByKey()
+
+//Items of buildCSRByKey(): the key of item i is Key[i], its position goes to Index
+template<typename KeyT>
+struct keyArrayItems
+{
+  const KeyT *Key;
+  long *Index;
+  long key(long i) const { return (long)Key[i]; }
+  void place(long i, long position) const { Index[position] = i; }
+};
+
+//Items of buildCSRFromEdges(): entry i is edge i from its head, or with bothDirections,
+//edge i/2 from its head (even i) and from its tail (odd i)
+struct edgeListItems
+{
+  const edge *list;
+  edge *Out;
+  bool bothDirections;
+  long key(long i) const {
+    if (!bothDirections)
+      return list[i].head;
+    return (i & 1) ? list[i>>1].tail : list[i>>1].head;
+  }
+  void place(long i, long position) const {
+    const edge *e = bothDirections ? &list[i>>1] : &list[i];
+    bool reversed = bothDirections && (i & 1);
+    Out[position].head   = reversed ? e->tail : e->head;
+    Out[position].tail   = reversed ? e->head : e->tail;
+    Out[position].weight = e->weight;
+  }
+};
+
+//Group the items 0..n-1 by key: on return Index[Ptr[k]..Ptr[k+1]-1] holds, in
+//increasing order, the items i with Key[i] == k. Items with a negative key are
+//left out. Ptr must have numKeys+1 entries; returns the number of items grouped.
+//With few keys every thread counts its block of items into a private histogram
+//(scatterByKey()); otherwise the counts are atomic and each key's range is sorted
+//after the scatter.
+template<typename KeyT>
+long buildCSRByKey(const KeyT *Key, long n, long numKeys, long *Ptr, long *Index) {
+  int nT = omp_get_max_threads();
+  Ptr[0] = 0;
+  if ((nT == 1) || ((long)nT * numKeys <= n)) {
+    keyArrayItems<KeyT> items;
+    items.Key   = Key;
+    items.Index = Index;
+    scatterByKey(items, n, numKeys, nT, Ptr);
+  } else {
+#pragma omp parallel for
+    for (long k=0; k<numKeys; k++)
+      Ptr[k+1] = 0;
+#pragma omp parallel for
+    for (long i=0; i<n; i++) {
+      if (Key[i] >= 0) {
+        assert((long)Key[i] < numKeys);
+        __sync_fetch_and_add(&Ptr[Key[i]+1], 1);
+      }
+    }
+    parallelPrefixSum(Ptr, numKeys+1);
+    long *fill = (long *) malloc (numKeys * sizeof(long)); assert(fill != 0);
+#pragma omp parallel for
+    for (long k=0; k<numKeys; k++)
+      fill[k] = Ptr[k];
+#pragma omp parallel for
+    for (long i=0; i<n; i++) {
+      if (Key[i] >= 0)
+        Index[__sync_fetch_and_add(&fill[Key[i]], 1)] = i;
+    }
+#pragma omp parallel for schedule(dynamic, 256)
+    for (long k=0; k<numKeys; k++)
+      sort(Index+Ptr[k], Index+Ptr[k+1]);
+    free(fill);
+  }
+  return Ptr[numKeys];
+}//End of buildCSRByKey()
+
+template long buildCSRByKey<long>(const long *Key, long n, long numKeys, long *Ptr, long *Index);
+template long buildCSRByKey<int>(const int *Key, long n, long numKeys, long *Ptr, long *Index);
+
+//CSR of the edges of list (the loaders' temporary edge list) over vertices 0..NV-1:
+//edge i is stored from its head, and with bothDirections also from its tail.
+//The entries of a vertex keep the order of list, as with a serial fill, whatever
+//the number of threads. Ptr must have NV+1 entries and Out room for every entry.
+//Returns the number of entries. A block of at least NV entries per thread keeps
+//the histograms (NV longs each) within the size of the edge list.
+long buildCSRFromEdges(const edge *list, long NE, long NV, bool bothDirections, long *Ptr, edge *Out) {
+  long n = bothDirections ? 2*NE : NE;
+  long numBlocks = (NV > 0) ? n / NV : 1;
+  if (numBlocks > omp_get_max_threads())
+    numBlocks = omp_get_max_threads();
+  if (numBlocks < 1)
+    numBlocks = 1;
+  edgeListItems items;
+  items.list = list;
+  items.Out  = Out;
+  items.bothDirections = bothDirections;
+  scatterByKey(items, n, NV, (int)numBlocks, Ptr);
+  return Ptr[NV];
+}//End of buildCSRFromEdges()
@@ -0,0 +1,168 @@
+// **************************************************************************************************
+// Grappolo: A C++ library for parallel graph community detection
+// Hao Lu, Ananth Kalyanaraman (hao.lu@wsu.edu, ananth@eecs.wsu.edu) Washington State University
+// Mahantesh Halappanavar (hala@pnnl.gov) Pacific Northwest National Laboratory
+//
+// For citation, please cite the following paper:
+// Lu, Hao, Mahantesh Halappanavar, and Ananth Kalyanaraman. 
+// "Parallel heuristics for scalable community detection." Parallel Computing 47 (2015): 19-37.
+//
+// **************************************************************************************************
+// Copyright (c) 2016. Washington State University ("WSU"). All Rights Reserved.
+// Permission to use, copy, modify, and distribute this software and its documentation
+// for educational, research, and not-for-profit purposes, without fee, is hereby
+// granted, provided that the above copyright notice, this paragraph and the following
+// two paragraphs appear in all copies, modifications, and distributions. For
+// commercial licensing opportunities, please contact The Office of Commercialization,
+// WSU, 280/286 Lighty, PB Box 641060, Pullman, WA 99164, (509) 335-5526,
+// commercialization@wsu.edu<mailto:commercialization@wsu.edu>, https://commercialization.wsu.edu/
+
+// IN NO EVENT SHALL WSU BE LIABLE TO ANY PARTY FOR DIRECT, INDIRECT, SPECIAL, INCIDENTAL,
+// OR CONSEQUENTIAL DAMAGES, INCLUDING LOST PROFITS, ARISING OUT OF THE USE OF
+// THIS SOFTWARE AND ITS DOCUMENTATION, EVEN IF WSU HAS BEEN ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+// WSU SPECIFICALLY DISCLAIMS ANY WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. THE SOFTWARE AND
+// ACCOMPANYING DOCUMENTATION, IF ANY, PROVIDED HEREUNDER IS PROVIDED "AS IS". WSU HAS NO
+// OBLIGATION TO PROVIDE MAINTENANCE, SUPPORT, UPDATES, ENHANCEMENTS, OR MODIFICATIONS.
+// **************************************************************************************************
+
+#include "defs.h"
+#include "basic_util.h"
+#include <sys/resource.h>
+
+using namespace std;
+
+//Pipeline-scoped scratch arena: runMultiPhase* sizes it once from the phase-1
+//graph and every Louvain sweep and coarsening step carves its per-vertex arrays
+//from it. Later phases are smaller, so they reuse pages that were faulted in
+//(and placed by first touch) during phase 1 instead of going back to malloc.
+#define ARENA_ALIGN 64
+
+typedef struct {
+  char  *base;
+  size_t capacity;
+  size_t top;        //Bump pointer (bytes used)
+  long   live;       //Blocks handed out and not yet released
+  size_t highWater;
+  long   numAllocs;  //Per-phase counters, cleared by reportPhaseArena()
+  long   numSpills;
+  long   lastMinFlt;
+} phaseArena;
+
+static phaseArena *arena = 0;
+
+static long minorFaults() {
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) != 0)
+    return 0;
+  return usage.ru_minflt;
+}//End of minorFaults()
+
+//Size the arena for the largest per-phase footprint of the phase-1 graph:
+//the Louvain state (vDegree, cInfo, cUpdate, the e_ix of the Frontier engine and
+//three assignment arrays), plus per-thread neighbour maps bounded by the maximum
+//degree when the sweep draws them from the arena (withLocalMaps: Hash engine)
+void createPhaseArena(graph *G, int nT, bool withLocalMaps) {
+  assert(arena == 0);
+  long NV = G->numVertices;
+  long NE = G->numEdges;
+  long *vtxPtr = G->edgeListPtrs;
+  long maxDegree = 0;
+#pragma omp parallel for reduction(max: maxDegree)
+  for (long i=0; i<NV; i++) {
+    long deg = vtxPtr[i+1] - vtxPtr[i];
+    if (deg > maxDegree)
+      maxDegree = deg;
+  }
+  size_t perVertex = 2*sizeof(double) + 2*sizeof(Comm) + 3*sizeof(long);
+  size_t scratch   = 0;
+  if (withLocalMaps)
+    scratch = (size_t)nT * (size_t)(((maxDegree < 2*NE) ? maxDegree : 2*NE) + 1) * sizeof(mapElement);
+  long pageSize    = sysconf(_SC_PAGESIZE);
+  size_t bytes     = (size_t)NV * perVertex + scratch + 16*(nT + 8)*ARENA_ALIGN;
+  bytes = ((bytes + pageSize - 1) / pageSize) * pageSize;
+
+  arena = (phaseArena *) malloc (sizeof(phaseArena)); assert(arena != 0);
+  void *p = 0;
+  int rc = posix_memalign(&p, pageSize, bytes);
+  assert((rc == 0) && (p != 0));
+  arena->base = (char *) p;
+  arena->capacity = bytes;
+  //Fault the pages in once, up front. Not with NUMA placement (-n): the sweeps then
+  //first-touch their blocks over the edge-balanced ranges (sumVertexDegree(), initCommAssOpt())
+  if (numaPlacementMode() == 0) {
+    long numPages = bytes / pageSize;
+#pragma omp parallel for schedule(static)
+    for (long i=0; i<numPages; i++) {
+      arena->base[i*pageSize] = 0;
+    }
+  }
+  arena->top = 0;
+  arena->live = 0;
+  arena->highWater = 0;
+  arena->numAllocs = 0;
+  arena->numSpills = 0;
+  arena->lastMinFlt = minorFaults();
+  printf("Phase arena: %ld KB for %ld vertices, %ld edges\n", (long)(bytes >> 10), NV, NE);
+}//End of createPhaseArena()
+
+//Carve a block from the arena, or fall back to malloc when there is no arena
+//or it is full. Safe to call from inside a parallel region.
+void* phaseAlloc(size_t bytes) {
+  void *p = 0;
+  if (arena != 0) {
+    size_t sz = ((bytes + ARENA_ALIGN - 1) / ARENA_ALIGN) * ARENA_ALIGN;
+    __sync_fetch_and_add(&arena->numAllocs, 1);
+    size_t off = __sync_fetch_and_add(&arena->top, sz);
+    if (off + sz <= arena->capacity) {
+      __sync_fetch_and_add(&arena->live, 1);
+      if (off + sz > arena->highWater)
+        arena->highWater = off + sz; //Statistics only, races are benign
+      return arena->base + off;
+    }
+    __sync_fetch_and_add(&arena->numSpills, 1);
+  }
+  p = malloc((bytes > 0) ? bytes : 1);
+  assert(p != 0);
+  return p;
+}//End of phaseAlloc()
+
+//Release a block from phaseAlloc(). Arena blocks are reclaimed together: once
+//the last live block is released outside a parallel region the bump pointer
+//goes back to the start, so the next sweep or coarsening step reuses the pages.
+void phaseFree(void *p) {
+  if (p == 0)
+    return;
+  if ((arena != 0) && ((char *)p >= arena->base) && ((char *)p < arena->base + arena->capacity)) {
+    long left = __sync_sub_and_fetch(&arena->live, 1);
+    assert(left >= 0);
+    if ((left == 0) && !omp_in_parallel())
+      arena->top = 0;
+    return;
+  }
+  free(p);
+}//End of phaseFree()
+
+//Print the allocation count and the minor page faults since the last report
+void reportPhaseArena(long phase) {
+  if (arena == 0)
+    return;
+  long flt = minorFaults();
+  printf("Phase arena (phase %ld): %ld allocations, %ld spilled to malloc, high water %ld of %ld KB, %ld minor page faults\n",
+         phase, arena->numAllocs, arena->numSpills, (long)(arena->highWater >> 10),
+         (long)(arena->capacity >> 10), flt - arena->lastMinFlt);
+  arena->numAllocs = 0;
+  arena->numSpills = 0;
+  arena->lastMinFlt = flt;
+}//End of reportPhaseArena()
+
+void destroyPhaseArena() {
+  if (arena == 0)
+    return;
+  assert(arena->live == 0);
+  free(arena->base);
+  free(arena);
+  arena = 0;
+}//End of destroyPhaseArena()
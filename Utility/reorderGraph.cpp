@@ -0,0 +1,283 @@
+// **************************************************************************************************
+// Grappolo: A C++ library for parallel graph community detection
+// Hao Lu, Ananth Kalyanaraman (hao.lu@wsu.edu, ananth@eecs.wsu.edu) Washington State University
+// Mahantesh Halappanavar (hala@pnnl.gov) Pacific Northwest National Laboratory
+//
+// For citation, please cite the following paper:
+// Lu, Hao, Mahantesh Halappanavar, and Ananth Kalyanaraman. 
+// "Parallel heuristics for scalable community detection." Parallel Computing 47 (2015): 19-37.
+//
+// **************************************************************************************************
+// Copyright (c) 2016. Washington State University ("WSU"). All Rights Reserved.
+// Permission to use, copy, modify, and distribute this software and its documentation
+// for educational, research, and not-for-profit purposes, without fee, is hereby
+// granted, provided that the above copyright notice, this paragraph and the following
+// two paragraphs appear in all copies, modifications, and distributions. For
+// commercial licensing opportunities, please contact The Office of Commercialization,
+// WSU, 280/286 Lighty, PB Box 641060, Pullman, WA 99164, (509) 335-5526,
+// commercialization@wsu.edu<mailto:commercialization@wsu.edu>, https://commercialization.wsu.edu/
+
+// IN NO EVENT SHALL WSU BE LIABLE TO ANY PARTY FOR DIRECT, INDIRECT, SPECIAL, INCIDENTAL,
+// OR CONSEQUENTIAL DAMAGES, INCLUDING LOST PROFITS, ARISING OUT OF THE USE OF
+// THIS SOFTWARE AND ITS DOCUMENTATION, EVEN IF WSU HAS BEEN ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+// WSU SPECIFICALLY DISCLAIMS ANY WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. THE SOFTWARE AND
+// ACCOMPANYING DOCUMENTATION, IF ANY, PROVIDED HEREUNDER IS PROVIDED "AS IS". WSU HAS NO
+// OBLIGATION TO PROVIDE MAINTENANCE, SUPPORT, UPDATES, ENHANCEMENTS, OR MODIFICATIONS.
+// **************************************************************************************************
+
+#include "defs.h"
+#include "basic_util.h"
+#include <algorithm>
+
+using namespace std;
+
+//Locality-improving relabeling of the input graph before clustering.
+//Each ordering returns newId[] (old vertex id -> new vertex id).
+
+static bool edgeByTail(const edge &a, const edge &b) {
+  return a.tail < b.tail;
+}
+
+//Compare vertices by degree, ties by id
+struct degreeCompare {
+  long *vtxPtr;
+  bool descending;
+  degreeCompare(long *ptr, bool desc) : vtxPtr(ptr), descending(desc) {}
+  bool operator()(long a, long b) const {
+    long da = vtxPtr[a+1]-vtxPtr[a], db = vtxPtr[b+1]-vtxPtr[b];
+    if (da != db)
+      return descending ? (da > db) : (da < db);
+    return a < b;
+  }
+};
+
+//(1) Degree-descending, ties by original id: hubs share the front of the arrays
+static void degreeOrder(graph *G, long *newId) {
+  long NV = G->numVertices;
+  long *vtxPtr = G->edgeListPtrs;
+  long *order = (long *) malloc (NV * sizeof(long)); assert(order != 0);
+#pragma omp parallel for
+  for (long i=0; i<NV; i++)
+    order[i] = i;
+  sort(order, order+NV, degreeCompare(vtxPtr, true));
+#pragma omp parallel for
+  for (long k=0; k<NV; k++)
+    newId[order[k]] = k;
+  free(order);
+}//End of degreeOrder()
+
+//(2) Reverse Cuthill-McKee: BFS from a minimum-degree vertex of each component,
+//neighbours visited by increasing degree, final order reversed
+static void rcmOrder(graph *G, long *newId) {
+  long NV = G->numVertices;
+  long *vtxPtr = G->edgeListPtrs;
+  edge *vtxInd = G->edgeList;
+  long *order = (long *) malloc (NV * sizeof(long)); assert(order != 0);
+  long *byDegree = (long *) malloc (NV * sizeof(long)); assert(byDegree != 0);
+  bool *visited = (bool *) malloc (NV * sizeof(bool)); assert(visited != 0);
+#pragma omp parallel for
+  for (long i=0; i<NV; i++) {
+    byDegree[i] = i;
+    visited[i] = false;
+  }
+  sort(byDegree, byDegree+NV, degreeCompare(vtxPtr, false));
+  long tail = 0; //order[] doubles as the BFS queue
+  for (long s=0; s<NV; s++) {
+    long root = byDegree[s];
+    if (visited[root])
+      continue;
+    visited[root] = true;
+    long head = tail;
+    order[tail++] = root;
+    while (head < tail) {
+      long v = order[head++];
+      long first = tail;
+      for (long j=vtxPtr[v]; j<vtxPtr[v+1]; j++) {
+        long w = vtxInd[j].tail;
+        if (!visited[w]) {
+          visited[w] = true;
+          order[tail++] = w;
+        }
+      }
+      sort(order+first, order+tail, degreeCompare(vtxPtr, false));
+    }
+  }
+  assert(tail == NV);
+#pragma omp parallel for
+  for (long k=0; k<NV; k++)
+    newId[order[k]] = NV-1-k;
+  free(order);
+  free(byDegree);
+  free(visited);
+}//End of rcmOrder()
+
+static long findRoot(long *parent, long v) {
+  long r = v;
+  while (parent[r] != r)
+    r = parent[r];
+  while (parent[v] != r) { //Path compression
+    long next = parent[v];
+    parent[v] = r;
+    v = next;
+  }
+  return r;
+}//End of findRoot()
+
+//(3) Rabbit-order style: vertices are visited by increasing degree and merged
+//into the neighbouring community with the best modularity gain; a DFS over
+//the resulting merge forest numbers each community's members contiguously.
+//Sequential and simplified: a vertex only sees its own edges, not the merged
+//adjacency of the vertices already folded into it.
+static void rabbitOrder(graph *G, long *newId) {
+  long NV = G->numVertices;
+  long *vtxPtr = G->edgeListPtrs;
+  edge *vtxInd = G->edgeList;
+  long *parent     = (long *) malloc (NV * sizeof(long));   assert(parent != 0);
+  long *firstChild = (long *) malloc (NV * sizeof(long));   assert(firstChild != 0);
+  long *nextSib    = (long *) malloc (NV * sizeof(long));   assert(nextSib != 0);
+  long *byDegree   = (long *) malloc (NV * sizeof(long));   assert(byDegree != 0);
+  double *cDegree  = (double *) malloc (NV * sizeof(double)); assert(cDegree != 0);
+  double *acc      = (double *) malloc (NV * sizeof(double)); assert(acc != 0);
+  long *touched    = (long *) malloc (NV * sizeof(long));   assert(touched != 0);
+  double totalWeight = 0;
+#pragma omp parallel for reduction(+:totalWeight)
+  for (long i=0; i<NV; i++) {
+    parent[i] = i;
+    firstChild[i] = -1;
+    nextSib[i] = -1;
+    byDegree[i] = i;
+    acc[i] = 0;
+    double d = 0;
+    for (long j=vtxPtr[i]; j<vtxPtr[i+1]; j++)
+      d += vtxInd[j].weight;
+    cDegree[i] = d;
+    totalWeight += d;
+  }
+  sort(byDegree, byDegree+NV, degreeCompare(vtxPtr, false));
+  double constant = (totalWeight > 0) ? 1/totalWeight : 0; //1/2m
+  for (long s=0; s<NV; s++) {
+    long u = byDegree[s];
+    long numTouched = 0;
+    for (long j=vtxPtr[u]; j<vtxPtr[u+1]; j++) {
+      long r = findRoot(parent, vtxInd[j].tail);
+      if (r == u)
+        continue;
+      if (acc[r] == 0)
+        touched[numTouched++] = r;
+      acc[r] += vtxInd[j].weight;
+    }
+    long best = -1;
+    double bestGain = 0;
+    for (long k=0; k<numTouched; k++) {
+      long r = touched[k];
+      double gain = acc[r] - cDegree[u]*cDegree[r]*constant; //Proportional to dQ
+      if ((gain > bestGain) || ((gain == bestGain) && (best >= 0) && (r < best))) {
+        bestGain = gain;
+        best = r;
+      }
+      acc[r] = 0;
+    }
+    if (best >= 0) { //Fold u (and everything already merged into it) into best
+      parent[u] = best;
+      cDegree[best] += cDegree[u];
+      nextSib[u] = firstChild[best];
+      firstChild[best] = u;
+    }
+  }
+  //DFS over the merge forest: a community's members get consecutive ids
+  long next = 0;
+  long *stack = touched; //Reused
+  for (long v=0; v<NV; v++) {
+    if (parent[v] != v)
+      continue;
+    long top = 0;
+    stack[top++] = v;
+    while (top > 0) {
+      long x = stack[--top];
+      newId[x] = next++;
+      for (long c=firstChild[x]; c>=0; c=nextSib[c])
+        stack[top++] = c;
+    }
+  }
+  assert(next == NV);
+  free(parent); free(firstChild); free(nextSib); free(byDegree);
+  free(cDegree); free(acc); free(touched);
+}//End of rabbitOrder()
+
+//Mean |id(u) - id(v)| over the edges: a proxy for how far apart the
+//community lookups of a vertex's neighbours land in memory
+double meanNeighborGap(graph *G) {
+  long NV = G->numVertices;
+  long *vtxPtr = G->edgeListPtrs;
+  edge *vtxInd = G->edgeList;
+  double gap = 0;
+#pragma omp parallel for reduction(+:gap) schedule(dynamic, 1024)
+  for (long i=0; i<NV; i++) {
+    for (long j=vtxPtr[i]; j<vtxPtr[i+1]; j++)
+      gap += labs(vtxInd[j].tail - i);
+  }
+  return (vtxPtr[NV] > 0) ? gap/vtxPtr[NV] : 0;
+}//End of meanNeighborGap()
+
+//Rebuild the CSR of G under newId[]: vertex k of the new graph is the old
+//vertex with newId == k; adjacency lists are sorted by (new) tail
+static void relabelGraph(graph *G, long *newId) {
+  long NV = G->numVertices;
+  long *vtxPtr = G->edgeListPtrs;
+  edge *vtxInd = G->edgeList;
+  long *oldId = (long *) malloc (NV * sizeof(long)); assert(oldId != 0);
+  long *vtxPtrOut = (long *) malloc ((NV+1) * sizeof(long)); assert(vtxPtrOut != 0);
+  edge *vtxIndOut = (edge *) malloc (vtxPtr[NV] * sizeof(edge)); assert(vtxIndOut != 0);
+#pragma omp parallel for
+  for (long i=0; i<NV; i++)
+    oldId[newId[i]] = i;
+  vtxPtrOut[0] = 0;
+#pragma omp parallel for
+  for (long k=0; k<NV; k++)
+    vtxPtrOut[k+1] = vtxPtr[oldId[k]+1] - vtxPtr[oldId[k]];
+  parallelPrefixSum(vtxPtrOut, NV+1);
+#pragma omp parallel for schedule(dynamic, 1024)
+  for (long k=0; k<NV; k++) {
+    long v = oldId[k];
+    long where = vtxPtrOut[k];
+    for (long j=vtxPtr[v]; j<vtxPtr[v+1]; j++, where++) {
+      vtxIndOut[where].head = k;
+      vtxIndOut[where].tail = newId[vtxInd[j].tail];
+      vtxIndOut[where].weight = vtxInd[j].weight;
+    }
+    sort(vtxIndOut+vtxPtrOut[k], vtxIndOut+vtxPtrOut[k+1], edgeByTail);
+  }
+  free(G->edgeListPtrs);
+  free(G->edgeList);
+  G->edgeListPtrs = vtxPtrOut;
+  G->edgeList = vtxIndOut;
+  free(oldId);
+}//End of relabelGraph()
+
+//Relabel G with the given ordering: (1) degree-descending (2) reverse Cuthill-McKee
+//(3) Rabbit-order style community order. Returns newId[] (old -> new), to map
+//the clustering back to the input ids, or 0 if the graph was left as is.
+long* reorderGraph(graph *G, int ordering) {
+  if (ordering == 0)
+    return 0;
+  long NV = G->numVertices;
+  long *newId = (long *) malloc (NV * sizeof(long)); assert(newId != 0);
+  double gapBefore = meanNeighborGap(G);
+  double time1 = omp_get_wtime();
+  if (ordering == 1)
+    degreeOrder(G, newId);
+  else if (ordering == 2)
+    rcmOrder(G, newId);
+  else
+    rabbitOrder(G, newId);
+  double time2 = omp_get_wtime();
+  relabelGraph(G, newId);
+  double time3 = omp_get_wtime();
+  printf("Reordering (%s): %3.3lf s for the permutation, %3.3lf s to relabel\n",
+         (ordering == 1) ? "degree" : ((ordering == 2) ? "RCM" : "rabbit"), time2-time1, time3-time2);
+  printf("Mean neighbour id gap: %.1lf before, %.1lf after\n", gapBefore, meanNeighborGap(G));
+  return newId;
+}//End of reorderGraph()
@@ -0,0 +1,103 @@
+// **************************************************************************************************
+// Grappolo: A C++ library for parallel graph community detection
+// Hao Lu, Ananth Kalyanaraman (hao.lu@wsu.edu, ananth@eecs.wsu.edu) Washington State University
+// Mahantesh Halappanavar (hala@pnnl.gov) Pacific Northwest National Laboratory
+//
+// For citation, please cite the following paper:
+// Lu, Hao, Mahantesh Halappanavar, and Ananth Kalyanaraman. 
+// "Parallel heuristics for scalable community detection." Parallel Computing 47 (2015): 19-37.
+//
+// **************************************************************************************************
+// Copyright (c) 2016. Washington State University ("WSU"). All Rights Reserved.
+// Permission to use, copy, modify, and distribute this software and its documentation
+// for educational, research, and not-for-profit purposes, without fee, is hereby
+// granted, provided that the above copyright notice, this paragraph and the following
+// two paragraphs appear in all copies, modifications, and distributions. For
+// commercial licensing opportunities, please contact The Office of Commercialization,
+// WSU, 280/286 Lighty, PB Box 641060, Pullman, WA 99164, (509) 335-5526,
+// commercialization@wsu.edu<mailto:commercialization@wsu.edu>, https://commercialization.wsu.edu/
+
+// IN NO EVENT SHALL WSU BE LIABLE TO ANY PARTY FOR DIRECT, INDIRECT, SPECIAL, INCIDENTAL,
+// OR CONSEQUENTIAL DAMAGES, INCLUDING LOST PROFITS, ARISING OUT OF THE USE OF
+// THIS SOFTWARE AND ITS DOCUMENTATION, EVEN IF WSU HAS BEEN ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+// WSU SPECIFICALLY DISCLAIMS ANY WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. THE SOFTWARE AND
+// ACCOMPANYING DOCUMENTATION, IF ANY, PROVIDED HEREUNDER IS PROVIDED "AS IS". WSU HAS NO
+// OBLIGATION TO PROVIDE MAINTENANCE, SUPPORT, UPDATES, ENHANCEMENTS, OR MODIFICATIONS.
+// **************************************************************************************************
+
+#include "defs.h"
+#include "basic_util.h"
+
+using namespace std;
+
+//One context per run: the drivers size the thread team once and every phase
+//of runMultiPhase* reuses it, instead of each routine calling omp_set_num_threads()
+//and opening a throwaway parallel region to find out how many threads it got.
+runtimeContext* createRuntimeContext(int nThreads, long serialCutoff) {
+  runtimeContext *ctx = (runtimeContext *) malloc (sizeof(runtimeContext)); assert(ctx != 0);
+  if (nThreads < 1)
+    nThreads = 1;
+  omp_set_num_threads(nThreads);
+  int nT = 1;
+#pragma omp parallel
+  {
+#pragma omp master
+    nT = omp_get_num_threads();
+  }
+  ctx->nT = nT;
+  ctx->active = nT;
+  ctx->serialCutoff = serialCutoff;
+  ctx->NV = -1;
+  ctx->part = 0;
+  ctx->busyTime = (double *) malloc (nT * sizeof(double)); assert(ctx->busyTime != 0);
+  ctx->threadSum = (double *) malloc (nT * CTX_PAD * sizeof(double)); assert(ctx->threadSum != 0);
+  for (int t=0; t<nT; t++) {
+    ctx->busyTime[t] = 0;
+    ctx->threadSum[t*CTX_PAD] = 0;
+  }
+  return ctx;
+}//End of createRuntimeContext()
+
+//Prepare the context for the graph of the next phase: graphs below the cutoff
+//run on one thread (the fork/join cost dominates on a few thousand vertices),
+//and the edge-balanced partition is rebuilt for the new graph
+template<typename GraphT>
+void bindRuntimeContext(runtimeContext *ctx, GraphT *G) {
+  long NV = G->numVertices;
+  ctx->active = (NV < ctx->serialCutoff) ? 1 : ctx->nT;
+  omp_set_num_threads(ctx->active);
+  if (ctx->part != 0)
+    free(ctx->part);
+  ctx->part = buildEdgePartition(G->edgeListPtrs, NV, ctx->active);
+  ctx->NV = NV;
+  for (int t=0; t<ctx->nT; t++)
+    ctx->busyTime[t] = 0;
+  if ((ctx->active == 1) && (ctx->nT > 1))
+    printf("Runtime context: %ld vertices, below the cutoff of %ld: running serially\n", NV, ctx->serialCutoff);
+}//End of bindRuntimeContext()
+template void bindRuntimeContext<graph>(runtimeContext *ctx, graph *G);
+template void bindRuntimeContext<compactGraphT<long, double> >(runtimeContext *ctx, compactGraphT<long, double> *G);
+template void bindRuntimeContext<compactGraphT<int, double> >(runtimeContext *ctx, compactGraphT<int, double> *G);
+template void bindRuntimeContext<compactGraphT<int, float> >(runtimeContext *ctx, compactGraphT<int, float> *G);
+
+//Sum of the per-thread partial sums of the active threads, in thread order
+double sumThreadValues(runtimeContext *ctx) {
+  double sum = 0;
+  for (int t=0; t<ctx->active; t++)
+    sum += ctx->threadSum[t*CTX_PAD];
+  return sum;
+}//End of sumThreadValues()
+
+void destroyRuntimeContext(runtimeContext *ctx) {
+  if (ctx == 0)
+    return;
+  omp_set_num_threads(ctx->nT);
+  if (ctx->part != 0)
+    free(ctx->part);
+  free(ctx->busyTime);
+  free(ctx->threadSum);
+  free(ctx);
+}//End of destroyRuntimeContext()
@@ -30,6 +30,7 @@
 
 #include "defs.h"
 #include "utilityClusteringFunctions.h"
+#include "basic_util.h"
 
 using namespace std;
 
@@ -50,36 +51,13 @@ double computeMerkinMetric(long* C1, long N1, long* C2, long N2) {
             nC1 = C1[i];
         }
     }
+    nC1++; //Number of communities (ids 0..nC1-1)
     assert(nC1>0);
     
     //STEP 1: Create a CSR-like datastructure for communities in C1
     long * commPtr1 = (long *) malloc ((nC1+1) * sizeof(long)); assert(commPtr1 != 0);
     long * commIndex1 = (long *) malloc (N1 * sizeof(long)); assert(commIndex1 != 0);
-    long * commAdded1 = (long *) malloc (nC1 * sizeof(long)); assert(commAdded1 != 0);
-    
-    // Initialization
-#pragma omp parallel for
-    for(long i = 0; i < nC1; i++) {
-        commPtr1[i] = 0;
-        commAdded1[i] = 0;
-    }
-    commPtr1[nC1] = 0;
-    // Count the size of each community
-#pragma omp parallel for
-    for(long i = 0; i < N1; i++) {
-        __sync_fetch_and_add(&commPtr1[(long)C1[i]+1],1);
-    }
-    //Prefix sum:
-    for(long i=0; i<nC1; i++) {
-        commPtr1[i+1] += commPtr1[i];
-    }
-    //Group vertices with the same color in particular order
-#pragma omp parallel for
-    for (long i=0; i<N1; i++) {
-        long tc = (long)C1[i];
-        long Where = commPtr1[tc] + __sync_fetch_and_add(&(commAdded1[tc]), 1);
-        commIndex1[Where] = i; //The vertex id
-    }
+    buildCSRByKey(C1, N1, nC1, commPtr1, commIndex1); //Vertex ids grouped by community
     
     //Compare all pairs of vertices in each community from C1 to those in C2:
     long nDisagree = 0;
@@ -99,7 +77,7 @@ double computeMerkinMetric(long* C1, long N1, long* C2, long N2) {
     double dM = (2 * nDisagree) / (N1 * N2);
     
     //Cleanup:
-    free(commPtr1); free(commIndex1); free(commAdded1);
+    free(commPtr1); free(commIndex1);
     
     return dM;
     
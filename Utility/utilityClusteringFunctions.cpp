@@ -29,6 +29,7 @@
 // **************************************************************************************************
 
 #include "utilityClusteringFunctions.h"
+#include "basic_util.h"
 
 using namespace std;
 
@@ -54,9 +55,15 @@ void updateAxForOpt(Comm* cInfo, long* currCommAss, double* vDegree, long NV)
    }
   }
 }
+//vDegree and cInfo are first touched over the edge-balanced ranges of the sweep,
+//so that with a first-touch policy each thread's entries sit on its own node
 void sumVertexDegree(edge* vtxInd, long* vtxPtr, double* vDegree, long NV, Comm* cInfo) {
-#pragma omp parallel for
-  for (long i=0; i<NV; i++) {
+  int nT = omp_get_max_threads();
+  long *part = buildEdgePartition(vtxPtr, NV, nT);
+#pragma omp parallel num_threads(nT)
+  {
+  int tid = omp_get_thread_num();
+  for (long i=part[tid]; i<part[tid+1]; i++) {
     long adj1 = vtxPtr[i];	//Begining
     long adj2 = vtxPtr[i+1];	//End
     double totalWt = 0;
@@ -67,6 +74,8 @@ void sumVertexDegree(edge* vtxInd, long* vtxPtr, double* vDegree, long NV, Comm*
     cInfo[i].degree = totalWt;	//Initialize the community
     cInfo[i].size = 1;
   }
+  }
+  free(part);
 }//End of sumVertexDegree()
 
 double calConstantForSecondTerm(double* vDegree, long NV) {
@@ -78,6 +87,34 @@ double calConstantForSecondTerm(double* vDegree, long NV) {
   return (double)1/totalEdgeWeightTwice;
 }//End of calConstantForSecondTerm()
 
+//Exact modularity terms, used to (re)start the incremental bookkeeping of the engines:
+//a2_x = sum of the squared community degrees
+template<typename IdxT, typename WtT>
+double sumSquaredDegrees(CommT<IdxT, WtT>* cInfo, long NV) {
+  double a2_x = 0;
+#pragma omp parallel for reduction(+:a2_x)
+  for (long i=0; i<NV; i++) {
+    a2_x += ((double)cInfo[i].degree)*(cInfo[i].degree);
+  }
+  return a2_x;
+}//End of sumSquaredDegrees()
+template double sumSquaredDegrees<long, double>(CommT<long, double>* cInfo, long NV);
+template double sumSquaredDegrees<int, double>(CommT<int, double>* cInfo, long NV);
+template double sumSquaredDegrees<int, float>(CommT<int, float>* cInfo, long NV);
+
+//e_xx = weight of the edges whose two endpoints are in the same community (each edge seen twice)
+double sumInternalWeight(long* vtxPtr, edge* vtxInd, long* currCommAss, long NV) {
+  double e_xx = 0;
+#pragma omp parallel for reduction(+:e_xx)
+  for (long i=0; i<NV; i++) {
+    for(long j=vtxPtr[i]; j<vtxPtr[i+1]; j++) {
+      if(currCommAss[vtxInd[j].tail] == currCommAss[i])
+        e_xx += vtxInd[j].weight;
+    }
+  }
+  return e_xx;
+}//End of sumInternalWeight()
+
 void initCommAss(long* pastCommAss, long* currCommAss, long NV) {
 #pragma omp parallel for
   for (long i=0; i<NV; i++) {
@@ -86,17 +123,37 @@ void initCommAss(long* pastCommAss, long* currCommAss, long NV) {
   }
 }//End of initCommAss()
 
+//Same as initCommAss(), with the pages first touched over the edge-balanced ranges of the sweep
+void initCommAss(long* pastCommAss, long* currCommAss, long NV, long* vtxPtr) {
+  int nT = omp_get_max_threads();
+  long *part = buildEdgePartition(vtxPtr, NV, nT);
+#pragma omp parallel num_threads(nT)
+  {
+    int tid = omp_get_thread_num();
+    for (long i=part[tid]; i<part[tid+1]; i++) {
+      pastCommAss[i] = i; //Initialize each vertex to its cluster
+      currCommAss[i] = i;
+    }
+  }
+  free(part);
+}//End of initCommAss()
+
 //Smart initialization assuming that each vertex is assigned to its own cluster
 //WARNING: Will ignore duplicate edge entries (multi-graph)
 void initCommAssOpt(long* pastCommAss, long* currCommAss, long NV, 
-		    mapElement* clusterLocalMap, long* vtxPtr, edge* vtxInd,
+		    localMapScratch* scratch, long* vtxPtr, edge* vtxInd,
 		    Comm* cInfo, double constant, double* vDegree ) {
 
-#pragma omp parallel for
-  for (long v=0; v<NV; v++) {
+  int nT = omp_get_max_threads();
+  long *part = buildEdgePartition(vtxPtr, NV, nT); //Same ranges as the sweep: first touch
+#pragma omp parallel num_threads(nT)
+  {
+  int tid = omp_get_thread_num();
+  for (long v=part[tid]; v<part[tid+1]; v++) {
     long adj1  = vtxPtr[v];
     long adj2  = vtxPtr[v+1];
-    long sPosition = vtxPtr[v]+v; //Starting position of local map for v
+    localMapScratch *S = &scratch[tid];
+    mapElement *clusterLocalMap = acquireLocalMap(S, adj2-adj1); //Local map for v
     
     pastCommAss[v] = v; //Initialize each vertex to its own cluster
     //currCommAss[v] = v; //Initialize with a self cluster
@@ -104,20 +161,20 @@ void initCommAssOpt(long* pastCommAss, long* currCommAss, long NV,
     //Step-1: Build local map counter (without a map):
     long numUniqueClusters = 0;
     double selfLoop = 0;
-    clusterLocalMap[sPosition].cid     = v; //Add itself
-    clusterLocalMap[sPosition].Counter = 0; //Initialize the count
+    clusterLocalMap[0].cid     = v; //Add itself
+    clusterLocalMap[0].Counter = 0; //Initialize the count
     numUniqueClusters++;
     //Parse through the neighbors
     for(long j=adj1; j<adj2; j++) {
       if(vtxInd[j].tail == v) {	// SelfLoop need to be recorded
 	      selfLoop += (long)vtxInd[j].weight;
-        clusterLocalMap[sPosition].Counter = vtxInd[j].weight; //Initialize the count
+        clusterLocalMap[0].Counter = vtxInd[j].weight; //Initialize the count
         continue;
       }
       //Assume each neighbor is assigned to a separate cluster
       //Assume no duplicates (only way to improve performance at this step)
-      clusterLocalMap[sPosition + numUniqueClusters].cid     = vtxInd[j].tail; //Add the cluster id (initialized to itself)
-      clusterLocalMap[sPosition + numUniqueClusters].Counter = vtxInd[j].weight; //Initialize the count
+      clusterLocalMap[numUniqueClusters].cid     = vtxInd[j].tail; //Add the cluster id (initialized to itself)
+      clusterLocalMap[numUniqueClusters].Counter = vtxInd[j].weight; //Initialize the count
       numUniqueClusters++;
     }//End of for(j)
     
@@ -125,19 +182,19 @@ void initCommAssOpt(long* pastCommAss, long* currCommAss, long NV,
     long maxIndex = v;	//Assign the initial value as the current community
     double curGain = 0;
     double maxGain = 0;
-    double eix = clusterLocalMap[sPosition].Counter - selfLoop; //NOT SURE ABOUT THIS.
+    double eix = clusterLocalMap[0].Counter - selfLoop; //NOT SURE ABOUT THIS.
     double ax  = cInfo[v].degree - vDegree[v];
     double eiy = 0;
     double ay  = 0;    
     for(long k=0; k<numUniqueClusters; k++) {
-      if(v != clusterLocalMap[sPosition + k].cid) {
-        ay = cInfo[clusterLocalMap[sPosition + k].cid].degree; // degree of cluster y
-        eiy = clusterLocalMap[sPosition + k].Counter; 	//Total edges incident on cluster y
+      if(v != clusterLocalMap[k].cid) {
+        ay = cInfo[clusterLocalMap[k].cid].degree; // degree of cluster y
+        eiy = clusterLocalMap[k].Counter; 	//Total edges incident on cluster y
         curGain = 2*(eiy - eix) - 2*vDegree[v]*(ay - ax)*constant;
 	
-        if( (curGain > maxGain) || ((curGain==maxGain) && (curGain != 0) && (clusterLocalMap[sPosition + k].cid < maxIndex)) ) {
+        if( (curGain > maxGain) || ((curGain==maxGain) && (curGain != 0) && (clusterLocalMap[k].cid < maxIndex)) ) {
           maxGain  = curGain;
-          maxIndex = clusterLocalMap[sPosition + k].cid;
+          maxIndex = clusterLocalMap[k].cid;
         }
       }
     }//End of for()
@@ -146,7 +203,10 @@ void initCommAssOpt(long* pastCommAss, long* currCommAss, long NV,
       maxIndex = v;
     }    
     currCommAss[v] = maxIndex; //Assign the new community
+    releaseLocalMap(S);
+  }
   }
+  free(part);
 
   updateAxForOpt(cInfo,currCommAss,vDegree,NV);
 }//End of initCommAssOpt()
@@ -245,26 +305,46 @@ long max(map<long, long> &clusterLocalMap, vector<double> &Counter,
 
 long maxNoMap(long v, mapElement* clusterLocalMap, long* vtxPtr, double selfLoop, Comm* cInfo, double degree,
               long sc, double constant, long numUniqueClusters ) {
-                                                                                
+    long sPosition = vtxPtr[v]+v; //Starting position of local map for v
+    return maxLocalMap(&clusterLocalMap[sPosition], selfLoop, cInfo, degree, sc, constant, numUniqueClusters);
+}//End maxNoMap()
+
+//Same gain and tie-breaking rules as max(), over a contiguous local map
+//WARNING: Assumes that localMap[0] holds the current community (sc)
+long maxLocalMap(mapElement* localMap, double selfLoop, Comm* cInfo, double degree,
+                 long sc, double constant, long numUniqueClusters ) {
+
+    double eix = localMap[0].Counter - selfLoop;
+    double ax  = cInfo[sc].degree - degree;
+    //Vectorized argmax (see gainKernel.cpp)
+    long maxIndex = maxGainLocalMap(localMap, numUniqueClusters, cInfo, eix, ax, degree, constant, sc);
+
+    if(cInfo[maxIndex].size == 1 && cInfo[sc].size ==1 && maxIndex > sc) { //Swap protection
+        maxIndex = sc;
+    }
+
+    return maxIndex;
+}//End maxLocalMap()
+
+//Same rules as maxLocalMap(), for the narrow community types of the compact kernels
+template<typename IdxT, typename WtT>
+long maxLocalMap(mapElement* localMap, double selfLoop, CommT<IdxT, WtT>* cInfo, double degree,
+                 long sc, double constant, long numUniqueClusters ) {
+
     long maxIndex = sc;	//Assign the initial value as the current community
-    double curGain = 0;
     double maxGain = 0;
-    long sPosition = vtxPtr[v]+v; //Starting position of local map for v
-    double eix = clusterLocalMap[sPosition].Counter - selfLoop;
+    double eix = localMap[0].Counter - selfLoop;
     double ax  = cInfo[sc].degree - degree;
-    double eiy = 0;
-    double ay  = 0;
-    
-    for(long k=0; k<numUniqueClusters; k++) {
-        if(sc != clusterLocalMap[sPosition + k].cid) {
-            ay = cInfo[clusterLocalMap[sPosition + k].cid].degree; // degree of cluster y
-            eiy = clusterLocalMap[sPosition + k].Counter; 	//Total edges incident on cluster y
-            curGain = 2*(eiy - eix) - 2*degree*(ay - ax)*constant;
 
+    for(long k=0; k<numUniqueClusters; k++) {
+        long cid = localMap[k].cid;
+        if(sc != cid) {
+            double ay = cInfo[cid].degree; // degree of cluster y
+            double curGain = 2*(localMap[k].Counter - eix) - 2*degree*(ay - ax)*constant;
             if( (curGain > maxGain) ||
-               ((curGain==maxGain) && (curGain != 0) && (clusterLocalMap[sPosition + k].cid < maxIndex)) ) {
+               ((curGain==maxGain) && (curGain != 0) && (cid < maxIndex)) ) {
                 maxGain  = curGain;
-                maxIndex = clusterLocalMap[sPosition + k].cid;
+                maxIndex = cid;
             }
         }
     }//End of for()
@@ -274,7 +354,209 @@ long maxNoMap(long v, mapElement* clusterLocalMap, long* vtxPtr, double selfLoop
     }
 
     return maxIndex;
-}//End maxNoMap()
-            
-    
-  
+}//End maxLocalMap()
+template long maxLocalMap<int, double>(mapElement* localMap, double selfLoop, CommT<int, double>* cInfo, double degree,
+                                       long sc, double constant, long numUniqueClusters);
+template long maxLocalMap<int, float>(mapElement* localMap, double selfLoop, CommT<int, float>* cInfo, double degree,
+                                      long sc, double constant, long numUniqueClusters);
+
+long maxDegreeOfGraph(long* vtxPtr, long NV) {
+  long maxDegree = 0;
+#pragma omp parallel for reduction(max: maxDegree)
+  for (long i=0; i<NV; i++) {
+    long degree = vtxPtr[i+1] - vtxPtr[i];
+    if (degree > maxDegree)
+      maxDegree = degree;
+  }
+  return maxDegree;
+}//End of maxDegreeOfGraph()
+
+//Size the table to at least twice the number of entries (load factor <= 0.5)
+void initHashLocalMap(hashLocalMap *H, long maxEntries) {
+  long size = 2;
+  int  logSize = 1;
+  while (size < 2*maxEntries) {
+    size *= 2;
+    logSize++;
+  }
+  H->tableSize  = size;
+  H->shift      = 64 - logSize;
+  H->numTouched = 0;
+  H->key      = (long *) malloc (size * sizeof(long)); assert(H->key != 0);
+  H->position = (long *) malloc (size * sizeof(long)); assert(H->position != 0);
+  H->touched  = (long *) malloc (maxEntries * sizeof(long)); assert(H->touched != 0);
+  for (long i=0; i<size; i++) {
+    H->key[i] = -1; //Empty slot
+  }
+}//End of initHashLocalMap()
+
+void freeHashLocalMap(hashLocalMap *H) {
+  free(H->key);
+  free(H->position);
+  free(H->touched);
+}//End of freeHashLocalMap()
+
+//Only the slots used by the last vertex are reset: O(#unique clusters), not O(tableSize)
+void clearHashLocalMap(hashLocalMap *H) {
+  for (long k=0; k<H->numTouched; k++) {
+    H->key[H->touched[k]] = -1;
+  }
+  H->numTouched = 0;
+}//End of clearHashLocalMap()
+
+//Build the local-map data structure with an open-addressing table in place of map<long,long>
+//The unique clusters are written to localMap in the order they are found;
+//entries already in localMap (e.g., the current cluster of v) are kept at their positions
+//WARNING: localMap must have room for (degree of v) + numUniqueClusters entries
+double buildLocalMapCounterHash(long v, mapElement* localMap, long* vtxPtr, edge* vtxInd,
+                                long* currCommAss, long &numUniqueClusters, hashLocalMap *H) {
+  long adj1 = vtxPtr[v];
+  long adj2 = vtxPtr[v+1];
+  double selfLoop = 0;
+
+  for(long k=0; k<numUniqueClusters; k++) { //Register the existing entries
+    long slot = findSlotHashLocalMap(H, localMap[k].cid);
+    H->key[slot] = localMap[k].cid;
+    H->position[slot] = k;
+    H->touched[H->numTouched++] = slot;
+  }
+
+  for(long j=adj1; j<adj2; j++) {
+    if(vtxInd[j].tail == v) {	// SelfLoop need to be recorded
+      selfLoop += vtxInd[j].weight;
+    }
+    long cid  = currCommAss[vtxInd[j].tail];
+    long slot = findSlotHashLocalMap(H, cid);
+    if( H->key[slot] == cid ) {	//Already exists
+      localMap[H->position[slot]].Counter += vtxInd[j].weight; //Increment the counter with weight
+    } else {	//Does not exist, add to the map
+      H->key[slot] = cid;
+      H->position[slot] = numUniqueClusters;
+      H->touched[H->numTouched++] = slot;
+      localMap[numUniqueClusters].cid     = cid;
+      localMap[numUniqueClusters].Counter = vtxInd[j].weight; //Initialize the count
+      numUniqueClusters++;
+    }
+  }//End of for(j)
+
+  clearHashLocalMap(H); //Leave the table empty for the next vertex
+  return selfLoop;
+}//End of buildLocalMapCounterHash()
+
+//Call from the thread that will use the SPA (first-touch placement)
+void initDenseSPA(denseSPA *spa, long NV) {
+  spa->stampValue = 0;
+  spa->slot = (spaElement *) malloc (NV * sizeof(spaElement)); assert(spa->slot != 0);
+  for (long i=0; i<NV; i++) {
+    spa->slot[i].stamp = 0; //Never seen
+  }
+}//End of initDenseSPA()
+
+void freeDenseSPA(denseSPA *spa) {
+  free(spa->slot);
+  spa->slot = 0;
+}//End of freeDenseSPA()
+
+//Build the local-map data structure using a dense SPA: O(1) lookup per neighbor
+//Same output as buildLocalMapCounterNoMap(): unique clusters in the order they are found
+//WARNING: Entries already in localMap (e.g., the current cluster of v) are kept at their positions
+double buildLocalMapCounterSPA(long v, mapElement* localMap, long* vtxPtr, edge* vtxInd,
+                               long* currCommAss, long &numUniqueClusters, denseSPA *spa) {
+  long adj1 = vtxPtr[v];
+  long adj2 = vtxPtr[v+1];
+  double selfLoop = 0;
+  long stamp = ++(spa->stampValue); //Invalidates everything recorded for the previous vertex
+  spaElement *slot = spa->slot;
+
+  for(long k=0; k<numUniqueClusters; k++) { //Register the existing entries
+    slot[localMap[k].cid].stamp    = stamp;
+    slot[localMap[k].cid].position = k;
+  }
+
+  for(long j=adj1; j<adj2; j++) {
+    if(vtxInd[j].tail == v) {	// SelfLoop need to be recorded
+      selfLoop += vtxInd[j].weight;
+    }
+    long cid = currCommAss[vtxInd[j].tail];
+    if( slot[cid].stamp == stamp ) {	//Already exists
+      localMap[slot[cid].position].Counter += vtxInd[j].weight; //Increment the counter with weight
+    } else {	//Does not exist, add to the map
+      slot[cid].stamp    = stamp;
+      slot[cid].position = numUniqueClusters;
+      localMap[numUniqueClusters].cid     = cid;
+      localMap[numUniqueClusters].Counter = vtxInd[j].weight; //Initialize the count
+      numUniqueClusters++;
+    }
+  }//End of for(j)
+  return selfLoop;
+}//End of buildLocalMapCounterSPA()
+
+//Per-thread local maps that replace the (NV + 2*NE) buffer of the NoMap kernels
+//localMapCap < 0 : local map of (maxDegree+1) entries with a dense SPA lookup (fastest)
+//localMapCap = 0 : bounded memory -- local map of (maxDegree+1) entries with a hash lookup
+//localMapCap > 0 : bounded memory -- at most localMapCap entries; larger vertices use a temporary map
+localMapScratch* allocLocalMapScratch(int nT, long NV, long maxDegree, long localMapCap) {
+  long capacity = maxDegree + 1; //+1 for the current cluster of the vertex
+  if ((localMapCap > 0) && (localMapCap < capacity))
+    capacity = localMapCap;
+  localMapScratch *S = (localMapScratch *) malloc (nT * sizeof(localMapScratch)); assert(S != 0);
+#pragma omp parallel num_threads(nT)
+  {
+    localMapScratch *myS = &S[omp_get_thread_num()];
+    myS->capacity = capacity;
+    myS->localMap = (mapElement *) malloc (capacity * sizeof(mapElement)); assert(myS->localMap != 0);
+    myS->overflow = 0;
+    myS->spa.slot = 0;
+    myS->hash.key = 0;
+    if (localMapCap < 0)
+      initDenseSPA(&myS->spa, NV);
+    else
+      initHashLocalMap(&myS->hash, capacity);
+  }
+  long perThread = capacity * sizeof(mapElement);
+  if (localMapCap < 0)
+    perThread += NV * sizeof(spaElement);
+  else
+    perThread += S[0].hash.tableSize * 2 * sizeof(long) + capacity * sizeof(long);
+  printf("Local-map scratch: %ld entries per thread (%s lookup), %ld bytes in total\n",
+         capacity, (localMapCap < 0) ? "SPA" : "hash", perThread * nT);
+  return S;
+}//End of allocLocalMapScratch()
+
+void freeLocalMapScratch(localMapScratch *S, int nT) {
+  for (int t=0; t<nT; t++) {
+    free(S[t].localMap);
+    if (S[t].spa.slot != 0)
+      freeDenseSPA(&S[t].spa);
+    if (S[t].hash.key != 0)
+      freeHashLocalMap(&S[t].hash);
+  }
+  free(S);
+}//End of freeLocalMapScratch()
+
+//Return a local map that can hold all the clusters of a vertex with the given degree
+mapElement* acquireLocalMap(localMapScratch *S, long degree) {
+  if (degree + 1 <= S->capacity)
+    return S->localMap;
+  //Only in bounded mode with a cap below the max degree: temporary map for this vertex
+  S->overflow = (mapElement *) malloc ((degree + 1) * sizeof(mapElement)); assert(S->overflow != 0);
+  initHashLocalMap(&S->overflowHash, degree + 1);
+  return S->overflow;
+}//End of acquireLocalMap()
+
+void releaseLocalMap(localMapScratch *S) {
+  if (S->overflow != 0) {
+    free(S->overflow);
+    freeHashLocalMap(&S->overflowHash);
+    S->overflow = 0;
+  }
+}//End of releaseLocalMap()
+
+double buildLocalMapCounterScratch(long v, mapElement* localMap, long* vtxPtr, edge* vtxInd,
+                                   long* currCommAss, long &numUniqueClusters, localMapScratch *S) {
+  if (S->spa.slot != 0)
+    return buildLocalMapCounterSPA(v, localMap, vtxPtr, vtxInd, currCommAss, numUniqueClusters, &S->spa);
+  if (S->overflow != 0)
+    return buildLocalMapCounterHash(v, localMap, vtxPtr, vtxInd, currCommAss, numUniqueClusters, &S->overflowHash);
+  return buildLocalMapCounterHash(v, localMap, vtxPtr, vtxInd, currCommAss, numUniqueClusters, &S->hash);
+}//End of buildLocalMapCounterScratch()
@@ -31,6 +31,7 @@
 #include "defs.h"
 #include "RngStream.h"
 #include <algorithm>
+#include <sys/resource.h>
 
 using namespace std;
 
@@ -428,3 +429,54 @@ graph * convertDirected2Undirected(graph *G) {
   
 }//End of convertDirected2Undirected()
 
+
+static long peakBeforeReset = 0; //Highest peak cleared by resetPeakRSS()
+
+//Peak resident set size of the process so far, in KB (ru_maxrss is in KB on Linux)
+long getPeakRSS() {
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) != 0)
+    return -1;
+  return (usage.ru_maxrss > peakBeforeReset) ? usage.ru_maxrss : peakBeforeReset;
+}//End of getPeakRSS()
+
+//Read one "Name:  value kB" field of /proc/self/status; -1 if not available
+static long readProcStatusKB(const char *field) {
+  FILE *fp = fopen("/proc/self/status", "r");
+  if (fp == 0)
+    return -1;
+  char line[256];
+  long value = -1;
+  size_t len = strlen(field);
+  while (fgets(line, sizeof(line), fp) != 0) {
+    if (strncmp(line, field, len) == 0) {
+      value = atol(line + len);
+      break;
+    }
+  }
+  fclose(fp);
+  return value;
+}//End of readProcStatusKB()
+
+//Current resident set size of the process, in KB
+long getCurrentRSS() {
+  return readProcStatusKB("VmRSS:");
+}//End of getCurrentRSS()
+
+//Restart the high-water mark reported by getPhasePeakRSS() from the current RSS
+//(Linux 4.0+); getPeakRSS() keeps reporting the peak of the whole run
+void resetPeakRSS() {
+  long peak = getPeakRSS(); //The reset also clears ru_maxrss
+  if (peak > peakBeforeReset)
+    peakBeforeReset = peak;
+  FILE *fp = fopen("/proc/self/clear_refs", "w");
+  if (fp == 0)
+    return;
+  fputs("5", fp);
+  fclose(fp);
+}//End of resetPeakRSS()
+
+//Peak resident set size since the last resetPeakRSS(), in KB
+long getPhasePeakRSS() {
+  return readProcStatusKB("VmHWM:");
+}//End of getPhasePeakRSS()
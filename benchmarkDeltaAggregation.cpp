@@ -0,0 +1,190 @@
+// **************************************************************************************************
+// Grappolo: A C++ library for parallel graph community detection
+// Hao Lu, Ananth Kalyanaraman (hao.lu@wsu.edu, ananth@eecs.wsu.edu) Washington State University
+// Mahantesh Halappanavar (hala@pnnl.gov) Pacific Northwest National Laboratory
+//
+// For citation, please cite the following paper:
+// Lu, Hao, Mahantesh Halappanavar, and Ananth Kalyanaraman. 
+// "Parallel heuristics for scalable community detection." Parallel Computing 47 (2015): 19-37.
+//
+// **************************************************************************************************
+// Copyright (c) 2016. Washington State University ("WSU"). All Rights Reserved.
+// Permission to use, copy, modify, and distribute this software and its documentation
+// for educational, research, and not-for-profit purposes, without fee, is hereby
+// granted, provided that the above copyright notice, this paragraph and the following
+// two paragraphs appear in all copies, modifications, and distributions. For
+// commercial licensing opportunities, please contact The Office of Commercialization,
+// WSU, 280/286 Lighty, PB Box 641060, Pullman, WA 99164, (509) 335-5526,
+// commercialization@wsu.edu<mailto:commercialization@wsu.edu>, https://commercialization.wsu.edu/
+
+// IN NO EVENT SHALL WSU BE LIABLE TO ANY PARTY FOR DIRECT, INDIRECT, SPECIAL, INCIDENTAL,
+// OR CONSEQUENTIAL DAMAGES, INCLUDING LOST PROFITS, ARISING OUT OF THE USE OF
+// THIS SOFTWARE AND ITS DOCUMENTATION, EVEN IF WSU HAS BEEN ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+// WSU SPECIFICALLY DISCLAIMS ANY WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. THE SOFTWARE AND
+// ACCOMPANYING DOCUMENTATION, IF ANY, PROVIDED HEREUNDER IS PROVIDED "AS IS". WSU HAS NO
+// OBLIGATION TO PROVIDE MAINTENANCE, SUPPORT, UPDATES, ENHANCEMENTS, OR MODIFICATIONS.
+// **************************************************************************************************
+
+#include "defs.h"
+#include "basic_util.h"
+#include "utilityClusteringFunctions.h"
+#include "RngStream.h"
+using namespace std;
+
+//Micro-benchmark for the community updates of a sweep: atomics on cUpdate versus
+//per-thread delta buffers (see communityDeltaBuffer.cpp). Target communities follow a
+//Zipf distribution: the larger the exponent, the more moves go to a few giant communities.
+//Usage: benchmarkDeltaAggregation [numCommunities] [numMoves] [repeats]
+
+//Draw numMoves community IDs from a Zipf(s) distribution over numComm communities
+static void zipfSample(long *out, double *uniform, long numMoves, long numComm, double s) {
+  double *cdf = (double *) malloc (numComm * sizeof(double)); assert(cdf != 0);
+  double total = 0;
+  for (long k=0; k<numComm; k++) {
+    total += 1.0 / pow((double)(k+1), s);
+    cdf[k] = total;
+  }
+#pragma omp parallel for
+  for (long m=0; m<numMoves; m++) {
+    double u = uniform[m] * total;
+    long low = 0, high = numComm-1;
+    while (low < high) { //First position with cdf >= u
+      long mid = low + (high - low) / 2;
+      if (cdf[mid] < u)
+        low = mid + 1;
+      else
+        high = mid;
+    }
+    out[m] = low;
+  }
+  free(cdf);
+}
+
+static void resetUpdates(Comm *cUpdate, long numComm) {
+#pragma omp parallel for
+  for (long i=0; i<numComm; i++) {
+    cUpdate[i].size   = 0;
+    cUpdate[i].degree = 0;
+  }
+}
+
+static double runAtomic(Comm *cUpdate, long numComm, long *target, long *source, double *degree, long numMoves) {
+  resetUpdates(cUpdate, numComm);
+  double time1 = omp_get_wtime();
+#pragma omp parallel for
+  for (long m=0; m<numMoves; m++) {
+    #pragma omp atomic update
+    cUpdate[target[m]].degree += degree[m];
+    #pragma omp atomic update
+    cUpdate[target[m]].size += 1;
+    #pragma omp atomic update
+    cUpdate[source[m]].degree -= degree[m];
+    #pragma omp atomic update
+    cUpdate[source[m]].size -=1;
+  }
+  return omp_get_wtime() - time1;
+}
+
+static double runBuffered(Comm *cUpdate, long numComm, long *target, long *source, double *degree, long numMoves,
+                          deltaBuffer *deltaBuf) {
+  resetUpdates(cUpdate, numComm);
+  double time1 = omp_get_wtime();
+#pragma omp parallel
+  {
+    int tid = omp_get_thread_num();
+#pragma omp for schedule(static)
+    for (long m=0; m<numMoves; m++) {
+      addDeltaBuffer(&deltaBuf[tid], target[m], 1, degree[m]);
+      addDeltaBuffer(&deltaBuf[tid], source[m], -1, -degree[m]);
+    }
+    mergeDeltaBuffers(deltaBuf, cUpdate, numComm);
+  }
+  return omp_get_wtime() - time1;
+}
+
+//Fisher-Yates shuffle of the draws: a permutation, so they stay uniform
+static void shuffleDraws(double *uniform, long numMoves, RngStream &rng) {
+  for (long m=numMoves-1; m>0; m--) {
+    long k = (long)(rng.RandU01() * (m+1));
+    if (k > m)
+      k = m;
+    double tmp = uniform[m];
+    uniform[m] = uniform[k];
+    uniform[k] = tmp;
+  }
+}//End of shuffleDraws()
+
+int main(int argc, char** argv) {
+  long numComm  = (argc > 1) ? atol(argv[1]) : 1000000;
+  long numMoves = (argc > 2) ? atol(argv[2]) : 10000000;
+  int  repeats  = (argc > 3) ? atoi(argv[3]) : 5;
+  int nT = 1;
+#pragma omp parallel
+  {
+    nT = omp_get_num_threads();
+  }
+  printf("Communities: %ld  Moves: %ld  Threads: %d  Repeats: %d\n", numComm, numMoves, nT, repeats);
+
+  long *target    = (long *) malloc (numMoves * sizeof(long)); assert(target != 0);
+  long *source    = (long *) malloc (numMoves * sizeof(long)); assert(source != 0);
+  double *degree  = (double *) malloc (numMoves * sizeof(double)); assert(degree != 0);
+  double *uniform = (double *) malloc (numMoves * sizeof(double)); assert(uniform != 0);
+  Comm *cAtomic   = (Comm *) malloc (numComm * sizeof(Comm)); assert(cAtomic != 0);
+  Comm *cBuffered = (Comm *) malloc (numComm * sizeof(Comm)); assert(cBuffered != 0);
+  deltaBuffer *deltaBuf = allocDeltaBuffers(nT, 4096);
+
+  //Vertices leave communities uniformly at random and have small integer degrees
+  generateRandomNumbers(uniform, numMoves);
+  RngStream shuffleRng; //Next stream of the fixed package seed: same shuffles in every run
+#pragma omp parallel for
+  for (long m=0; m<numMoves; m++) {
+    source[m] = (long)(uniform[m] * numComm) % numComm;
+    degree[m] = 1 + (long)(uniform[(m * 7919) % numMoves] * 16);
+  }
+
+  double exponents[] = {0.0, 0.5, 0.8, 1.0, 1.2, 1.5, 2.0};
+  int numExponents = sizeof(exponents) / sizeof(double);
+  printf("====================================================================\n");
+  printf("Zipf-s   Largest-share   Atomic(s)    Buffered(s)   Speedup\n");
+  printf("====================================================================\n");
+  double crossover = -1;
+  for (int e=0; e<numExponents; e++) {
+    shuffleDraws(uniform, numMoves, shuffleRng); //Decorrelate from the source draws
+    zipfSample(target, uniform, numMoves, numComm, exponents[e]);
+    long largest = 0;
+#pragma omp parallel for reduction(+:largest)
+    for (long m=0; m<numMoves; m++) {
+      if (target[m] == 0)
+        largest++;
+    }
+    runBuffered(cBuffered, numComm, target, source, degree, numMoves, deltaBuf); //Warm-up: grows the buffers
+    double tAtomic = 0, tBuffered = 0;
+    for (int r=0; r<repeats; r++) {
+      tAtomic   += runAtomic(cAtomic, numComm, target, source, degree, numMoves);
+      tBuffered += runBuffered(cBuffered, numComm, target, source, degree, numMoves, deltaBuf);
+    }
+    tAtomic /= repeats;
+    tBuffered /= repeats;
+    for (long i=0; i<numComm; i++) { //Both paths must agree
+      assert(cAtomic[i].size == cBuffered[i].size);
+      assert(fabs(cAtomic[i].degree - cBuffered[i].degree) < 1e-6);
+    }
+    if ((crossover < 0) && (tBuffered < tAtomic))
+      crossover = exponents[e];
+    printf("%3.2lf     %10.4lf      %9.4lf    %9.4lf     %5.2lf\n", exponents[e],
+           (double)largest / numMoves, tAtomic, tBuffered, tAtomic / tBuffered);
+  }
+  printf("====================================================================\n");
+  if (crossover >= 0)
+    printf("Delta buffers are faster from Zipf exponent %3.2lf onwards\n", crossover);
+  else
+    printf("Atomics were faster for every exponent tested\n");
+
+  freeDeltaBuffers(deltaBuf, nT);
+  free(target); free(source); free(degree); free(uniform);
+  free(cAtomic); free(cBuffered);
+  return 0;
+}//End of main()
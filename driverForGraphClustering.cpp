@@ -45,13 +45,12 @@ int main(int argc, char** argv) {
     if (!opts.parse(argc, argv)) {
         return -1;
     }
-    int nT = 1; //Default is one thread
-#pragma omp parallel
-    {
-        nT = omp_get_num_threads();
-    }
+    //Thread team sized once for the whole run and passed to every phase
+    runtimeContext *ctx = createRuntimeContext(omp_get_max_threads(), opts.serialCutoff);
+    int nT = ctx->nT;
     if (nT <= 1) {
         printf("The number of threads should be greater than one.\n");
+        destroyRuntimeContext(ctx);
         return 0;
     }
     
@@ -88,6 +87,12 @@ int main(int argc, char** argv) {
     
     
     displayGraphCharacteristics(G);
+    selectGainKernel(opts.gainKernel);
+    //The loaders fill the CSR arrays serially: redistribute them before the first phase
+    selectNumaPlacement(opts.numaPlacement);
+    selectClusterOrder(opts.clusterOrder);
+    selectInPlaceCoarsening(opts.inPlace);
+    placeGraph(G, nT);
     int threadsOpt = 0;
     if(opts.threadsOpt)
         threadsOpt =1;
@@ -114,7 +119,13 @@ int main(int argc, char** argv) {
         free(C); //Free up memory
         printf("Graph after modifications:\n");
         displayGraphCharacteristics(G);
+        placeGraph(G, nT);
     }//End of if( VF == 1 )
+    //Relabel for locality; newId maps the clustering back to the input ids
+    long *newId = reorderGraph(G, opts.reorder);
+    if (newId != 0)
+        placeGraph(G, nT);
+    reportNumaLocality(G, nT);
     
 	   
     // Datastructures to store clustering information
@@ -160,16 +171,36 @@ int main(int argc, char** argv) {
             C_orig[i] = -1;
         }
         
+        //Every level of the hierarchy, written while the clustering runs
+        if( opts.dendrogram ) {
+            char dendrogramFile[256];
+            sprintf(dendrogramFile,"%s_dendrogram", opts.inFile);
+            openDendrogram(dendrogramFile, NV, newId);
+        }
         //runMultiPhaseLouvainAlgorithm(G, C_orig, coloring, replaceMap, opts.minGraphSize, opts.threshold, opts.C_thresh, nT,threadsOpt);
         // Change to each sub function that belong to the folder
         if(opts.coloring != 0){
-            runMultiPhaseColoring(G, C_orig, opts.coloring, opts.minGraphSize, opts.threshold, opts.C_thresh, nT,threadsOpt);
+            runMultiPhaseColoring(G, C_orig, opts.coloring, opts.minGraphSize, opts.threshold, opts.C_thresh, ctx,threadsOpt, opts.localMapCap, opts.hubThreshold,
+                                  opts.atomicUpdates);
         }else if(opts.syncType != 0){
-            runMultiPhaseSyncType(G, C_orig, opts.syncType, opts.minGraphSize, opts.threshold, opts.C_thresh, nT,threadsOpt);
+            runMultiPhaseSyncType(G, C_orig, opts.syncType, opts.minGraphSize, opts.threshold, opts.C_thresh, ctx,threadsOpt, opts.localMapCap);
         }else{
-            runMultiPhaseBasic(G, C_orig, opts.basicOpt, opts.minGraphSize, opts.threshold, opts.C_thresh, nT,threadsOpt);
+            runMultiPhaseBasic(G, C_orig, opts.basicOpt, opts.minGraphSize, opts.threshold, opts.C_thresh, ctx,threadsOpt, opts.localMapCap, opts.hubThreshold,
+                                  opts.atomicUpdates);
         }
-        
+        closeDendrogram();
+    }
+    
+    //Back to the input vertex ids
+    if (newId != 0) {
+        long *C_input = (long *) malloc (NV * sizeof(long)); assert(C_input != 0);
+#pragma omp parallel for
+        for (long i=0; i<NV; i++) {
+            C_input[i] = C_orig[newId[i]];
+        }
+        free(C_orig);
+        C_orig = C_input;
+        free(newId);
     }
     
     //Check if cluster ids need to be written to a file:
@@ -186,6 +217,7 @@ int main(int argc, char** argv) {
     
     //Cleanup:
     if(C_orig != 0) free(C_orig);
+    destroyRuntimeContext(ctx);
     //Do not free G here -- it will be done in another routine.
     
     return 0;
@@ -0,0 +1,73 @@
+// **************************************************************************************************
+// Grappolo: A C++ library for parallel graph community detection
+// Hao Lu, Ananth Kalyanaraman (hao.lu@wsu.edu, ananth@eecs.wsu.edu) Washington State University
+// Mahantesh Halappanavar (hala@pnnl.gov) Pacific Northwest National Laboratory
+//
+// For citation, please cite the following paper:
+// Lu, Hao, Mahantesh Halappanavar, and Ananth Kalyanaraman. 
+// "Parallel heuristics for scalable community detection." Parallel Computing 47 (2015): 19-37.
+//
+// **************************************************************************************************
+// Copyright (c) 2016. Washington State University ("WSU"). All Rights Reserved.
+// Permission to use, copy, modify, and distribute this software and its documentation
+// for educational, research, and not-for-profit purposes, without fee, is hereby
+// granted, provided that the above copyright notice, this paragraph and the following
+// two paragraphs appear in all copies, modifications, and distributions. For
+// commercial licensing opportunities, please contact The Office of Commercialization,
+// WSU, 280/286 Lighty, PB Box 641060, Pullman, WA 99164, (509) 335-5526,
+// commercialization@wsu.edu<mailto:commercialization@wsu.edu>, https://commercialization.wsu.edu/
+
+// IN NO EVENT SHALL WSU BE LIABLE TO ANY PARTY FOR DIRECT, INDIRECT, SPECIAL, INCIDENTAL,
+// OR CONSEQUENTIAL DAMAGES, INCLUDING LOST PROFITS, ARISING OUT OF THE USE OF
+// THIS SOFTWARE AND ITS DOCUMENTATION, EVEN IF WSU HAS BEEN ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+// WSU SPECIFICALLY DISCLAIMS ANY WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. THE SOFTWARE AND
+// ACCOMPANYING DOCUMENTATION, IF ANY, PROVIDED HEREUNDER IS PROVIDED "AS IS". WSU HAS NO
+// OBLIGATION TO PROVIDE MAINTENANCE, SUPPORT, UPDATES, ENHANCEMENTS, OR MODIFICATIONS.
+// **************************************************************************************************
+
+#include "defs.h"
+#include "input_output.h"
+using namespace std;
+
+//Community of every vertex at one level of a dendrogram written with -w.
+//Usage: extractDendrogramLevel <dendrogram file> [level]
+//Without a level the sizes of all levels are listed and the last level is extracted.
+//Level 0 is the input itself; level k is the clustering after phase k. The result
+//is written like the _clustInfo file (one id per line) to <dendrogram file>_level<k>.
+int main(int argc, char** argv) {
+  if ((argc < 2) || (argc > 3)) {
+    printf("Usage: %s <dendrogram file> [level]\n", argv[0]);
+    return -1;
+  }
+  const char *inFile = argv[1];
+  long level = -1; //Last
+  if (argc == 3)
+    level = atol(argv[2]);
+  else
+    displayDendrogram(inFile);
+
+  double time1 = omp_get_wtime();
+  long NV, numCommunities;
+  long *C = loadDendrogramLevel(inFile, &level, &NV, &numCommunities);
+  double time2 = omp_get_wtime();
+  printf("Level %ld: %ld vertices in %ld communities (%3.3lf s to compose)\n",
+         level, NV, numCommunities, time2-time1);
+
+  char outFile[256];
+  sprintf(outFile,"%s_level%ld", inFile, level);
+  FILE* out = fopen(outFile,"w");
+  if (out == 0) {
+    printf("Could not open the output file: %s\n", outFile);
+    return -1;
+  }
+  for(long i = 0; i<NV;i++) {
+    fprintf(out,"%ld\n",C[i]);
+  }
+  fclose(out);
+  printf("Cluster information has been stored in file: %s\n", outFile);
+  free(C);
+  return 0;
+}//End of main()